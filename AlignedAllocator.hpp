@@ -0,0 +1,63 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __ALIGNEDALLOCATOR_HPP_INCLUDED__
+#define __ALIGNEDALLOCATOR_HPP_INCLUDED__
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdint.h> //for uintptr_t
+
+//Allocator for std::vector, so that the data starts on an Alignment byte boundary (a cache line by default).
+//Alignment must be a power of 2.
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+    public:
+        typedef T value_type;
+        template <typename U> struct rebind {typedef AlignedAllocator<U, Alignment> other;};
+
+        AlignedAllocator() {}
+        template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+        T* allocate(std::size_t n)
+        {
+            //Allocate enough extra to move the start to the boundary, and keep the pointer to free just before the aligned block
+            void* raw = std::malloc(n*sizeof(T) + Alignment + sizeof(void*));
+            if (raw == 0) {
+                throw std::bad_alloc();
+            }
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = raw;
+            return reinterpret_cast<T*>(aligned);
+        }
+
+        void deallocate(T* p, std::size_t)
+        {
+            if (p) {
+                std::free(reinterpret_cast<void**>(p)[-1]);
+            }
+        }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return true;}
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return false;}
+
+#endif
@@ -25,7 +25,7 @@
 
 //using namespace irr;
 
-Buoy::Buoy(const std::string& name, const irr::core::vector3df& location, irr::f32 radarCrossSection, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev)
+Buoy::Buoy(const std::string& name, const irr::core::vector3df& location, irr::f32 radarCrossSection, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev)
 {
 
     std::string basePath = "Models/Buoy/" + name + "/";
@@ -55,9 +55,9 @@ Buoy::Buoy(const std::string& name, const irr::core::vector3df& location, irr::f
         //Failed to load mesh - load with dummy and continue
         dev->getLogger()->log("Failed to load buoy model:");
         dev->getLogger()->log(buoyFullPath.c_str());
-        buoy = smgr->addCubeSceneNode(0.1);
+        buoy = smgr->addCubeSceneNode(0.1,parent,-1,location);
     } else {
-        buoy = smgr->addMeshSceneNode( buoyMesh, 0, -1, location );
+        buoy = smgr->addMeshSceneNode( buoyMesh, parent, -1, location );
     }
 
     //Set lighting to use diffuse and ambient, so lighting of untextured models works
@@ -95,7 +95,10 @@ irr::core::vector3df Buoy::getPosition() const
 
 void Buoy::setPosition(irr::core::vector3df position)
 {
-    buoy->setPosition(position);
+    //The scene node's own position is relative to its parent (the world node, which moves when the origin is moved)
+    irr::scene::ISceneNode* parent = buoy->getParent();
+    parent->updateAbsolutePosition();
+    buoy->setPosition(position - parent->getAbsolutePosition());
 }
 
 void Buoy::setRotation(irr::core::vector3df rotation)
@@ -168,12 +171,3 @@ RadarData Buoy::getRadarData(irr::core::vector3df scannerPosition) const
     return radarData;
 }
 
-void Buoy::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
-{
-    irr::core::vector3df currentPos = buoy->getPosition();
-    irr::f32 newPosX = currentPos.X + deltaX;
-    irr::f32 newPosY = currentPos.Y + deltaY;
-    irr::f32 newPosZ = currentPos.Z + deltaZ;
-
-    buoy->setPosition(irr::core::vector3df(newPosX,newPosY,newPosZ));
-}
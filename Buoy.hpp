@@ -27,16 +27,15 @@ struct RadarData;
 class Buoy
 {
     public:
-        Buoy(const std::string& name, const irr::core::vector3df& location, irr::f32 radarCrossSection, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev);
+        Buoy(const std::string& name, const irr::core::vector3df& location, irr::f32 radarCrossSection, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev);
         virtual ~Buoy();
         irr::core::vector3df getPosition() const;
-        void setPosition(irr::core::vector3df position);
+        void setPosition(irr::core::vector3df position); //Position relative to the origin, as from getPosition()
         void setRotation(irr::core::vector3df rotation);
         irr::f32 getLength() const;
         irr::f32 getHeight() const;
         irr::f32 getRCS() const;
         RadarData getRadarData(irr::core::vector3df scannerPosition) const;
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
         irr::scene::ISceneNode* getSceneNode() const;
     protected:
     private:
@@ -18,7 +18,7 @@
 
 #include "Buoy.hpp"
 #include "NavLight.hpp"
-#include "IniFile.hpp"
+#include "WorldPack.hpp"
 #include "Constants.hpp"
 #include "RadarData.hpp"
 #include "SimulationModel.hpp"
@@ -38,56 +38,53 @@ Buoys::~Buoys()
     buoysLights.clear();
 }
 
-void Buoys::load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, irr::IrrlichtDevice* dev)
+void Buoys::load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, irr::IrrlichtDevice* dev)
 {
-    this->model = model;
-
-    //get buoy.ini filename
-    std::string scenarioBuoyFilename = worldName;
-    scenarioBuoyFilename.append("/buoy.ini");
+    //Get buoy and light information from buoy.ini and light.ini
+    WorldPack worldData;
+    worldData.readBuoyIni(worldName);
+    worldData.readLightIni(worldName);
+    load(worldData, smgr, worldNode, model, dev);
+}
 
-    //get light.ini filename
-    std::string scenarioLightFilename = worldName;
-    scenarioLightFilename.append("/light.ini");
+void Buoys::load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, irr::IrrlichtDevice* dev)
+{
+    this->model = model;
 
-    //Find number of buoys
-    irr::u32 numberOfBuoys;
-    numberOfBuoys = IniFile::iniFileTou32(scenarioBuoyFilename,"Number");
-    for(irr::u32 currentBuoy=1;currentBuoy<=numberOfBuoys;currentBuoy++) {
+    for(irr::u32 currentBuoy=1;currentBuoy<=worldData.buoys.size();currentBuoy++) {
+        const WorldPackBuoy& buoyData = worldData.buoys.at(currentBuoy-1);
 
-        //Get buoy type and construct filename
-        std::string buoyName = IniFile::iniFileToString(scenarioBuoyFilename,IniFile::enumerate1("Type",currentBuoy));
+        //Get buoy type
+        std::string buoyName = buoyData.type;
         //Get buoy position
-        irr::f32 buoyX = model->longToX(IniFile::iniFileTof32(scenarioBuoyFilename,IniFile::enumerate1("Long",currentBuoy)));
-        irr::f32 buoyZ = model->latToZ(IniFile::iniFileTof32(scenarioBuoyFilename,IniFile::enumerate1("Lat",currentBuoy)));
+        irr::f32 buoyX = model->longToX(buoyData.longitude);
+        irr::f32 buoyZ = model->latToZ(buoyData.latitude);
 
         //get buoy RCS if set
-        irr::f32 rcs = IniFile::iniFileTof32(scenarioBuoyFilename,IniFile::enumerate1("RCS",currentBuoy));
+        irr::f32 rcs = buoyData.rcs;
 
         //Create buoy and load into vector
-        buoys.push_back(Buoy (buoyName.c_str(),irr::core::vector3df(buoyX,0.0f,buoyZ),rcs,smgr,dev));
+        buoys.push_back(Buoy (buoyName.c_str(),irr::core::vector3df(buoyX,0.0f,buoyZ),rcs,worldNode,smgr,dev));
 
         //Find scene node
         irr::scene::ISceneNode* buoyNode = buoys.back().getSceneNode();
 
         //Load buoy light information from light.ini file if available
 
-        //Find number of lights
-        irr::u32 numberOfLights;
-        numberOfLights = IniFile::iniFileTou32(scenarioLightFilename,"Number");
         //Run through lights, and check if any are associated with this buoy
-        for (irr::u32 currentLight=1;currentLight<=numberOfLights;currentLight++) {
-            if (IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Buoy",currentLight)) ==currentBuoy ) {
+        for (irr::u32 currentLight=0;currentLight<worldData.lights.size();currentLight++) {
+            const WorldPackLight& lightData = worldData.lights.at(currentLight);
+            if (lightData.buoy == currentBuoy) {
                 //Light on this buoy, add a light to the buoysLights vector in this location if required (FIXME: Think about response to waves?)
-                irr::f32 lightHeight = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Height",currentLight));
-                irr::u32 lightR = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Red",currentLight));
-                irr::u32 lightG = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Green",currentLight));
-                irr::u32 lightB = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Blue",currentLight));
-                irr::f32 lightRange = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Range",currentLight));
-                std::string lightSequence = IniFile::iniFileToString(scenarioLightFilename,IniFile::enumerate1("Sequence",currentLight));
-                irr::u32 phaseStart = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("PhaseStart",currentLight));
-                irr::f32 lightStart = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("StartAngle",currentLight));
-                irr::f32 lightEnd = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("EndAngle",currentLight));
+                irr::f32 lightHeight = lightData.height;
+                irr::u32 lightR = lightData.red;
+                irr::u32 lightG = lightData.green;
+                irr::u32 lightB = lightData.blue;
+                irr::f32 lightRange = lightData.range;
+                std::string lightSequence = lightData.sequence;
+                irr::u32 phaseStart = lightData.phaseStart;
+                irr::f32 lightStart = lightData.startAngle;
+                irr::f32 lightEnd = lightData.endAngle;
                 lightRange = lightRange * M_IN_NM;
 
                 //Scale height to adjust for buoy scaling (As buoy lights given absolute heights, so needs to be scaled to match parent)
@@ -103,20 +100,28 @@ void Buoys::load(const std::string& worldName, irr::scene::ISceneManager* smgr,
 
 void Buoys::update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel)
 {
-    for(std::vector<Buoy>::iterator it = buoys.begin(); it != buoys.end(); ++it) {
-        irr::f32 xPos, yPos, zPos;
-        irr::core::vector3df pos = it->getPosition();
-        xPos = pos.X;
-        yPos = tideHeight + model->getWaveHeight(pos.X,pos.Z);
-        zPos = pos.Z;
-        it->setPosition(irr::core::vector3df(xPos,yPos,zPos));
+    //Find the waves at all the buoys at once
+    buoyX.resize(buoys.size());
+    buoyZ.resize(buoys.size());
+    waveHeights.resize(buoys.size());
+    waveNormals.resize(buoys.size());
+    for(irr::u32 i = 0; i < buoys.size(); i++) {
+        irr::core::vector3df pos = buoys[i].getPosition();
+        buoyX[i] = pos.X;
+        buoyZ[i] = pos.Z;
+    }
+    if (!buoys.empty()) {
+        model->getWaveHeightsAndNormals(&buoyX[0],&buoyZ[0],&waveHeights[0],&waveNormals[0],buoys.size());
+    }
+
+    for(irr::u32 i = 0; i < buoys.size(); i++) {
+        buoys[i].setPosition(irr::core::vector3df(buoyX[i],tideHeight + waveHeights[i],buoyZ[i]));
 
         irr::f32 angleX, angleZ;
-        irr::core::vector2df normals = model->getLocalNormals(pos.X,pos.Z);
-        angleX = normals.X * irr::core::RADTODEG;//Assume small angle, so just convert rad to deg
-        angleZ = normals.Y * irr::core::RADTODEG;//Assume small angle, so just convert rad to deg
+        angleX = waveNormals[i].X * irr::core::RADTODEG;//Assume small angle, so just convert rad to deg
+        angleZ = waveNormals[i].Y * irr::core::RADTODEG;//Assume small angle, so just convert rad to deg
 
-        it->setRotation(irr::core::vector3df(angleX,0,angleZ));
+        buoys[i].setRotation(irr::core::vector3df(angleX,0,angleZ));
 
     }
 
@@ -156,11 +161,12 @@ irr::core::vector3df Buoys::getPosition(int number) const
 
 }
 
-void Buoys::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
+irr::scene::ISceneNode* Buoys::getSceneNode(int number) const
 {
-    for(std::vector<Buoy>::iterator it = buoys.begin(); it != buoys.end(); ++it) {
-        it->moveNode(deltaX,deltaY,deltaZ);
+    if (number < (int)buoys.size() && number >= 0) {
+        return buoys.at(number).getSceneNode();
+    } else {
+        return 0;
     }
-
-    //Note the light is a child of the buoy, so it moves with it
 }
+
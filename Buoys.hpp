@@ -27,23 +27,31 @@ class SimulationModel;
 class Buoy;
 class NavLight;
 struct RadarData;
+class WorldPack;
 
 class Buoys
 {
     public:
         Buoys();
         virtual ~Buoys();
-        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, irr::IrrlichtDevice* dev);
+        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, irr::IrrlichtDevice* dev);
+        void load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, irr::IrrlichtDevice* dev); //Buoys are added as children of worldNode
         void update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel);
         RadarData getRadarData(irr::u32 number, irr::core::vector3df scannerPosition) const;
         irr::u32 getNumber() const;
         irr::core::vector3df getPosition(int number) const;
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
+        irr::scene::ISceneNode* getSceneNode(int number) const;
 
     private:
         std::vector<Buoy> buoys;
         std::vector<NavLight*> buoysLights;
         SimulationModel* model; //Store reference to model
+
+        //Kept between updates to save reallocating: buoy positions, and the waves there
+        std::vector<irr::f32> buoyX;
+        std::vector<irr::f32> buoyZ;
+        std::vector<irr::f32> waveHeights;
+        std::vector<irr::core::vector2df> waveNormals;
 };
 
 #endif
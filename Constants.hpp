@@ -33,6 +33,16 @@ const irr::f32 EARTH_RAD_CORRECTION = 1.333; //Effective earth's radius for rada
 const irr::f32 PI = 3.1415926535897932384626433832795;
 const irr::f32 RAD_IN_DEG = PI/180.0;
 
+//simulation timing
+const irr::f32 DEFAULT_SIMULATION_RATE = 50; //Simulation steps per second of simulated time, if not set in bc5.ini
+const irr::f32 MAX_FULL_RATE_ACCELERATOR = 5; //Above this accelerator setting, the step is lengthened to keep the steps per real second bounded
+const irr::u32 MAX_SIMULATION_STEPS_PER_FRAME = 50; //If more are due (very slow frames), the extra time is dropped
+
+//distant ships and buoys
+const irr::u32 DEFAULT_IMPOSTOR_SIZE = 32; //Ships and buoys narrower than this on screen (pixels) are drawn as impostors, if not set in bc5.ini
+const irr::u32 IMPOSTOR_VIEWS = 16; //Directions each model's impostor images are rendered from
+const irr::u32 IMPOSTOR_VIEW_SIZE = 64; //Pixels, each impostor image
+
 //general definitions
 const std::string LONGNAME = "Bridge Command 5.4.2";
 const std::string VERSION = "5.4";
@@ -0,0 +1,450 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "ContactImpostors.hpp"
+#include "Constants.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+//using namespace irr;
+
+namespace
+{
+    const irr::u32 MAX_QUADS_PER_DRAW = 16384; //So the vertices can be indexed with u16
+    const irr::f32 IMPOSTOR_LIGHTING = 1.5; //Impostors are drawn at the ambient light times this, as the models are lit by ambient and the sun
+}
+
+ContactImpostors::ContactImpostors(irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::u32 impostorSize) :
+    irr::scene::ISceneNode(parent, smgr, -1)
+{
+    this->impostorSize = impostorSize;
+    numberOfImpostors = 0;
+
+    //The contacts are checked against the view one by one in render()
+    setAutomaticCulling(irr::scene::EAC_OFF);
+
+    //Vertices 0-3 of each quad are bottom right, top right, top left and bottom left, as for Irrlicht's billboards
+    quadIndices.resize(MAX_QUADS_PER_DRAW*6);
+    for (irr::u32 i = 0; i < MAX_QUADS_PER_DRAW; i++) {
+        quadIndices[i*6+0] = i*4+0;
+        quadIndices[i*6+1] = i*4+2;
+        quadIndices[i*6+2] = i*4+1;
+        quadIndices[i*6+3] = i*4+0;
+        quadIndices[i*6+4] = i*4+3;
+        quadIndices[i*6+5] = i*4+2;
+    }
+}
+
+ContactImpostors::~ContactImpostors()
+{
+    //The view textures belong to the video driver
+}
+
+void ContactImpostors::addContact(irr::scene::ISceneNode* contactNode)
+{
+    if (impostorSize == 0 || contactNode == 0) {
+        return; //Always drawn in full
+    }
+
+    irr::scene::IMesh* mesh = 0;
+    switch (contactNode->getType()) {
+        case irr::scene::ESNT_ANIMATED_MESH: {
+            irr::scene::IAnimatedMesh* animatedMesh = static_cast<irr::scene::IAnimatedMeshSceneNode*>(contactNode)->getMesh();
+            if (animatedMesh) {
+                mesh = animatedMesh->getMesh(0);
+            }
+            break;
+        }
+        case irr::scene::ESNT_MESH:
+        case irr::scene::ESNT_CUBE:
+        case irr::scene::ESNT_SPHERE:
+            mesh = static_cast<irr::scene::IMeshSceneNode*>(contactNode)->getMesh();
+            break;
+        default:
+            break;
+    }
+    if (mesh == 0) {
+        return; //Not a model we can make impostors of, so always drawn in full
+    }
+
+    //Contacts loaded from the same model file share the mesh, so share the impostor images too
+    irr::u32 modelNumber = 0;
+    while (modelNumber < models.size() && models[modelNumber].mesh != mesh) {
+        modelNumber++;
+    }
+    if (modelNumber == models.size()) {
+        ImpostorModel model;
+        model.mesh = mesh;
+
+        //Rendered in white ambient light only, and lit as a whole when drawn
+        for (irr::u32 i = 0; i < contactNode->getMaterialCount(); i++) {
+            model.meshMaterials.push_back(contactNode->getMaterial(i));
+            irr::video::SMaterial& material = model.meshMaterials.back();
+            material.FogEnable = false;
+            if (material.MaterialType == irr::video::EMT_TRANSPARENT_VERTEX_ALPHA) {
+                material.MaterialType = irr::video::EMT_SOLID; //Other ship models are set to this, but are opaque
+            }
+        }
+
+        irr::core::aabbox3df meshBox = mesh->getBoundingBox();
+        irr::core::vector3df extent = meshBox.getExtent();
+        model.centre = meshBox.getCenter();
+        model.radius = 0.5*std::sqrt(extent.X*extent.X + extent.Z*extent.Z);
+        model.height = extent.Y;
+        model.viewsTried = false;
+
+        model.material.MaterialType = irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+        model.material.Lighting = false;
+        model.material.FogEnable = true;
+        model.material.BackfaceCulling = false;
+        model.material.TextureLayer[0].TextureWrapU = irr::video::ETC_CLAMP_TO_EDGE;
+        model.material.TextureLayer[0].TextureWrapV = irr::video::ETC_CLAMP_TO_EDGE;
+
+        models.push_back(model);
+    }
+
+    ImpostorContact contact;
+    contact.node = contactNode;
+    contact.model = modelNumber;
+    contact.detail = DETAIL_MODEL;
+    models[modelNumber].contacts.push_back(contacts.size());
+    contacts.push_back(contact);
+}
+
+irr::u32 ContactImpostors::getNumberOfImpostors() const
+{
+    return numberOfImpostors;
+}
+
+void ContactImpostors::OnAnimate(irr::u32 timeMs)
+{
+    if (IsVisible) {
+        //Render the views of any new models. This is the first thing done in drawAll(), so another render target isn't in use.
+        for (irr::u32 i = 0; i < models.size(); i++) {
+            if (!models[i].viewsTried) {
+                renderViews(models[i], i);
+                models[i].viewsTried = true;
+            }
+        }
+
+        chooseDetail();
+    }
+
+    ISceneNode::OnAnimate(timeMs);
+}
+
+void ContactImpostors::OnRegisterSceneNode()
+{
+    //The impostors are drawn with the solid nodes, so they hide what's behind them. The nav lights are drawn with the transparent
+    //nodes, sorted as if at the nearest impostor (see chooseDetail()), so nearer ships drawn in full still go in front of them.
+    if (IsVisible && numberOfImpostors > 0) {
+        SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_SOLID);
+        SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_TRANSPARENT);
+    }
+
+    ISceneNode::OnRegisterSceneNode();
+}
+
+void ContactImpostors::render()
+{
+    irr::scene::ICameraSceneNode* camera = SceneManager->getActiveCamera();
+    if (camera == 0) {
+        return;
+    }
+
+    SceneManager->getVideoDriver()->setTransform(irr::video::ETS_WORLD, irr::core::IdentityMatrix);
+    if (SceneManager->getSceneNodeRenderPass() == irr::scene::ESNRP_SOLID) {
+        renderImpostors(camera);
+    } else {
+        renderLights(camera);
+    }
+}
+
+void ContactImpostors::renderImpostors(irr::scene::ICameraSceneNode* camera)
+{
+    const irr::scene::SViewFrustum* frustum = camera->getViewFrustum();
+    irr::core::vector3df cameraPosition = camera->getAbsolutePosition();
+
+    //Lit by the scene's ambient light, and the sun, which is set to the same
+    irr::video::SColorf ambient = SceneManager->getAmbientLight();
+    irr::video::SColor impostorColour(255,
+                                      std::min(255.f, 255*ambient.r*IMPOSTOR_LIGHTING),
+                                      std::min(255.f, 255*ambient.g*IMPOSTOR_LIGHTING),
+                                      std::min(255.f, 255*ambient.b*IMPOSTOR_LIGHTING));
+
+    //The impostors, in one batch per model
+    for (irr::u32 i = 0; i < models.size(); i++) {
+        const ImpostorModel& model = models[i];
+        if (model.material.getTexture(0) == 0) {
+            continue;
+        }
+
+        vertices.clear();
+        for (irr::u32 j = 0; j < model.contacts.size(); j++) {
+            const ImpostorContact& contact = contacts[model.contacts[j]];
+            if (contact.detail != DETAIL_IMPOSTOR) {
+                continue;
+            }
+
+            const irr::core::matrix4& transform = contact.node->getAbsoluteTransformation();
+            irr::core::vector3df scale = transform.getScale();
+            irr::core::vector3df centre = model.centre;
+            transform.transformVect(centre);
+            irr::f32 halfWidth = model.radius*scale.X;
+            irr::f32 halfHeight = 0.5*model.height*scale.Y;
+
+            //Skip if outside the view
+            irr::f32 cullRadius = std::max(halfWidth, halfHeight);
+            bool inView = true;
+            for (irr::u32 plane = 0; plane < irr::scene::SViewFrustum::VF_PLANE_COUNT; plane++) {
+                if (frustum->planes[plane].getDistanceTo(centre) > cullRadius) {
+                    inView = false;
+                    break;
+                }
+            }
+            if (!inView) {
+                continue;
+            }
+
+            //Pick the view closest to the direction from the model to the camera, in the model's own coordinates
+            irr::core::matrix4 inverse;
+            transform.getInverse(inverse);
+            irr::core::vector3df localCamera = cameraPosition;
+            inverse.transformVect(localCamera);
+            localCamera -= model.centre;
+            irr::f32 viewAngle = std::atan2(localCamera.X, localCamera.Z); //Radians, -PI to PI
+            irr::s32 view = irr::core::round32(viewAngle*IMPOSTOR_VIEWS/(2*irr::core::PI));
+            view = (view + IMPOSTOR_VIEWS) % IMPOSTOR_VIEWS;
+
+            //Upright, and turned to face the camera
+            irr::core::vector3df toContact = centre - cameraPosition;
+            irr::core::vector3df horizontal(toContact.Z, 0, -toContact.X);
+            if (horizontal.getLength() == 0) {
+                horizontal.set(1, 0, 0); //Looking straight down
+            }
+            horizontal.setLength(halfWidth);
+            irr::core::vector3df vertical(0, -halfHeight, 0); //Pointing down
+            irr::core::vector3df normal = -toContact;
+            normal.normalize();
+
+            //Inset half a pixel, so the neighbouring views don't show at the edges
+            irr::f32 leftU = (view*IMPOSTOR_VIEW_SIZE + 0.5)/(IMPOSTOR_VIEWS*IMPOSTOR_VIEW_SIZE);
+            irr::f32 rightU = ((view+1)*IMPOSTOR_VIEW_SIZE - 0.5)/(IMPOSTOR_VIEWS*IMPOSTOR_VIEW_SIZE);
+
+            vertices.push_back(irr::video::S3DVertex(centre + horizontal + vertical, normal, impostorColour, irr::core::vector2df(rightU, 1)));
+            vertices.push_back(irr::video::S3DVertex(centre + horizontal - vertical, normal, impostorColour, irr::core::vector2df(rightU, 0)));
+            vertices.push_back(irr::video::S3DVertex(centre - horizontal - vertical, normal, impostorColour, irr::core::vector2df(leftU, 0)));
+            vertices.push_back(irr::video::S3DVertex(centre - horizontal + vertical, normal, impostorColour, irr::core::vector2df(leftU, 1)));
+        }
+        drawQuads(model.material);
+    }
+}
+
+void ContactImpostors::renderLights(irr::scene::ICameraSceneNode* camera)
+{
+    //The nav lights on all the impostors, in one batch. These all share the same material. Their sizes, colours and visibility
+    //are set in NavLight::update() as usual.
+    irr::core::vector3df cameraPosition = camera->getAbsolutePosition();
+    irr::core::vector3df view = camera->getTarget() - cameraPosition;
+    view.normalize();
+    irr::core::vector3df horizontal = camera->getUpVector().crossProduct(view);
+    if (horizontal.getLength() == 0) {
+        horizontal.set(camera->getUpVector().Y, camera->getUpVector().X, camera->getUpVector().Z);
+    }
+    horizontal.normalize();
+    irr::core::vector3df vertical = horizontal.crossProduct(view); //Pointing down
+    vertical.normalize();
+    irr::core::vector3df normal = -view;
+
+    const irr::video::SMaterial* lightMaterial = 0;
+    vertices.clear();
+    for (irr::u32 i = 0; i < contacts.size(); i++) {
+        if (contacts[i].detail != DETAIL_IMPOSTOR) {
+            continue;
+        }
+        const irr::core::list<irr::scene::ISceneNode*>& children = contacts[i].node->getChildren();
+        for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it) {
+            if ((*it)->getType() != irr::scene::ESNT_BILLBOARD || !(*it)->isVisible()) {
+                continue;
+            }
+            irr::scene::IBillboardSceneNode* light = static_cast<irr::scene::IBillboardSceneNode*>(*it);
+            light->updateAbsolutePosition(); //Not updated while its parent is hidden
+            irr::core::vector3df position = light->getAbsolutePosition();
+            irr::core::vector3df lightHorizontal = horizontal*0.5*light->getSize().Width;
+            irr::core::vector3df lightVertical = vertical*0.5*light->getSize().Height;
+            irr::video::SColor topColour;
+            irr::video::SColor bottomColour;
+            light->getColor(topColour, bottomColour);
+            if (lightMaterial == 0) {
+                lightMaterial = &light->getMaterial(0);
+            }
+
+            vertices.push_back(irr::video::S3DVertex(position + lightHorizontal + lightVertical, normal, bottomColour, irr::core::vector2df(1, 1)));
+            vertices.push_back(irr::video::S3DVertex(position + lightHorizontal - lightVertical, normal, topColour, irr::core::vector2df(1, 0)));
+            vertices.push_back(irr::video::S3DVertex(position - lightHorizontal - lightVertical, normal, topColour, irr::core::vector2df(0, 0)));
+            vertices.push_back(irr::video::S3DVertex(position - lightHorizontal + lightVertical, normal, bottomColour, irr::core::vector2df(0, 1)));
+        }
+    }
+    if (lightMaterial) {
+        drawQuads(*lightMaterial);
+    }
+}
+
+const irr::core::aabbox3d<irr::f32>& ContactImpostors::getBoundingBox() const
+{
+    return box;
+}
+
+void ContactImpostors::renderViews(ImpostorModel& model, irr::u32 modelNumber)
+{
+    irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+    if (model.radius <= 0 || model.height <= 0 || !driver->queryFeature(irr::video::EVDF_RENDER_TO_TARGET)) {
+        return; //Contacts using the model will always be drawn in full
+    }
+
+    irr::io::path textureName = "ContactImpostors";
+    textureName += irr::io::path(modelNumber);
+    irr::video::ITexture* views = driver->addRenderTargetTexture(irr::core::dimension2d<irr::u32>(IMPOSTOR_VIEWS*IMPOSTOR_VIEW_SIZE, IMPOSTOR_VIEW_SIZE), textureName);
+    if (views == 0) {
+        return;
+    }
+
+    irr::core::rect<irr::s32> currentViewPort = driver->getViewPort(); //Get the previous viewPort
+
+    //The scene's lights are set again when it's drawn
+    driver->deleteAllDynamicLights();
+    driver->setAmbientLight(irr::video::SColorf(1,1,1));
+
+    //Transparent background, grey so the edges don't darken when the impostors are filtered
+    driver->setRenderTarget(views, irr::video::ECBF_COLOR|irr::video::ECBF_DEPTH, irr::video::SColor(0,128,128,128));
+
+    //Looking horizontally at the model from outside it, with an orthographic projection just big enough for it from any direction
+    irr::f32 distance = 2*(model.radius + model.height) + 1;
+    irr::core::matrix4 projection;
+    projection.buildProjectionMatrixOrthoLH(2*model.radius, model.height, 0, 2*distance);
+    driver->setTransform(irr::video::ETS_PROJECTION, projection);
+
+    for (irr::u32 i = 0; i < IMPOSTOR_VIEWS; i++) {
+        driver->setViewPort(irr::core::rect<irr::s32>(i*IMPOSTOR_VIEW_SIZE, 0, (i+1)*IMPOSTOR_VIEW_SIZE, IMPOSTOR_VIEW_SIZE));
+
+        //From the direction that render() picks this view for
+        irr::f32 viewAngle = 2*irr::core::PI*i/IMPOSTOR_VIEWS;
+        irr::core::vector3df cameraPosition = model.centre + distance*irr::core::vector3df(std::sin(viewAngle), 0, std::cos(viewAngle));
+        irr::core::matrix4 view;
+        view.buildCameraLookAtMatrixLH(cameraPosition, model.centre, irr::core::vector3df(0,1,0));
+        driver->setTransform(irr::video::ETS_VIEW, view);
+        driver->setTransform(irr::video::ETS_WORLD, irr::core::IdentityMatrix); //After the view, as the software renderers combine them here
+
+        for (irr::u32 j = 0; j < model.mesh->getMeshBufferCount(); j++) {
+            irr::scene::IMeshBuffer* meshBuffer = model.mesh->getMeshBuffer(j);
+            if (j < model.meshMaterials.size()) {
+                driver->setMaterial(model.meshMaterials[j]);
+            } else {
+                driver->setMaterial(meshBuffer->getMaterial());
+            }
+            driver->drawMeshBuffer(meshBuffer);
+        }
+    }
+
+    //set back old render target and viewport
+    driver->setRenderTarget(0, 0);
+    driver->setViewPort(currentViewPort);
+
+    model.material.setTexture(0, views);
+}
+
+void ContactImpostors::chooseDetail()
+{
+    numberOfImpostors = 0;
+
+    irr::scene::ICameraSceneNode* camera = SceneManager->getActiveCamera();
+    if (camera == 0) {
+        return; //Leave as they are
+    }
+    camera->updateAbsolutePosition();
+    irr::core::vector3df cameraPosition = camera->getAbsolutePosition();
+    irr::f32 farValue = camera->getFarValue();
+
+    //Pixels on screen for each metre wide at one metre away, from the horizontal field of view (so zooming in shows the full models)
+    irr::f32 pixelScale = SceneManager->getVideoDriver()->getViewPort().getWidth() / (2*std::tan(camera->getFOV()/2)*camera->getAspectRatio());
+
+    irr::core::vector3df nearestImpostor;
+    irr::f32 nearestImpostorDistance = 0;
+
+    for (irr::u32 i = 0; i < contacts.size(); i++) {
+        ImpostorContact& contact = contacts[i];
+        const ImpostorModel& model = models[contact.model];
+
+        //Its parent has already been animated, but the contact itself is skipped while hidden
+        contact.node->updateAbsolutePosition();
+        const irr::core::matrix4& transform = contact.node->getAbsoluteTransformation();
+        irr::core::vector3df centre = model.centre;
+        transform.transformVect(centre);
+        irr::f32 width = 2*model.radius*transform.getScale().X;
+        irr::f32 distance = centre.getDistanceFrom(cameraPosition);
+
+        DETAIL detail = DETAIL_MODEL;
+        if (distance - width > farValue) {
+            detail = DETAIL_NONE;
+        } else if (model.material.getTexture(0) && width*pixelScale < impostorSize*distance) {
+            detail = DETAIL_IMPOSTOR;
+            if (numberOfImpostors == 0 || distance < nearestImpostorDistance) {
+                nearestImpostor = centre;
+                nearestImpostorDistance = distance;
+            }
+            numberOfImpostors++;
+        }
+        contact.detail = detail;
+
+        bool showModel = (detail == DETAIL_MODEL);
+        if (contact.node->isVisible() != showModel) {
+            contact.node->setVisible(showModel);
+            if (showModel) {
+                updateChildPositions(contact.node); //Before they're drawn
+            }
+        }
+    }
+
+    //The transparent nodes are sorted by their distance from the camera, so put this where the nav lights will be sorted to.
+    //The absolute position is updated after this in OnAnimate(). The vertices are all in world coordinates, so aren't moved.
+    if (numberOfImpostors > 0) {
+        setPosition(nearestImpostor - Parent->getAbsolutePosition());
+    }
+}
+
+void ContactImpostors::updateChildPositions(irr::scene::ISceneNode* node)
+{
+    const irr::core::list<irr::scene::ISceneNode*>& children = node->getChildren();
+    for (irr::core::list<irr::scene::ISceneNode*>::ConstIterator it = children.begin(); it != children.end(); ++it) {
+        (*it)->updateAbsolutePosition();
+        updateChildPositions(*it);
+    }
+}
+
+void ContactImpostors::drawQuads(const irr::video::SMaterial& material)
+{
+    if (vertices.empty()) {
+        return;
+    }
+
+    irr::video::IVideoDriver* driver = SceneManager->getVideoDriver();
+    driver->setMaterial(material);
+    for (irr::u32 first = 0; first < vertices.size(); first += MAX_QUADS_PER_DRAW*4) {
+        irr::u32 vertexCount = std::min<irr::u32>(vertices.size() - first, MAX_QUADS_PER_DRAW*4);
+        driver->drawIndexedTriangleList(&vertices[first], vertexCount, &quadIndices[0], vertexCount/2);
+    }
+}
@@ -0,0 +1,86 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __CONTACTIMPOSTORS_HPP_INCLUDED__
+#define __CONTACTIMPOSTORS_HPP_INCLUDED__
+
+#include "irrlicht.h"
+
+#include <vector>
+
+//Draws ships and buoys that are small on screen as impostors: flat images of their model, turned to face the camera. All the
+//impostors of one model are drawn together in a single batch, and the nav lights on them in one more, so many distant contacts
+//cost a few draw calls instead of several each. Each contact keeps its own scene node, which is shown as normal when the contact
+//is bigger than impostorSize pixels across, and hidden otherwise. Contacts beyond the camera's far value are not drawn at all.
+//The images are rendered from each model the first time the scene is drawn, from IMPOSTOR_VIEWS directions around it. This is a
+//scene node, so the choice is made again for each camera the scene is drawn from (including the water's reflection).
+class ContactImpostors : public irr::scene::ISceneNode
+{
+    public:
+        ContactImpostors(irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::u32 impostorSize); //impostorSize 0 to always draw the full models
+        virtual ~ContactImpostors();
+        void addContact(irr::scene::ISceneNode* contactNode); //A ship or buoy's mesh scene node, with any nav lights as billboard children
+        irr::u32 getNumberOfImpostors() const; //In the last scene drawn
+
+        virtual void OnAnimate(irr::u32 timeMs);
+        virtual void OnRegisterSceneNode();
+        virtual void render();
+        virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const;
+
+    private:
+        enum DETAIL
+        {
+            DETAIL_MODEL = 0,
+            DETAIL_IMPOSTOR = 1,
+            DETAIL_NONE = 2
+        };
+
+        struct ImpostorModel {
+            irr::scene::IMesh* mesh;
+            std::vector<irr::video::SMaterial> meshMaterials; //From the first contact using the model, to render the views with
+            irr::video::SMaterial material; //For the impostors, with the views as its texture (0 until rendered, or if they can't be)
+            irr::core::vector3df centre; //Of the mesh bounding box, in model units
+            irr::f32 radius; //Half the horizontal diagonal of the bounding box, so the model fits in any view
+            irr::f32 height;
+            bool viewsTried;
+            std::vector<irr::u32> contacts; //Using this model
+        };
+
+        struct ImpostorContact {
+            irr::scene::ISceneNode* node;
+            irr::u32 model;
+            DETAIL detail;
+        };
+
+        void renderViews(ImpostorModel& model, irr::u32 modelNumber); //Into a new render target texture
+        void chooseDetail(); //For the active camera
+        void renderImpostors(irr::scene::ICameraSceneNode* camera);
+        void renderLights(irr::scene::ICameraSceneNode* camera);
+        void updateChildPositions(irr::scene::ISceneNode* node); //As skipped while hidden
+        void drawQuads(const irr::video::SMaterial& material); //The quads in vertices, in as few draw calls as possible
+
+        irr::u32 impostorSize;
+        std::vector<ImpostorModel> models;
+        std::vector<ImpostorContact> contacts;
+        irr::u32 numberOfImpostors;
+        irr::core::aabbox3d<irr::f32> box; //Not used, as the contacts are culled one by one
+
+        //Kept between frames to save reallocating
+        std::vector<irr::video::S3DVertex> vertices;
+        std::vector<irr::u16> quadIndices; //Two triangles for each quad, enough for the most drawn at once
+};
+
+#endif
@@ -27,6 +27,7 @@ SOFTWARE.
 #include <sstream>
 #include <fstream>
 #include <cstdlib> //For rand()
+#include <algorithm>
 #include <iostream>
 
 #ifndef M_PI
@@ -51,25 +52,19 @@ double cTimer::elapsed(bool frame) {
 	return elapsed;
 }
 */
-unsigned int complex::additions = 0;
-unsigned int complex::multiplications = 0;
-
 complex::complex() : a(0.0f), b(0.0f) { }
 complex::complex(float a, float b) : a(a), b(b) { }
 complex complex::conj() { return complex(this->a, -this->b); }
 
 complex complex::operator*(const complex& c) const {
-	complex::multiplications++;
 	return complex(this->a*c.a - this->b*c.b, this->a*c.b + this->b*c.a);
 }
 
 complex complex::operator+(const complex& c) const {
-	complex::additions++;
 	return complex(this->a + c.a, this->b + c.b);
 }
 
 complex complex::operator-(const complex& c) const {
-	complex::additions++;
 	return complex(this->a - c.a, this->b - c.b);
 }
 
@@ -86,11 +81,6 @@ complex& complex::operator=(const complex& c) {
 	return *this;
 }
 
-void complex::reset() {
-	complex::additions = 0;
-	complex::multiplications = 0;
-}
-
 vector3::vector3() : x(0.0f), y(0.0f), z(0.0f) { }
 vector3::vector3(float x, float y, float z) : x(x), y(y), z(z) { }
 
@@ -163,77 +153,228 @@ vector2 vector2::unit() {
 	return vector2(this->x/l, this->y/l);
 }
 
-cFFT::cFFT(unsigned int N) : N(N), reversed(0), T(0), pi2(2 * M_PI) {
-	c[0] = c[1] = 0;
-
-	log_2_N = log(N)/log(2);
+cFFT2D::cFFT2D(unsigned int N, unsigned int fields, unsigned int threads) :
+	N(N), fields(fields), width(fields * N), current(0), columnStages(0),
+	pass(PASS_COLUMNS), passNumber(0), helpersRunning(0), helpersStopRequested(false)
+{
+	for (unsigned int i = 0; i < 2; i++) {
+		re[i].assign(width * N, 0.0f);
+		im[i].assign(width * N, 0.0f);
+	}
 
-	reversed = new unsigned int[N];		// prep bit reversals
-	for (unsigned int i = 0; i < N; i++) reversed[i] = reverse(i);
+	// Twiddles for each radix-4 stage, w = exp(+2 pi i / n) for the stage's sub-transform length n
+	unsigned int n = N;
+	for (; n >= 4; n /= 4) {
+		unsigned int m = n / 4;
+		floatArray wr(3 * m), wi(3 * m);
+		for (unsigned int p = 0; p < m; p++) {
+			for (unsigned int k = 1; k <= 3; k++) {
+				double angle = 2.0 * M_PI * k * p / n;
+				wr[3 * p + k - 1] = cos(angle);
+				wi[3 * p + k - 1] = sin(angle);
+			}
+		}
+		twiddleRe.push_back(wr);
+		twiddleIm.push_back(wi);
+		columnStages++;
+	}
+	if (n == 2) {
+		columnStages++; // radix-2 stage
+	}
 
-	int pow2 = 1;
-	T = new complex*[log_2_N];		// prep T
-	for (unsigned int i = 0; i < log_2_N; i++) {
-		T[i] = new complex[pow2];
-		for (int j = 0; j < pow2; j++) T[i][j] = t(j, pow2 * 2);
-		pow2 *= 2;
+	for (unsigned int part = 1; part < threads; part++) {
+		helpers.push_back(std::thread(&cFFT2D::helperLoop, this, part));
 	}
+}
 
-	c[0] = new complex[N];
-	c[1] = new complex[N];
-	which = 0;
+cFFT2D::~cFFT2D() {
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		helpersStopRequested = true;
+	}
+	passStartCondition.notify_all();
+	for (unsigned int i = 0; i < helpers.size(); i++) {
+		helpers[i].join();
+	}
 }
 
-cFFT::~cFFT() {
-	if (c[0]) delete [] c[0];
-	if (c[1]) delete [] c[1];
-	if (T) {
-		for (unsigned int i = 0; i < log_2_N; i++) if (T[i]) delete [] T[i];
-		delete [] T;
+void cFFT2D::radix4Stage(unsigned int stage, unsigned int n, unsigned int s, unsigned int from, unsigned int firstColumn, unsigned int endColumn) {
+	// Stockham radix-4 stage for sub-transforms of length n, with s of them interleaved, from re/im[from] to the other buffer.
+	// Each element is a row (or the part of it from firstColumn to endColumn), so the butterflies are done for every column at once.
+	const unsigned int m = n / 4;
+	const float* xr = &re[from][firstColumn];
+	const float* xi = &im[from][firstColumn];
+	float* yr = &re[from ^ 1][firstColumn];
+	float* yi = &im[from ^ 1][firstColumn];
+	const unsigned int columns = endColumn - firstColumn;
+
+	for (unsigned int p = 0; p < m; p++) {
+		const float w1r = twiddleRe[stage][3 * p],     w1i = twiddleIm[stage][3 * p];
+		const float w2r = twiddleRe[stage][3 * p + 1], w2i = twiddleIm[stage][3 * p + 1];
+		const float w3r = twiddleRe[stage][3 * p + 2], w3i = twiddleIm[stage][3 * p + 2];
+		for (unsigned int q = 0; q < s; q++) {
+			const float* __restrict ar = xr + (q + s * p) * width;
+			const float* __restrict ai = xi + (q + s * p) * width;
+			const float* __restrict br = xr + (q + s * (p + m)) * width;
+			const float* __restrict bi = xi + (q + s * (p + m)) * width;
+			const float* __restrict cr = xr + (q + s * (p + 2 * m)) * width;
+			const float* __restrict ci = xi + (q + s * (p + 2 * m)) * width;
+			const float* __restrict dr = xr + (q + s * (p + 3 * m)) * width;
+			const float* __restrict di = xi + (q + s * (p + 3 * m)) * width;
+			float* __restrict y0r = yr + (q + s * (4 * p)) * width;
+			float* __restrict y0i = yi + (q + s * (4 * p)) * width;
+			float* __restrict y1r = yr + (q + s * (4 * p + 1)) * width;
+			float* __restrict y1i = yi + (q + s * (4 * p + 1)) * width;
+			float* __restrict y2r = yr + (q + s * (4 * p + 2)) * width;
+			float* __restrict y2i = yi + (q + s * (4 * p + 2)) * width;
+			float* __restrict y3r = yr + (q + s * (4 * p + 3)) * width;
+			float* __restrict y3i = yi + (q + s * (4 * p + 3)) * width;
+
+			for (unsigned int col = 0; col < columns; col++) {
+				const float apcr = ar[col] + cr[col], apci = ai[col] + ci[col];
+				const float amcr = ar[col] - cr[col], amci = ai[col] - ci[col];
+				const float bpdr = br[col] + dr[col], bpdi = bi[col] + di[col];
+				const float bmdr = br[col] - dr[col], bmdi = bi[col] - di[col];
+
+				// i * (b - d) is added for output 1 and subtracted for output 3, as the transform is exp(+i...)
+				const float t1r = amcr - bmdi, t1i = amci + bmdr;
+				const float t2r = apcr - bpdr, t2i = apci - bpdi;
+				const float t3r = amcr + bmdi, t3i = amci - bmdr;
+
+				y0r[col] = apcr + bpdr;
+				y0i[col] = apci + bpdi;
+				y1r[col] = t1r * w1r - t1i * w1i;
+				y1i[col] = t1r * w1i + t1i * w1r;
+				y2r[col] = t2r * w2r - t2i * w2i;
+				y2i[col] = t2r * w2i + t2i * w2r;
+				y3r[col] = t3r * w3r - t3i * w3i;
+				y3i[col] = t3r * w3i + t3i * w3r;
+			}
+		}
 	}
-	if (reversed) delete [] reversed;
 }
 
-unsigned int cFFT::reverse(unsigned int i) {
-	unsigned int res = 0;
-	for (unsigned int j = 0; j < log_2_N; j++) {
-		res = (res << 1) + (i & 1);
-		i >>= 1;
+void cFFT2D::radix2Stage(unsigned int s, unsigned int from, unsigned int firstColumn, unsigned int endColumn) {
+	// Last stage when N is an odd power of 2: sub-transforms of length 2, so no twiddles
+	const float* xr = &re[from][firstColumn];
+	const float* xi = &im[from][firstColumn];
+	float* yr = &re[from ^ 1][firstColumn];
+	float* yi = &im[from ^ 1][firstColumn];
+	const unsigned int columns = endColumn - firstColumn;
+
+	for (unsigned int q = 0; q < s; q++) {
+		const float* __restrict ar = xr + q * width;
+		const float* __restrict ai = xi + q * width;
+		const float* __restrict br = xr + (q + s) * width;
+		const float* __restrict bi = xi + (q + s) * width;
+		float* __restrict y0r = yr + q * width;
+		float* __restrict y0i = yi + q * width;
+		float* __restrict y1r = yr + (q + s) * width;
+		float* __restrict y1i = yi + (q + s) * width;
+
+		for (unsigned int col = 0; col < columns; col++) {
+			y0r[col] = ar[col] + br[col];
+			y0i[col] = ai[col] + bi[col];
+			y1r[col] = ar[col] - br[col];
+			y1i[col] = ai[col] - bi[col];
+		}
 	}
-	return res;
 }
 
-complex cFFT::t(unsigned int x, unsigned int N) {
-	return complex(cos(pi2 * x / N), sin(pi2 * x / N));
+void cFFT2D::columnPass(unsigned int firstColumn, unsigned int endColumn) {
+	unsigned int n = N;
+	unsigned int s = 1;
+	unsigned int stage = 0;
+	unsigned int from = current;
+	while (n >= 4) {
+		radix4Stage(stage, n, s, from, firstColumn, endColumn);
+		n /= 4;
+		s *= 4;
+		stage++;
+		from ^= 1;
+	}
+	if (n == 2) {
+		radix2Stage(s, from, firstColumn, endColumn);
+	}
 }
 
-void cFFT::fft(complex* input, complex* output, int stride, int offset) {
-	for (unsigned int i = 0; i < N; i++) c[which][i] = input[reversed[i] * stride + offset];
+void cFFT2D::transposeFields(unsigned int firstRow, unsigned int endRow) {
+	const float* xr = &re[current][0];
+	const float* xi = &im[current][0];
+	float* yr = &re[current ^ 1][0];
+	float* yi = &im[current ^ 1][0];
 
-	int loops       = N>>1;
-	int size        = 1<<1;
-	int size_over_2 = 1;
-	int w_          = 0;
-	for (unsigned int i = 1; i <= log_2_N; i++) {
-		which ^= 1;
-		for (int j = 0; j < loops; j++) {
-			for (int k = 0; k < size_over_2; k++) {
-				c[which][size * j + k] =  c[which^1][size * j + k] +
-							  c[which^1][size * j + size_over_2 + k] * T[w_][k];
+	for (unsigned int f = 0; f < fields; f++) {
+		for (unsigned int row = firstRow; row < endRow; row++) {
+			for (unsigned int col = 0; col < N; col++) {
+				yr[row * width + f * N + col] = xr[col * width + f * N + row];
+				yi[row * width + f * N + col] = xi[col * width + f * N + row];
 			}
+		}
+	}
+}
 
-			for (int k = size_over_2; k < size; k++) {
-				c[which][size * j + k] =  c[which^1][size * j - size_over_2 + k] -
-							  c[which^1][size * j + k] * T[w_][k - size_over_2];
-			}
+void cFFT2D::runPart(Pass pass, unsigned int part) {
+	const unsigned int parts = helpers.size() + 1;
+	if (pass == PASS_COLUMNS) {
+		// Blocks of whole cache lines, so the threads don't write to the same ones
+		unsigned int block = ((width + parts - 1) / parts + 15) & ~15u;
+		unsigned int firstColumn = std::min(part * block, width);
+		unsigned int endColumn = std::min(firstColumn + block, width);
+		if (firstColumn < endColumn) columnPass(firstColumn, endColumn);
+	} else {
+		unsigned int block = (N + parts - 1) / parts;
+		unsigned int firstRow = std::min(part * block, N);
+		unsigned int endRow = std::min(firstRow + block, N);
+		if (firstRow < endRow) transposeFields(firstRow, endRow);
+	}
+}
+
+void cFFT2D::runPass(Pass pass) {
+	if (helpers.empty()) {
+		runPart(pass, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		this->pass = pass;
+		passNumber++;
+		helpersRunning = helpers.size();
+	}
+	passStartCondition.notify_all();
+	runPart(pass, 0);
+
+	std::unique_lock<std::mutex> lock(poolMutex);
+	passDoneCondition.wait(lock, [this]{ return helpersRunning == 0; });
+}
+
+void cFFT2D::helperLoop(unsigned int part) {
+	unsigned int lastPassNumber = 0;
+	std::unique_lock<std::mutex> lock(poolMutex);
+	while (true) {
+		passStartCondition.wait(lock, [this, lastPassNumber]{ return helpersStopRequested || passNumber != lastPassNumber; });
+		if (helpersStopRequested) return;
+		lastPassNumber = passNumber;
+		Pass thisPass = pass;
+
+		lock.unlock();
+		runPart(thisPass, part);
+		lock.lock();
+
+		if (--helpersRunning == 0) {
+			passDoneCondition.notify_one();
 		}
-		loops       >>= 1;
-		size        <<= 1;
-		size_over_2 <<= 1;
-		w_++;
 	}
+}
 
-	for (unsigned int i = 0; i < N; i++) output[i * stride + offset] = c[which][i];
+void cFFT2D::transform() {
+	for (unsigned int i = 0; i < 2; i++) {
+		runPass(PASS_COLUMNS);
+		current ^= columnStages & 1;
+		runPass(PASS_TRANSPOSE);
+		current ^= 1;
+	}
 }
 
 //MAIN WAVE CODE:
@@ -253,37 +394,19 @@ complex cOcean::gaussianRandomVariable() {
 	return complex(x1 * w, x2 * w);
 }
 
-cOcean::cOcean(const int N, const float A, const vector2 w, const float length) :
+cOcean::cOcean(const int N, const float A, const vector2 w, const float length, const unsigned int fftThreads) :
 	g(9.81), N(N), Nplus1(N+1), A(A), w(w), length(length),
-	vertices(0), h_tilde(0), h_tilde_slopex(0), h_tilde_slopez(0), h_tilde_dx(0), h_tilde_dz(0), fft(0)
+	vertices(0), fft(0)
 {
-	h_tilde        = new complex[N*N];
-	h_tilde_slopex = new complex[N*N];
-	h_tilde_slopez = new complex[N*N];
-	h_tilde_dx     = new complex[N*N];
-	h_tilde_dz     = new complex[N*N];
-	fft            = new cFFT(N);
+	omegaStep      = 2.0f * M_PI / 200.0f;	// dispersion() rounds omega down to a multiple of this
+	fft            = new cFFT2D(N, FIELD_COUNT, fftThreads);
 	vertices       = new vertex_ocean[Nplus1*Nplus1];
 
 	int index;
-
-	//seed random number generator with srand, so we get repeatable random waves
-    srand(10);
-
-	//NOTE: Code from here duplicated in hTilde()
-	complex htilde0, htilde0mk_conj;
 	for (int m_prime = 0; m_prime < Nplus1; m_prime++) {
 		for (int n_prime = 0; n_prime < Nplus1; n_prime++) {
 			index = m_prime * Nplus1 + n_prime;
 
-			htilde0        = hTilde_0( n_prime,  m_prime);
-			htilde0mk_conj = hTilde_0(-n_prime, -m_prime).conj();
-
-			vertices[index].a  = htilde0.a;
-			vertices[index].b  = htilde0.b;
-			vertices[index]._a = htilde0mk_conj.a;
-			vertices[index]._b = htilde0mk_conj.b;
-
 			vertices[index].ox = vertices[index].x =  (n_prime - N / 2.0f) * length / N;
 			vertices[index].oy = vertices[index].y =  0.0f;
 			vertices[index].oz = vertices[index].z =  (m_prime - N / 2.0f) * length / N;
@@ -294,21 +417,18 @@ cOcean::cOcean(const int N, const float A, const vector2 w, const float length)
 		}
 	}
 
-	reInitialiseWaves = false;
+	//seed random number generator with srand, so we get repeatable random waves
+	srand(10);
+	initialiseSpectrum();
 }
 
 cOcean::~cOcean() {
-	if (h_tilde)		delete [] h_tilde;
-	if (h_tilde_slopex)	delete [] h_tilde_slopex;
-	if (h_tilde_slopez)	delete [] h_tilde_slopez;
-	if (h_tilde_dx)		delete [] h_tilde_dx;
-	if (h_tilde_dz)		delete [] h_tilde_dz;
 	if (fft)		delete fft;
 	if (vertices)		delete [] vertices;
 }
 
 float cOcean::dispersion(int n_prime, int m_prime) {
-	float w_0 = 2.0f * M_PI / 200.0f;
+	float w_0 = omegaStep;
 	float kx = M_PI * (2 * n_prime - N) / length;
 	float kz = M_PI * (2 * m_prime - N) / length;
 	return floor(sqrt(g * sqrt(kx * kx + kz * kz)) / w_0) * w_0;
@@ -353,45 +473,88 @@ complex cOcean::hTilde_0(int n_prime, int m_prime) {
 	return r;
 }
 
-complex cOcean::hTilde(float t, int n_prime, int m_prime) {
-	int index = m_prime * Nplus1 + n_prime;
+void cOcean::initialiseSpectrum() {
+	h0Re.resize(N*N);
+	h0Im.resize(N*N);
+	h0mkConjRe.resize(N*N);
+	h0mkConjIm.resize(N*N);
+	kxTable.resize(N*N);
+	kzTable.resize(N*N);
+	kInvLength.resize(N*N);
+	omegaLevel.resize(N*N);
 
-	if (reInitialiseWaves) { //NOTE: Code duplication from constructor here
-
-        complex htilde0, htilde0mk_conj;
-        htilde0        = hTilde_0( n_prime,  m_prime);
-        htilde0mk_conj = hTilde_0(-n_prime, -m_prime).conj();
-        
-        //std::cout << htilde0.a << " " << htilde0.b << std::endl;
-
-        vertices[index].a  = htilde0.a;
-        vertices[index].b  = htilde0.b;
-        vertices[index]._a = htilde0mk_conj.a;
-        vertices[index]._b = htilde0mk_conj.b;
-
-        vertices[index].ox = vertices[index].x =  (n_prime - N / 2.0f) * length / N;
-        vertices[index].oy = vertices[index].y =  0.0f;
-        vertices[index].oz = vertices[index].z =  (m_prime - N / 2.0f) * length / N;
+	complex htilde0, htilde0mk_conj;
+	unsigned int maxOmegaLevel = 0;
+	int index;
+	for (int m_prime = 0; m_prime < N; m_prime++) {
+		for (int n_prime = 0; n_prime < N; n_prime++) {
+			index = m_prime * N + n_prime;
 
-        vertices[index].nx = 0.0f;
-        vertices[index].ny = 1.0f;
-        vertices[index].nz = 0.0f;
+			htilde0        = hTilde_0( n_prime,  m_prime);
+			htilde0mk_conj = hTilde_0(-n_prime, -m_prime).conj();
+			h0Re[index]       = htilde0.a;
+			h0Im[index]       = htilde0.b;
+			h0mkConjRe[index] = htilde0mk_conj.a;
+			h0mkConjIm[index] = htilde0mk_conj.b;
+
+			float kx = M_PI * (2 * n_prime - N) / length;
+			float kz = M_PI * (2 * m_prime - N) / length;
+			float len = sqrt(kx * kx + kz * kz);
+			kxTable[index] = kx;
+			kzTable[index] = kz;
+			kInvLength[index] = len < 0.000001f ? 0.0f : 1.0f / len;
+
+			omegaLevel[index] = (unsigned int)(dispersion(n_prime, m_prime) / omegaStep + 0.5f);
+			if (omegaLevel[index] > maxOmegaLevel) maxOmegaLevel = omegaLevel[index];
+		}
 	}
 
-	complex htilde0(vertices[index].a,  vertices[index].b);
-	complex htilde0mkconj(vertices[index]._a, vertices[index]._b);
-
-	float omegat = dispersion(n_prime, m_prime) * t;
+	phasorRe.resize(maxOmegaLevel + 1);
+	phasorIm.resize(maxOmegaLevel + 1);
+	phasorsValid = false;
+}
 
-	float cos_ = cos(omegat);
-	float sin_ = sin(omegat);
+void cOcean::updatePhasors(float t) {
+	// Renormalise every so often, so rounding errors in the rotations don't build up in the phasors' lengths
+	const unsigned int renormaliseInterval = 64;
 
-	complex c0(cos_,  sin_);
-	complex c1(cos_, -sin_);
+	if (!phasorsValid || t < phasorTime) {
+		// Start again from the time itself (t only goes back if the clock has been reset)
+		for (unsigned int level = 0; level < phasorRe.size(); level++) {
+			double omegat = (double)level * omegaStep * t;
+			phasorRe[level] = cos(omegat);
+			phasorIm[level] = sin(omegat);
+		}
+		phasorTime = t;
+		phasorsValid = true;
+		phasorRotations = 0;
+		return;
+	}
 
-	//complex res = htilde0 * c0 + htilde0mkconj * c1;
+	if (t == phasorTime) return;
+
+	// Rotate level by exp(i level omegaStep dt), building up the rotation for each level from the one for level 1
+	double dt = (double)t - (double)phasorTime;
+	double stepRe = cos(omegaStep * dt);
+	double stepIm = sin(omegaStep * dt);
+	double rotationRe = 1.0, rotationIm = 0.0, temp;
+	bool renormalise = ++phasorRotations >= renormaliseInterval;
+	for (unsigned int level = 0; level < phasorRe.size(); level++) {
+		temp            = phasorRe[level] * rotationRe - phasorIm[level] * rotationIm;
+		phasorIm[level] = phasorRe[level] * rotationIm + phasorIm[level] * rotationRe;
+		phasorRe[level] = temp;
+		if (renormalise) {
+			double scale = 1.0 / sqrt(phasorRe[level] * phasorRe[level] + phasorIm[level] * phasorIm[level]);
+			phasorRe[level] *= scale;
+			phasorIm[level] *= scale;
+		}
 
-	return htilde0 * c0 + htilde0mkconj*c1;
+		temp       = rotationRe * stepRe - rotationIm * stepIm;
+		rotationIm = rotationRe * stepIm + rotationIm * stepRe;
+		rotationRe = temp;
+	}
+	if (renormalise) phasorRotations = 0;
+	phasorTime = t;
 }
 /*
 complex_vector_normal cOcean::h_D_and_n(vector2 x, float t) {
@@ -442,9 +605,9 @@ void cOcean::resetParameters(float A, vector2 w)
 
     this->A = A;
     this->w = w;
-    reInitialiseWaves = true;
     //seed random number generator with srand, so we get repeatable random waves
     srand(10);
+    initialiseSpectrum();
 }
 
 //From OpenCV via http://stackoverflow.com/a/20723890
@@ -467,66 +630,70 @@ int cOcean::localisnan(double x) const
 
 void cOcean::evaluateWavesFFT(float t) {
 
-	float kx, kz, len, lambda = -1.0f;
-	int index, index1;
+	float lambda = -1.0f;
+	int index, index1, bin;
+
+	updatePhasors(t);
+
+	// All five fields are transformed together, stored side by side in each row of the FFT's data
+	float* fieldRe = fft->real();
+	float* fieldIm = fft->imag();
+	const unsigned int rowStride = fft->getRowStride();
+	float cos_, sin_, hRe, hIm, kxInv, kzInv;
 
 	for (int m_prime = 0; m_prime < N; m_prime++) {
-		kz = M_PI * (2.0f * m_prime - N) / length;
 		for (int n_prime = 0; n_prime < N; n_prime++) {
-			kx = M_PI*(2 * n_prime - N) / length;
-			len = sqrt(kx * kx + kz * kz);
-			index = m_prime * N + n_prime;
-
-			h_tilde[index] = hTilde(t, n_prime, m_prime);
-			h_tilde_slopex[index] = h_tilde[index] * complex(0, kx);
-			h_tilde_slopez[index] = h_tilde[index] * complex(0, kz);
-			if (len < 0.000001f) {
-				h_tilde_dx[index]     = complex(0.0f, 0.0f);
-				h_tilde_dz[index]     = complex(0.0f, 0.0f);
-			} else {
-				h_tilde_dx[index]     = h_tilde[index] * complex(0, -kx/len);
-				h_tilde_dz[index]     = h_tilde[index] * complex(0, -kz/len);
-			}
+			bin = m_prime * N + n_prime;
+			index = m_prime * rowStride + n_prime;
+
+			// htilde0 * exp(i omega t) + htilde0mk_conj * exp(-i omega t)
+			cos_ = (float)phasorRe[omegaLevel[bin]];
+			sin_ = (float)phasorIm[omegaLevel[bin]];
+			hRe = (h0Re[bin] + h0mkConjRe[bin]) * cos_ - (h0Im[bin] - h0mkConjIm[bin]) * sin_;
+			hIm = (h0Re[bin] - h0mkConjRe[bin]) * sin_ + (h0Im[bin] + h0mkConjIm[bin]) * cos_;
+
+			fieldRe[index + FIELD_H * N] = hRe;
+			fieldIm[index + FIELD_H * N] = hIm;
+			// h * (i kx) and h * (i kz)
+			fieldRe[index + FIELD_SLOPEX * N] = -hIm * kxTable[bin];
+			fieldIm[index + FIELD_SLOPEX * N] =  hRe * kxTable[bin];
+			fieldRe[index + FIELD_SLOPEZ * N] = -hIm * kzTable[bin];
+			fieldIm[index + FIELD_SLOPEZ * N] =  hRe * kzTable[bin];
+			// h * (-i kx/len) and h * (-i kz/len)
+			kxInv = kxTable[bin] * kInvLength[bin];
+			kzInv = kzTable[bin] * kInvLength[bin];
+			fieldRe[index + FIELD_DX * N] =  hIm * kxInv;
+			fieldIm[index + FIELD_DX * N] = -hRe * kxInv;
+			fieldRe[index + FIELD_DZ * N] =  hIm * kzInv;
+			fieldIm[index + FIELD_DZ * N] = -hRe * kzInv;
 		}
 	}
 
-	reInitialiseWaves = false; //If we had to re-initialise, this is done in hTilde, so should now be complete for all vertexes
-
-	for (int m_prime = 0; m_prime < N; m_prime++) {
-		fft->fft(h_tilde, h_tilde, 1, m_prime * N);
-		fft->fft(h_tilde_slopex, h_tilde_slopex, 1, m_prime * N);
-		fft->fft(h_tilde_slopez, h_tilde_slopez, 1, m_prime * N);
-		fft->fft(h_tilde_dx, h_tilde_dx, 1, m_prime * N);
-		fft->fft(h_tilde_dz, h_tilde_dz, 1, m_prime * N);
-	}
-	for (int n_prime = 0; n_prime < N; n_prime++) {
-		fft->fft(h_tilde, h_tilde, N, n_prime);
-		fft->fft(h_tilde_slopex, h_tilde_slopex, N, n_prime);
-		fft->fft(h_tilde_slopez, h_tilde_slopez, N, n_prime);
-		fft->fft(h_tilde_dx, h_tilde_dx, N, n_prime);
-		fft->fft(h_tilde_dz, h_tilde_dz, N, n_prime);
-	}
+	fft->transform();
+	fieldRe = fft->real(); // Only the real parts are used from here
 
 	int sign;
 	float signs[] = { 1.0f, -1.0f };
 	vector3 n;
 	for (int m_prime = 0; m_prime < N; m_prime++) {
 		for (int n_prime = 0; n_prime < N; n_prime++) {
-			index  = m_prime * N + n_prime;		// index into h_tilde..
+			index  = m_prime * rowStride + n_prime;	// index into the FFT's fields
 			index1 = m_prime * Nplus1 + n_prime;	// index into vertices
 
 			sign = signs[(n_prime + m_prime) & 1];
 
-			h_tilde[index]     = h_tilde[index] * sign;
+			const float height = fieldRe[index + FIELD_H * N] * sign;
+			const float dx     = fieldRe[index + FIELD_DX * N] * sign;
+			const float dz     = fieldRe[index + FIELD_DZ * N] * sign;
+			const float slopex = fieldRe[index + FIELD_SLOPEX * N] * sign;
+			const float slopez = fieldRe[index + FIELD_SLOPEZ * N] * sign;
 
 			// height
-			vertices[index1].y = h_tilde[index].a;
+			vertices[index1].y = height;
 
 			// displacement
-			h_tilde_dx[index] = h_tilde_dx[index] * sign;
-			h_tilde_dz[index] = h_tilde_dz[index] * sign;
-			vertices[index1].x = vertices[index1].ox + h_tilde_dx[index].a * lambda;
-			vertices[index1].z = vertices[index1].oz + h_tilde_dz[index].a * lambda;
+			vertices[index1].x = vertices[index1].ox + dx * lambda;
+			vertices[index1].z = vertices[index1].oz + dz * lambda;
 			
 			//Checking - Bug workaround for NaNs on OSX
 			if (localisinf(vertices[index1].y) || localisnan(vertices[index1].y)) {
@@ -538,19 +705,17 @@ void cOcean::evaluateWavesFFT(float t) {
 			}
 
 			// normal
-			h_tilde_slopex[index] = h_tilde_slopex[index] * sign;
-			h_tilde_slopez[index] = h_tilde_slopez[index] * sign;
-			n = vector3(0.0f - h_tilde_slopex[index].a, 1.0f, 0.0f - h_tilde_slopez[index].a).unit();
+			n = vector3(0.0f - slopex, 1.0f, 0.0f - slopez).unit();
 			vertices[index1].nx =  n.x;
 			vertices[index1].ny =  n.y;
 			vertices[index1].nz =  n.z;
 
 			// for tiling
 			if (n_prime == 0 && m_prime == 0) {
-				vertices[index1 + N + Nplus1 * N].y = h_tilde[index].a;
+				vertices[index1 + N + Nplus1 * N].y = height;
 
-				vertices[index1 + N + Nplus1 * N].x = vertices[index1 + N + Nplus1 * N].ox + h_tilde_dx[index].a * lambda;
-				vertices[index1 + N + Nplus1 * N].z = vertices[index1 + N + Nplus1 * N].oz + h_tilde_dz[index].a * lambda;
+				vertices[index1 + N + Nplus1 * N].x = vertices[index1 + N + Nplus1 * N].ox + dx * lambda;
+				vertices[index1 + N + Nplus1 * N].z = vertices[index1 + N + Nplus1 * N].oz + dz * lambda;
 
 				vertices[index1 + N + Nplus1 * N].nx =  n.x;
 				vertices[index1 + N + Nplus1 * N].ny =  n.y;
@@ -569,10 +734,10 @@ void cOcean::evaluateWavesFFT(float t) {
 
 			}
 			if (n_prime == 0) {
-				vertices[index1 + N].y = h_tilde[index].a;
+				vertices[index1 + N].y = height;
 
-				vertices[index1 + N].x = vertices[index1 + N].ox + h_tilde_dx[index].a * lambda;
-				vertices[index1 + N].z = vertices[index1 + N].oz + h_tilde_dz[index].a * lambda;
+				vertices[index1 + N].x = vertices[index1 + N].ox + dx * lambda;
+				vertices[index1 + N].z = vertices[index1 + N].oz + dz * lambda;
 
 				vertices[index1 + N].nx =  n.x;
 				vertices[index1 + N].ny =  n.y;
@@ -589,10 +754,10 @@ void cOcean::evaluateWavesFFT(float t) {
 				
 			}
 			if (m_prime == 0) {
-				vertices[index1 + Nplus1 * N].y = h_tilde[index].a;
+				vertices[index1 + Nplus1 * N].y = height;
 
-				vertices[index1 + Nplus1 * N].x = vertices[index1 + Nplus1 * N].ox + h_tilde_dx[index].a * lambda;
-				vertices[index1 + Nplus1 * N].z = vertices[index1 + Nplus1 * N].oz + h_tilde_dz[index].a * lambda;
+				vertices[index1 + Nplus1 * N].x = vertices[index1 + Nplus1 * N].ox + dx * lambda;
+				vertices[index1 + Nplus1 * N].z = vertices[index1 + Nplus1 * N].oz + dz * lambda;
 
 				vertices[index1 + Nplus1 * N].nx =  n.x;
 				vertices[index1 + Nplus1 * N].ny =  n.y;
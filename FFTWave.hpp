@@ -35,12 +35,17 @@ class cTimer {
 	double elapsed(bool frame);
 };
 */
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "AlignedAllocator.hpp"
+
 class complex {
   private:
   protected:
   public:
     float a, b;
-    static unsigned int additions, multiplications;
     complex();
     complex(float a, float b);
     complex conj();
@@ -50,7 +55,6 @@ class complex {
     complex operator-() const;
     complex operator*(const float c) const;
     complex& operator=(const complex& c);
-    static void reset();
 };
 
 #include <math.h>
@@ -88,28 +92,58 @@ class vector2 {
     vector2 unit();
 };
 
-class cFFT {
+// 2D FFT of several N x N complex fields at once, with the same sign and scaling as the original row by row radix-2 cFFT
+// (exp(+i...), unscaled). Real and imaginary parts are stored separately, and the fields are side by side in each row, so
+// row m of the data is [field 0 columns 0..N-1, field 1 columns 0..N-1, ...]. Each pass transforms the columns of all the
+// fields together with radix-4 Stockham butterflies (radix-2 for the last stage if N is an odd power of 2), so the inner loops
+// run along contiguous rows and are vectorised by the compiler. The rows are transformed by transposing each field, doing the
+// same column pass, and transposing back. With more than one thread, each column pass is split into blocks of columns, and each
+// transpose into blocks of rows, shared between the calling thread and helper threads.
+class cFFT2D {
   private:
-	unsigned int N, which;
-	unsigned int *reversed;
-	complex **T;
-	float pi2;
-	unsigned int log_2_N;
-	complex *c[2];
+	typedef std::vector<float, AlignedAllocator<float> > floatArray;
+	enum Pass { PASS_COLUMNS, PASS_TRANSPOSE };
+
+	unsigned int N, fields, width;		// width: floats in each row, fields * N
+	floatArray re[2], im[2];		// data, and the other half of the Stockham ping-pong
+	unsigned int current;			// which of re/im has the data
+	unsigned int columnStages;		// stages in each column pass
+	std::vector<floatArray> twiddleRe, twiddleIm;	// per radix-4 stage: w^p, w^2p, w^3p for each p
+
+	// Helper threads, each doing part (1 + its index) of the pass. pass and passNumber are only changed with poolMutex held.
+	std::vector<std::thread> helpers;
+	std::mutex poolMutex;
+	std::condition_variable passStartCondition;	// signalled when a pass is started, or the helpers should stop
+	std::condition_variable passDoneCondition;	// signalled when the last helper finishes its part
+	Pass pass;
+	unsigned int passNumber;		// increased for each pass started
+	unsigned int helpersRunning;		// helpers yet to finish the current pass
+	bool helpersStopRequested;
+
+	void columnPass(unsigned int firstColumn, unsigned int endColumn);	// from re/im[current], into re/im[current ^ (columnStages & 1)]
+	void transposeFields(unsigned int firstRow, unsigned int endRow);	// rows of the result, from re/im[current] into the other buffer
+	void radix4Stage(unsigned int stage, unsigned int n, unsigned int s, unsigned int from, unsigned int firstColumn, unsigned int endColumn);
+	void radix2Stage(unsigned int s, unsigned int from, unsigned int firstColumn, unsigned int endColumn);
+	void runPass(Pass pass);		// all parts, waiting for the helpers
+	void runPart(Pass pass, unsigned int part);
+	void helperLoop(unsigned int part);
+
+	cFFT2D(const cFFT2D&);			// not copyable
+	cFFT2D& operator=(const cFFT2D&);
   protected:
   public:
-	cFFT(unsigned int N);
-	~cFFT();
-	unsigned int reverse(unsigned int i);
-	complex t(unsigned int x, unsigned int N);
-	void fft(complex* input, complex* output, int stride, int offset);
+	cFFT2D(unsigned int N, unsigned int fields, unsigned int threads = 1);
+	~cFFT2D();
+
+	float* real() { return &re[current][0]; }		// Row m, field f, column n at [m * getRowStride() + f * N + n]
+	float* imag() { return &im[current][0]; }
+	unsigned int getRowStride() const { return width; }
+	void transform();					// In place, in real() and imag()
 };
 
 struct vertex_ocean {
 	float   x,   y,   z; // vertex
 	float  nx,  ny,  nz; // normal
-	float   a,   b,   c; // htilde0
-	float  _a,  _b,  _c; // htilde0mk conjugate
 	float  ox,  oy,  oz; // original position
 };
 
@@ -128,12 +162,24 @@ class cOcean {
 	vector2 w;				// wind parameter
 	float length;				// length parameter
 	vertex_ocean *vertices;			// vertices for vertex buffer object
-	bool reInitialiseWaves; // If waves should be re-created (as new A or w?)
 
-	complex *h_tilde,			// for fast fourier transform
-		*h_tilde_slopex, *h_tilde_slopez,
-		*h_tilde_dx, *h_tilde_dz;
-	cFFT *fft;				// fast fourier transform
+	// Per frequency bin tables, [m_prime * N + n_prime], made by initialiseSpectrum()
+	std::vector<float> h0Re, h0Im;			// htilde0
+	std::vector<float> h0mkConjRe, h0mkConjIm;	// htilde0mk conjugate
+	std::vector<float> kxTable, kzTable;		// wave vector
+	std::vector<float> kInvLength;			// 1 / length of the wave vector, 0 for k = 0
+	std::vector<unsigned int> omegaLevel;		// dispersion() is a whole number of omegaStep, so omega = omegaLevel * omegaStep
+
+	// exp(i omega t) for each omegaLevel, rotated on by exp(i omega dt) each frame rather than using cos and sin for each bin
+	float omegaStep;
+	std::vector<double> phasorRe, phasorIm;
+	float phasorTime;			// t the phasors are for
+	bool phasorsValid;
+	unsigned int phasorRotations;		// since the phasors were last renormalised
+
+	// Fields transformed together by fft: height, x and z slopes, x and z displacements
+	enum { FIELD_H, FIELD_SLOPEX, FIELD_SLOPEZ, FIELD_DX, FIELD_DZ, FIELD_COUNT };
+	cFFT2D *fft;				// fast fourier transform
 
 	//unsigned int *indices;			// indicies for vertex buffer object
 	//unsigned int indices_count;		// number of indices to render
@@ -146,7 +192,8 @@ class cOcean {
 	float dispersion(int n_prime, int m_prime);		// deep water
 	float phillips(int n_prime, int m_prime);		// phillips spectrum
 	complex hTilde_0(int n_prime, int m_prime);
-	complex hTilde(float t, int n_prime, int m_prime);
+	void initialiseSpectrum();				// htilde0 and the per bin tables, for the current A and w
+	void updatePhasors(float t);
 	//complex_vector_normal h_D_and_n(vector2 x, float t);
 	
 	int localisinf(double x) const;
@@ -154,10 +201,10 @@ class cOcean {
 
   protected:
   public:
-	cOcean(const int N, const float A, const vector2 w, const float length);
+	cOcean(const int N, const float A, const vector2 w, const float length, const unsigned int fftThreads = 1);
 	~cOcean();
 
-	void resetParameters(float A, vector2 w);
+	void resetParameters(float A, vector2 w);	// Re-creates the waves if A or w have changed
 	void evaluateWavesFFT(float t);
 	vertex_ocean* getVertices();
 };
@@ -17,7 +17,7 @@
 #include "LandLights.hpp"
 
 #include "NavLight.hpp"
-#include "IniFile.hpp"
+#include "WorldPack.hpp"
 #include "Constants.hpp"
 #include "Terrain.hpp"
 #include "SimulationModel.hpp"
@@ -38,37 +38,40 @@ LandLights::~LandLights()
     landLights.clear();
 }
 
-void LandLights::load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, const Terrain& terrain)
+void LandLights::load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain)
 {
-    //get light.ini filename
-    std::string scenarioLightFilename = worldName;
-    scenarioLightFilename.append("/light.ini");
+    //Get light information from light.ini
+    WorldPack worldData;
+    worldData.readLightIni(worldName);
+    load(worldData, smgr, worldNode, model, terrain);
+}
 
-    irr::u32 numberOfLights;
-    numberOfLights = IniFile::iniFileTou32(scenarioLightFilename,"Number");
+void LandLights::load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain)
+{
     //Run through lights, and check if any are not buoy lights
-    for (irr::u32 currentLight=1;currentLight<=numberOfLights;currentLight++) {
-        if (IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Buoy",currentLight)) == 0 ) {
+    for (irr::u32 currentLight=0;currentLight<worldData.lights.size();currentLight++) {
+        const WorldPackLight& lightData = worldData.lights.at(currentLight);
+        if (lightData.buoy == 0 ) {
             //If not a buoy light
-            irr::f32 lightX = model->longToX(IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Long",currentLight)));
-            irr::f32 lightZ = model->latToZ(IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Lat",currentLight)));
-            irr::f32 lightY = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Height",currentLight));
-            if (IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Absolute",currentLight)) != 1) {
+            irr::f32 lightX = model->longToX(lightData.longitude);
+            irr::f32 lightZ = model->latToZ(lightData.latitude);
+            irr::f32 lightY = lightData.height;
+            if (lightData.absolute != 1) {
                 lightY = lightY + terrain.getHeight(lightX,lightZ);
             }
 
-            irr::f32 lightR = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Red",currentLight));
-            irr::f32 lightG = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Green",currentLight));
-            irr::f32 lightB = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("Blue",currentLight));
-            irr::f32 lightRange = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("Range",currentLight));
-            std::string lightSequence = IniFile::iniFileToString(scenarioLightFilename,IniFile::enumerate1("Sequence",currentLight));
-            irr::u32 phaseStart = IniFile::iniFileTou32(scenarioLightFilename,IniFile::enumerate1("PhaseStart",currentLight));
-            irr::f32 lightStart = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("StartAngle",currentLight));
-            irr::f32 lightEnd = IniFile::iniFileTof32(scenarioLightFilename,IniFile::enumerate1("EndAngle",currentLight));
+            irr::f32 lightR = lightData.red;
+            irr::f32 lightG = lightData.green;
+            irr::f32 lightB = lightData.blue;
+            irr::f32 lightRange = lightData.range;
+            std::string lightSequence = lightData.sequence;
+            irr::u32 phaseStart = lightData.phaseStart;
+            irr::f32 lightStart = lightData.startAngle;
+            irr::f32 lightEnd = lightData.endAngle;
             lightRange = lightRange * M_IN_NM;
 
 
-            landLights.push_back(new NavLight (0,smgr,irr::core::dimension2d<irr::f32>(5, 5), irr::core::vector3df(lightX,lightY,lightZ),irr::video::SColor(255,lightR,lightG,lightB),lightStart,lightEnd,lightRange, lightSequence, phaseStart));
+            landLights.push_back(new NavLight (worldNode,smgr,irr::core::dimension2d<irr::f32>(5, 5), irr::core::vector3df(lightX,lightY,lightZ),irr::video::SColor(255,lightR,lightG,lightB),lightStart,lightEnd,lightRange, lightSequence, phaseStart));
         }
     }
 
@@ -86,9 +89,3 @@ irr::u32 LandLights::getNumber() const
     return landLights.size();
 }
 
-void LandLights::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
-{
-    for(std::vector<NavLight*>::iterator it = landLights.begin(); it != landLights.end(); ++it) {
-        (*it)->moveNode(deltaX,deltaY,deltaZ);
-    }
-}
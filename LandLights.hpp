@@ -26,16 +26,17 @@
 class SimulationModel;
 class NavLight;
 class Terrain;
+class WorldPack;
 
 class LandLights
 {
     public:
         LandLights();
         virtual ~LandLights();
-        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, const Terrain& terrain);
+        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain);
+        void load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain); //Lights are added as children of worldNode
         void update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::u32 lightLevel);
         irr::u32 getNumber() const;
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
     private:
         std::vector<NavLight*> landLights;
 };
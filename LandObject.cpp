@@ -22,7 +22,7 @@
 
 //using namespace irr;
 
-LandObject::LandObject(const std::string& name, const irr::core::vector3df& location, irr::f32 rotation, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev)
+LandObject::LandObject(const std::string& name, const irr::core::vector3df& location, irr::f32 rotation, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev)
 {
 
     std::string basePath = "Models/LandObject/" + name + "/";
@@ -50,9 +50,9 @@ LandObject::LandObject(const std::string& name, const irr::core::vector3df& loca
         //Failed to load mesh - load with dummy and continue
         dev->getLogger()->log("Failed to load land object model:");
         dev->getLogger()->log(objectFullPath.c_str());
-        landObject = smgr->addCubeSceneNode(0.1);
+        landObject = smgr->addCubeSceneNode(0.1,parent,-1,location);
     } else {
-        landObject = smgr->addMeshSceneNode( objectMesh, 0, -1, location );
+        landObject = smgr->addMeshSceneNode( objectMesh, parent, -1, location );
     }
 
     //Set lighting to use diffuse and ambient, so lighting of untextured models works
@@ -80,12 +80,3 @@ irr::core::vector3df LandObject::getPosition() const
     return landObject->getAbsolutePosition();
 }
 
-void LandObject::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
-{
-    irr::core::vector3df currentPos = landObject->getPosition();
-    irr::f32 newPosX = currentPos.X + deltaX;
-    irr::f32 newPosY = currentPos.Y + deltaY;
-    irr::f32 newPosZ = currentPos.Z + deltaZ;
-
-    landObject->setPosition(irr::core::vector3df(newPosX,newPosY,newPosZ));
-}
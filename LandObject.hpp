@@ -24,10 +24,9 @@
 class LandObject
 {
     public:
-        LandObject(const std::string& name, const irr::core::vector3df& location, irr::f32 rotation, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev);
+        LandObject(const std::string& name, const irr::core::vector3df& location, irr::f32 rotation, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* smgr, irr::IrrlichtDevice* dev);
         virtual ~LandObject();
         irr::core::vector3df getPosition() const;
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
     protected:
     private:
         irr::scene::IMeshSceneNode* landObject; //The scene node for the object.
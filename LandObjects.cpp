@@ -17,7 +17,7 @@
 #include "LandObjects.hpp"
 
 #include "LandObject.hpp"
-#include "IniFile.hpp"
+#include "WorldPack.hpp"
 #include "Terrain.hpp"
 //#include "Constants.hpp"
 #include "SimulationModel.hpp"
@@ -36,33 +36,35 @@ LandObjects::~LandObjects()
     //dtor
 }
 
-void LandObjects::load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev)
+void LandObjects::load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev)
 {
-    //get landObject.ini filename
-    std::string scenarioLandObjectFilename = worldName;
-    scenarioLandObjectFilename.append("/landobject.ini");
+    //Get land object information from landObject.ini
+    WorldPack worldData;
+    worldData.readLandObjectIni(worldName);
+    load(worldData, smgr, worldNode, model, terrain, dev);
+}
 
-    //Find number of objects
-    irr::u32 numberOfObjects;
-    numberOfObjects = IniFile::iniFileTou32(scenarioLandObjectFilename,"Number");
-    for(irr::u32 currentObject=1;currentObject<=numberOfObjects;currentObject++) {
+void LandObjects::load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev)
+{
+    for(irr::u32 currentObject=0;currentObject<worldData.landObjects.size();currentObject++) {
+        const WorldPackLandObject& objectData = worldData.landObjects.at(currentObject);
 
-        //Get Object type and construct filename
-        std::string objectName = IniFile::iniFileToString(scenarioLandObjectFilename,IniFile::enumerate1("Type",currentObject));
+        //Get Object type
+        std::string objectName = objectData.type;
         //Get object position
-        irr::f32 objectX = model->longToX(IniFile::iniFileTof32(scenarioLandObjectFilename,IniFile::enumerate1("Long",currentObject)));
-        irr::f32 objectZ = model->latToZ(IniFile::iniFileTof32(scenarioLandObjectFilename,IniFile::enumerate1("Lat",currentObject)));
-        irr::f32 objectY = IniFile::iniFileTof32(scenarioLandObjectFilename,IniFile::enumerate1("HeightCorrection",currentObject));;
+        irr::f32 objectX = model->longToX(objectData.longitude);
+        irr::f32 objectZ = model->latToZ(objectData.latitude);
+        irr::f32 objectY = objectData.heightCorrection;
         //Check if land object is given in absolute height, or relative to terrain.
-        if (IniFile::iniFileTou32(scenarioLandObjectFilename,IniFile::enumerate1("Absolute",currentObject))!=1) {
+        if (objectData.absolute!=1) {
             objectY += terrain.getHeight(objectX,objectZ);
         }
 
         //Get rotation
-        irr::f32 rotation = IniFile::iniFileTof32(scenarioLandObjectFilename,IniFile::enumerate1("Rotation",currentObject));
+        irr::f32 rotation = objectData.rotation;
 
         //Create land object and load into vector
-        landObjects.push_back(LandObject (objectName.c_str(),irr::core::vector3df(objectX,objectY,objectZ),rotation,smgr,dev));
+        landObjects.push_back(LandObject (objectName.c_str(),irr::core::vector3df(objectX,objectY,objectZ),rotation,worldNode,smgr,dev));
 
     }
 }
@@ -72,10 +74,3 @@ irr::u32 LandObjects::getNumber() const
     return landObjects.size();
 }
 
-void LandObjects::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
-{
-    for(std::vector<LandObject>::iterator it = landObjects.begin(); it != landObjects.end(); ++it) {
-        it->moveNode(deltaX,deltaY,deltaZ);
-    }
-}
-
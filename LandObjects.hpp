@@ -26,15 +26,16 @@
 class SimulationModel;
 class Terrain;
 class LandObject;
+class WorldPack;
 
 class LandObjects
 {
     public:
         LandObjects();
         virtual ~LandObjects();
-        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev);
+        void load(const std::string& worldName, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev);
+        void load(const WorldPack& worldData, irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* worldNode, SimulationModel* model, const Terrain& terrain, irr::IrrlichtDevice* dev); //Objects are added as children of worldNode
         irr::u32 getNumber() const;
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
 
     private:
         std::vector<LandObject> landObjects;
@@ -0,0 +1,148 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    data = 0;
+    size = 0;
+    mapped = false;
+    #ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = 0;
+    #endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    #ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0) {
+            mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+            if (mappingHandle) {
+                data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+                if (data) {
+                    size = (std::size_t)fileSize.QuadPart;
+                    mapped = true;
+                    return true;
+                }
+            }
+        }
+        close(); //Fall back to reading the file below
+    }
+    #else
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor >= 0) {
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0) {
+            void* mapping = mmap(0, (std::size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+            if (mapping != MAP_FAILED) {
+                data = mapping;
+                size = (std::size_t)fileStatus.st_size;
+                mapped = true;
+            }
+        }
+        ::close(fileDescriptor); //The mapping stays valid after the file is closed
+        if (mapped) {
+            return true;
+        }
+    }
+    #endif
+
+    //Could not map, so read the whole file instead
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    if (fileSize <= 0) {
+        return false;
+    }
+    file.seekg(0, std::ios::beg);
+    buffer.resize((std::size_t)fileSize);
+    if (!file.read(&buffer[0], fileSize)) {
+        buffer.clear();
+        return false;
+    }
+    data = &buffer[0];
+    size = buffer.size();
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapped) {
+        #ifdef _WIN32
+        UnmapViewOfFile(data);
+        #else
+        munmap(const_cast<void*>(data), size);
+        #endif
+    }
+
+    #ifdef _WIN32
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+        mappingHandle = 0;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+    #endif
+
+    std::vector<char>().swap(buffer);
+    data = 0;
+    size = 0;
+    mapped = false;
+}
+
+const void* MappedFile::getData() const
+{
+    return data;
+}
+
+std::size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+bool MappedFile::isMapped() const
+{
+    return mapped;
+}
@@ -0,0 +1,52 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __MAPPEDFILE_HPP_INCLUDED__
+#define __MAPPEDFILE_HPP_INCLUDED__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Read only view of a whole file in memory. The file is memory mapped where possible, so pages are only read from disk when
+//they are first used, and are shared with the operating system's file cache. If mapping fails, the file is read into a buffer
+//instead, so the data is always available through getData() while the MappedFile exists.
+class MappedFile
+{
+    public:
+        MappedFile();
+        ~MappedFile();
+        bool open(const std::string& path); //Returns false if the file could not be opened or read
+        void close();
+        const void* getData() const; //Start of the file contents, or 0 if not open. Page aligned if mapped.
+        std::size_t getSize() const; //Bytes
+        bool isMapped() const; //True if memory mapped, false if read into a buffer (or not open)
+
+    private:
+        MappedFile(const MappedFile&); //Not copyable
+        MappedFile& operator=(const MappedFile&);
+
+        const void* data;
+        std::size_t size;
+        bool mapped;
+        std::vector<char> buffer; //Used if the file could not be mapped
+        #ifdef _WIN32
+        void* fileHandle;
+        void* mappingHandle;
+        #endif
+};
+
+#endif
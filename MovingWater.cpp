@@ -23,6 +23,7 @@
 //#include "Utilities.hpp"
 
 #include <iostream>
+#include <algorithm>
 //#include <cmath>
 
 namespace irr
@@ -86,7 +87,15 @@ MovingWaterSceneNode::MovingWaterSceneNode(ISceneNode* parent, ISceneManager* mg
     segments = 32; //How many tiles per segment
     irr::f32 segmentSize = tileWidth / segments;
 
-    ocean = new cOcean(segments, 0.00005f, vector2(32.0f,32.0f), tileWidth); //Note that the A and w parameters will get overwritten by ocean->resetParameters() dependent on the model's weather
+    //Only split the ocean's FFT between cores if it is big enough to be worth the synchronisation
+    irr::u32 fftThreads = 1;
+    if (segments >= 64) {
+        fftThreads = std::max(1u, std::min(std::thread::hardware_concurrency()/2, 4u));
+    }
+
+    oceanA = 0.00005f;
+    oceanW = vector2(32.0f,32.0f);
+    ocean = new cOcean(segments, oceanA, oceanW, tileWidth, fftThreads); //Note that the A and w parameters will get overwritten by ocean->resetParameters() dependent on the model's weather
 
 	mesh = mgr->addHillPlaneMesh( "myHill",
                            irr::core::dimension2d<irr::f32>(segmentSize,segmentSize),
@@ -97,6 +106,34 @@ MovingWaterSceneNode::MovingWaterSceneNode(ISceneNode* parent, ISceneManager* mg
                            irr::core::dimension2d<irr::f32>(tileWidth/(irr::f32)(segments),tileWidth/(irr::f32)(segments)));
 
 
+    //Positions and normals are replaced each frame, from the ocean snapshots
+    mesh->setHardwareMappingHint(irr::scene::EHM_STREAM, irr::scene::EBT_VERTEX);
+    mesh->setHardwareMappingHint(irr::scene::EHM_STATIC, irr::scene::EBT_INDEX);
+
+    //First snapshot, at time 0, in all the buffers and the mesh, then the ocean thread makes the rest
+    oceanUpdatePeriod = 1.0f/30.0f;
+    ocean->evaluateWavesFFT(0);
+    irr::scene::IMeshBuffer* meshBuffer = mesh->getMeshBuffer(0);
+    const irr::video::S3DVertex* meshVertices = (const irr::video::S3DVertex*)meshBuffer->getVertices();
+    for (irr::u32 i = 0; i < 4; i++) {
+        oceanSnapshots[i].time = 0;
+        oceanSnapshots[i].vertices.reallocate(meshBuffer->getVertexCount());
+        for (irr::u32 j = 0; j < meshBuffer->getVertexCount(); j++) {
+            oceanSnapshots[i].vertices.push_back(meshVertices[j]);
+        }
+        copyOceanVertices(oceanSnapshots[i]);
+    }
+    workerSnapshot = 0;
+    pendingSnapshot = 1;
+    frontSnapshot = 2;
+    previousSnapshot = 3;
+    pendingSnapshotFresh = false;
+    newestSnapshotTime = 0;
+    displayedTime = 0;
+    oceanStopRequested = false;
+    interpolateSnapshots(0);
+    oceanThread = std::thread(&MovingWaterSceneNode::oceanThreadLoop, this);
+
     flatMesh = mgr->getMesh("media/flatsea.x");
     if (!flatMesh) {
         std::cerr << "Could not load flat sea mesh from media/flatsea.x" << std::endl;
@@ -188,6 +225,12 @@ MovingWaterSceneNode::MovingWaterSceneNode(ISceneNode* parent, ISceneManager* mg
 MovingWaterSceneNode::~MovingWaterSceneNode()
 {
 	// Mesh is dropped in IMeshSceneNode destructor (??? FIXME: Probably not true!)
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        oceanStopRequested = true;
+    }
+    snapshotCondition.notify_one();
+    oceanThread.join();
     delete ocean;
 
     if (_camera)
@@ -225,10 +268,105 @@ int MovingWaterSceneNode::localisnan(double x) const
 
 void MovingWaterSceneNode::resetParameters(float A, vector2 w, float seaState)
 {
-    ocean->resetParameters(A,w);
+    //Called every frame, so only wait for the ocean thread if there is a change
+    if (A != oceanA || w.x != oceanW.x || w.y != oceanW.y) {
+        std::lock_guard<std::mutex> lock(oceanMutex);
+        ocean->resetParameters(A,w);
+        oceanA = A;
+        oceanW = w;
+    }
     this->seaState = seaState;
 }
 
+void MovingWaterSceneNode::oceanThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(snapshotMutex);
+    while (true) {
+        //Wait until the last snapshot made has been taken
+        snapshotCondition.wait(lock, [this]{ return oceanStopRequested || !pendingSnapshotFresh; });
+        if (oceanStopRequested) {
+            return;
+        }
+
+        //Next snapshot after the newest, unless it has fallen behind the displayed time, or the time has gone back
+        irr::f32 snapshotTime = newestSnapshotTime + oceanUpdatePeriod;
+        if (snapshotTime < displayedTime || displayedTime < newestSnapshotTime - 2*oceanUpdatePeriod) {
+            snapshotTime = displayedTime + oceanUpdatePeriod;
+        }
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> oceanLock(oceanMutex);
+            ocean->evaluateWavesFFT(snapshotTime);
+            copyOceanVertices(oceanSnapshots[workerSnapshot]);
+            oceanSnapshots[workerSnapshot].time = snapshotTime;
+        }
+
+        lock.lock();
+        std::swap(workerSnapshot, pendingSnapshot);
+        pendingSnapshotFresh = true;
+        newestSnapshotTime = snapshotTime;
+    }
+}
+
+void MovingWaterSceneNode::interpolateSnapshots(irr::f32 time)
+{
+    bool snapshotTaken = false;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        displayedTime = time;
+        //Move on to the pending snapshot once the front one has been reached, or straight away if time has gone back
+        if (pendingSnapshotFresh && (time >= oceanSnapshots[frontSnapshot].time || time < oceanSnapshots[previousSnapshot].time)) {
+            std::swap(previousSnapshot, frontSnapshot);
+            std::swap(frontSnapshot, pendingSnapshot);
+            pendingSnapshotFresh = false;
+            snapshotTaken = true;
+        }
+    }
+    if (snapshotTaken) {
+        snapshotCondition.notify_one();
+    }
+
+    const irr::video::S3DVertex* previous = oceanSnapshots[previousSnapshot].vertices.const_pointer();
+    const irr::video::S3DVertex* front = oceanSnapshots[frontSnapshot].vertices.const_pointer();
+    const irr::f32 previousTime = oceanSnapshots[previousSnapshot].time;
+    const irr::f32 frontTime = oceanSnapshots[frontSnapshot].time;
+    irr::f32 interp = 1;
+    if (frontTime > previousTime) {
+        interp = irr::core::clamp((time - previousTime)/(frontTime - previousTime), 0.0f, 1.0f);
+    }
+
+    //One pass over each mesh buffer's vertices, leaving the colours and texture coordinates
+    const irr::u32 meshBufferCount = mesh->getMeshBufferCount();
+    for (irr::u32 b = 0; b < meshBufferCount; ++b) {
+        irr::scene::IMeshBuffer* meshBuffer = mesh->getMeshBuffer(b);
+        irr::video::S3DVertex* vertices = (irr::video::S3DVertex*)meshBuffer->getVertices();
+        const irr::u32 vertexCount = std::min(meshBuffer->getVertexCount(), oceanSnapshots[frontSnapshot].vertices.size());
+        for (irr::u32 i = 0; i < vertexCount; i++) {
+            vertices[i].Pos = previous[i].Pos + (front[i].Pos - previous[i].Pos)*interp;
+            vertices[i].Normal = previous[i].Normal + (front[i].Normal - previous[i].Normal)*interp;
+        }
+    }
+    mesh->setDirty(irr::scene::EBT_VERTEX);
+}
+
+void MovingWaterSceneNode::copyOceanVertices(OceanSnapshot& snapshot) const
+{
+    //Swap sign of x to maintain correct rotation order of vertices: TODO: Look at basic definition of X and Z coordinate system between water and FFTWave
+    const vertex_ocean* oceanVertices = ocean->getVertices();
+    irr::video::S3DVertex* vertices = snapshot.vertices.pointer();
+    const irr::u32 vertexCount = snapshot.vertices.size();
+    for (irr::u32 i = 0; i < vertexCount; i++) {
+        vertices[i].Pos.set(-oceanVertices[i].x, oceanVertices[i].y, oceanVertices[i].z);
+        vertices[i].Normal.set(-oceanVertices[i].nx, oceanVertices[i].ny, oceanVertices[i].nz);
+    }
+}
+
+const irr::video::S3DVertex* MovingWaterSceneNode::getDisplayedVertices() const
+{
+    return (const irr::video::S3DVertex*)mesh->getMeshBuffer(0)->getVertices();
+}
+
 void MovingWaterSceneNode::OnSetConstants(video::IMaterialRendererServices* services, irr::s32 userData)
 {
     //From Mel's cubemap demo
@@ -323,30 +461,8 @@ void MovingWaterSceneNode::OnAnimate(irr::u32 timeMs)
 
 		const irr::f32 time = timeMs / 1000.f;
 
-		//Update the FFT Calculation
-		ocean->evaluateWavesFFT(time);
-		vertex_ocean* vertices = ocean->getVertices();
-
-		const irr::u32 meshBufferCount = mesh->getMeshBufferCount();
-
-		for (irr::u32 b=0; b<meshBufferCount; ++b)
-		{
-			const irr::u32 vtxCnt = mesh->getMeshBuffer(b)->getVertexCount();
-
-			for (irr::u32 i=0; i<vtxCnt; ++i) {
-				mesh->getMeshBuffer(b)->getPosition(i).X = -1*vertices[i].x; //Swap sign to maintain correct rotation order of vertices: TODO: Look at basic definition of X and Z coordinate system between water and FFTWave
-				mesh->getMeshBuffer(b)->getPosition(i).Y = vertices[i].y;
-				mesh->getMeshBuffer(b)->getPosition(i).Z = vertices[i].z;
-
-				//Set normals (TODO: Disable normal calculation in FFT for speed)
-				//mesh->getMeshBuffer(b)->getNormal(i).X = -1*vertices[i].nx;
-				//mesh->getMeshBuffer(b)->getNormal(i).Y = vertices[i].ny;
-				//mesh->getMeshBuffer(b)->getNormal(i).Z = vertices[i].nz;
-            }
-            //Manually recalculate normals
-            SceneManager->getMeshManipulator()->recalculateNormals(mesh->getMeshBuffer(b));
-        }// end for all mesh buffers
-		mesh->setDirty(scene::EBT_VERTEX);
+		//Update from the FFT Calculation, running on the ocean thread
+		interpolateSnapshots(time);
 	}
 
 	IMeshSceneNode::OnAnimate(timeMs);
@@ -416,128 +532,83 @@ void MovingWaterSceneNode::OnAnimate(irr::u32 timeMs)
 
 irr::f32 MovingWaterSceneNode::getWaveHeight(irr::f32 relPosX, irr::f32 relPosZ) const
 {
-
-    //Adjust relative position by 1/2 tile width
-
-
-    //Get the wave height (not including tide height) at this position relative to the origin of the water
-    irr::f32 relPosXInternal = fmod(relPosX+tileWidth/2,tileWidth);
-    irr::f32 relPosZInternal = fmod(relPosZ+tileWidth/2,tileWidth);
-
-    //TODO: Probably not needed?
-    while (relPosXInternal < 0)
-        relPosXInternal+=tileWidth;
-    while (relPosZInternal < 0)
-        relPosZInternal+=tileWidth;
-
-    irr::f32 xIndexFloat = (irr::f32)(segments+1)*relPosXInternal/tileWidth;
-    irr::f32 zIndexFloat = (irr::f32)(segments+1)*relPosZInternal/tileWidth;
-    xIndexFloat = (segments+1) - xIndexFloat; //Sign of x is flipped when heights are applied!
-
-    //std::cout << "xIndexF:" << xIndexFloat << " zIndexF:" << zIndexFloat << " segments+1:" << segments+1 << std::endl;
-
-    //Bilinear interpolation
-    unsigned int xIndex0 = floor(xIndexFloat);
-    unsigned int zIndex0 = floor(zIndexFloat);
-    unsigned int xIndex1 = ceil(xIndexFloat);
-    unsigned int zIndex1 = ceil(zIndexFloat);
-
-    //If any indexes are equal to segments+1, set to 0 (as sea tiles)
-    if (xIndex0 == (segments+1)) {xIndex0=0;}
-    if (zIndex0 == (segments+1)) {zIndex0=0;}
-    if (xIndex1 == (segments+1)) {xIndex1=0;}
-    if (zIndex1 == (segments+1)) {zIndex1=0;}
-
-    irr::f32 interpX = xIndexFloat - xIndex0;
-    irr::f32 interpZ = zIndexFloat - zIndex0;
-
-    unsigned int index00 = (segments+1) * zIndex0 + xIndex0;
-    unsigned int index01 = (segments+1) * zIndex1 + xIndex0;
-    unsigned int index10 = (segments+1) * zIndex0 + xIndex1;
-    unsigned int index11 = (segments+1) * zIndex1 + xIndex1;
-
-    vertex_ocean* vertices = ocean->getVertices();
-
-    //Error checking here?
-    irr::f32 height00 = vertices[index00].y;
-    irr::f32 height01 = vertices[index01].y;
-    irr::f32 height10 = vertices[index10].y;
-    irr::f32 height11 = vertices[index11].y;
-
-
-    irr::f32 localHeight = height00*(1-interpX)*(1-interpZ) + height10*interpX*(1-interpZ) + height01*(1-interpX)*interpZ + height11*interpX*interpZ;
-
-    if (localisnan(localHeight) || localisinf(localHeight)) {
-        return 0;
-    } else {
-        return localHeight;
-    }
-
+    irr::f32 height;
+    getWaveHeightsAndNormals(&relPosX,&relPosZ,&height,0,1);
+    return height;
 }
 
 irr::core::vector2df MovingWaterSceneNode::getLocalNormals(irr::f32 relPosX, irr::f32 relPosZ) const
 {
+    irr::f32 height;
+    irr::core::vector2df normals;
+    getWaveHeightsAndNormals(&relPosX,&relPosZ,&height,&normals,1);
+    return normals;
+}
 
-    //Adjust relative position by 1/2 tile width
-
-    //Get the wave normal
-    irr::f32 relPosXInternal = fmod(relPosX+tileWidth/2,tileWidth);
-    irr::f32 relPosZInternal = fmod(relPosZ+tileWidth/2,tileWidth);
-
-    //TODO: Probably not needed?
-    while (relPosXInternal < 0)
-        relPosXInternal+=tileWidth;
-    while (relPosZInternal < 0)
-        relPosZInternal+=tileWidth;
-
-    irr::f32 xIndexFloat = (irr::f32)(segments+1)*relPosXInternal/tileWidth;
-    irr::f32 zIndexFloat = (irr::f32)(segments+1)*relPosZInternal/tileWidth;
-    xIndexFloat = (segments+1) - xIndexFloat; //Sign of x is flipped when heights are applied!
-
-    //std::cout << "xIndexF:" << xIndexFloat << " zIndexF:" << zIndexFloat << " segments+1:" << segments+1 << std::endl;
-
-    //Bilinear interpolation
-    unsigned int xIndex0 = floor(xIndexFloat);
-    unsigned int zIndex0 = floor(zIndexFloat);
-    unsigned int xIndex1 = ceil(xIndexFloat);
-    unsigned int zIndex1 = ceil(zIndexFloat);
-
-    //If any indexes are equal to segments+1, set to 0 (as sea tiles)
-    if (xIndex0 == (segments+1)) {xIndex0=0;}
-    if (zIndex0 == (segments+1)) {zIndex0=0;}
-    if (xIndex1 == (segments+1)) {xIndex1=0;}
-    if (zIndex1 == (segments+1)) {zIndex1=0;}
-
-    irr::f32 interpX = xIndexFloat - xIndex0;
-    irr::f32 interpZ = zIndexFloat - zIndex0;
-
-    unsigned int index00 = (segments+1) * zIndex0 + xIndex0;
-    unsigned int index01 = (segments+1) * zIndex1 + xIndex0;
-    unsigned int index10 = (segments+1) * zIndex0 + xIndex1;
-    unsigned int index11 = (segments+1) * zIndex1 + xIndex1;
-
-    vertex_ocean* vertices = ocean->getVertices();
-
-    //Error checking here?
-    irr::f32 nx00 = vertices[index00].nx;
-    irr::f32 nx01 = vertices[index01].nx;
-    irr::f32 nx10 = vertices[index10].nx;
-    irr::f32 nx11 = vertices[index11].nx;
-
-    irr::f32 nz00 = vertices[index00].nz;
-    irr::f32 nz01 = vertices[index01].nz;
-    irr::f32 nz10 = vertices[index10].nz;
-    irr::f32 nz11 = vertices[index11].nz;
+void MovingWaterSceneNode::getWaveHeightsAndNormals(const irr::f32* relPosX, const irr::f32* relPosZ, irr::f32* heights, irr::core::vector2df* normals, irr::u32 n) const
+{
+    const irr::video::S3DVertex* vertices = getDisplayedVertices(); //As displayed, not the ocean thread's latest
+    const irr::u32 pointsPerSide = segments+1;
+    const irr::f32 indexScale = (irr::f32)pointsPerSide/tileWidth;
+
+    for (irr::u32 i = 0; i < n; i++) {
+        //Get the wave height (not including tide height) and normals at this position relative to the origin of the water
+        //Adjust relative position by 1/2 tile width
+        irr::f32 relPosXInternal = fmod(relPosX[i]+tileWidth/2,tileWidth);
+        irr::f32 relPosZInternal = fmod(relPosZ[i]+tileWidth/2,tileWidth);
+        if (relPosXInternal < 0) {
+            relPosXInternal+=tileWidth;
+        }
+        if (relPosZInternal < 0) {
+            relPosZInternal+=tileWidth;
+        }
 
-    irr::f32 localNx = nx00*(1-interpX)*(1-interpZ) + nx10*interpX*(1-interpZ) + nx01*(1-interpX)*interpZ + nx11*interpX*interpZ;
-    irr::f32 localNz = nz00*(1-interpX)*(1-interpZ) + nz10*interpX*(1-interpZ) + nz01*(1-interpX)*interpZ + nz11*interpX*interpZ;
+        irr::f32 xIndexFloat = pointsPerSide - relPosXInternal*indexScale; //Sign of x is flipped when heights are applied!
+        irr::f32 zIndexFloat = relPosZInternal*indexScale;
+
+        //Bilinear interpolation
+        irr::u32 xIndex0 = floor(xIndexFloat);
+        irr::u32 zIndex0 = floor(zIndexFloat);
+        irr::u32 xIndex1 = ceil(xIndexFloat);
+        irr::u32 zIndex1 = ceil(zIndexFloat);
+
+        irr::f32 interpX = xIndexFloat - xIndex0;
+        irr::f32 interpZ = zIndexFloat - zIndex0;
+
+        //If any indexes are equal to segments+1, set to 0 (as sea tiles)
+        if (xIndex0 >= pointsPerSide) {xIndex0=0;}
+        if (zIndex0 >= pointsPerSide) {zIndex0=0;}
+        if (xIndex1 >= pointsPerSide) {xIndex1=0;}
+        if (zIndex1 >= pointsPerSide) {zIndex1=0;}
+
+        const irr::video::S3DVertex& vertex00 = vertices[pointsPerSide * zIndex0 + xIndex0];
+        const irr::video::S3DVertex& vertex01 = vertices[pointsPerSide * zIndex1 + xIndex0];
+        const irr::video::S3DVertex& vertex10 = vertices[pointsPerSide * zIndex0 + xIndex1];
+        const irr::video::S3DVertex& vertex11 = vertices[pointsPerSide * zIndex1 + xIndex1];
+
+        const irr::f32 weight00 = (1-interpX)*(1-interpZ);
+        const irr::f32 weight10 = interpX*(1-interpZ);
+        const irr::f32 weight01 = (1-interpX)*interpZ;
+        const irr::f32 weight11 = interpX*interpZ;
+
+        irr::f32 localHeight = vertex00.Pos.Y*weight00 + vertex10.Pos.Y*weight10 + vertex01.Pos.Y*weight01 + vertex11.Pos.Y*weight11;
+        if (localisnan(localHeight) || localisinf(localHeight)) {
+            heights[i] = 0;
+        } else {
+            heights[i] = localHeight;
+        }
 
-    if (localisnan(localNx) || localisinf(localNx) || localisnan(localNz) || localisinf(localNz)) {
-        return irr::core::vector2df(0,0);
-    } else {
-        return irr::core::vector2df(localNx,localNz);
+        if (normals) {
+            //Normals in the ocean's own coordinates, with x the other way round to the mesh
+            irr::f32 localNx = -(vertex00.Normal.X*weight00 + vertex10.Normal.X*weight10 + vertex01.Normal.X*weight01 + vertex11.Normal.X*weight11);
+            irr::f32 localNz = vertex00.Normal.Z*weight00 + vertex10.Normal.Z*weight10 + vertex01.Normal.Z*weight01 + vertex11.Normal.Z*weight11;
+            if (localisnan(localNx) || localisinf(localNx) || localisnan(localNz) || localisinf(localNz)) {
+                normals[i] = irr::core::vector2df(0,0);
+            } else {
+                normals[i] = irr::core::vector2df(localNx,localNz);
+            }
+        }
     }
-
 }
 
 void MovingWaterSceneNode::setMesh(IMesh* mesh)
@@ -26,6 +26,11 @@
 
 #include "FFTWave.hpp"
 
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace irr
 {
 namespace scene
@@ -78,6 +83,7 @@ namespace scene
 
 		f32 getWaveHeight(f32 relPosX, f32 relPosZ) const;
 		irr::core::vector2df getLocalNormals(irr::f32 relPosX, irr::f32 relPosZ) const;
+		void getWaveHeightsAndNormals(const f32* relPosX, const f32* relPosZ, f32* heights, core::vector2df* normals, u32 n) const; //As getWaveHeight() and getLocalNormals() for n points. normals can be 0 if not needed.
 
 
 	private:
@@ -109,6 +115,40 @@ namespace scene
 		IMesh* mesh;
 		IMesh* flatMesh;
 		cOcean* ocean;
+		f32 oceanA; //Parameters last passed to the ocean
+		vector2 oceanW;
+
+		//The ocean is evaluated on a background thread, every oceanUpdatePeriod of animation time, one snapshot ahead of the displayed
+		//time. Snapshots are passed back through a triple buffer: the thread fills workerSnapshot, then swaps it with pendingSnapshot,
+		//and OnAnimate() takes pendingSnapshot as frontSnapshot once the displayed time reaches the current front one, keeping the
+		//old front as previousSnapshot. Snapshots are already in the mesh's vertex format and orientation, so OnAnimate() just
+		//interpolates between previous and front straight into the mesh buffer, which getWaveHeight() and getLocalNormals() then
+		//read, so these all see the same waves. Only the main thread uses frontSnapshot and previousSnapshot.
+		struct OceanSnapshot {
+			f32 time;
+			core::array<video::S3DVertex> vertices; //As the mesh buffer, with only the positions and normals changed
+		};
+		OceanSnapshot oceanSnapshots[4];
+		u32 workerSnapshot;
+		u32 pendingSnapshot;
+		u32 frontSnapshot;
+		u32 previousSnapshot;
+		f32 oceanUpdatePeriod; //s
+
+		//Shared with the ocean thread: only changed with snapshotMutex held
+		std::mutex snapshotMutex;
+		std::condition_variable snapshotCondition; //Signalled when the pending snapshot is taken, or the thread should stop
+		bool pendingSnapshotFresh; //Set when the thread has filled pendingSnapshot, cleared when it is taken
+		f32 newestSnapshotTime; //Time of the last snapshot the thread made
+		f32 displayedTime; //Latest time from OnAnimate()
+		bool oceanStopRequested;
+		std::mutex oceanMutex; //Held by the thread while evaluating the ocean, and to change its parameters
+		std::thread oceanThread;
+
+		void oceanThreadLoop();
+		void copyOceanVertices(OceanSnapshot& snapshot) const; //Call with oceanMutex held
+		void interpolateSnapshots(f32 time); //Into the mesh
+		const video::S3DVertex* getDisplayedVertices() const;
 
 		core::aabbox3d<f32> boundingBox;
 
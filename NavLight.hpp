@@ -29,7 +29,6 @@ class NavLight {
         void update(irr::f32 scenarioTime, irr::u32 lightLevel);
         irr::core::vector3df getPosition() const;
         void setPosition(irr::core::vector3df position);
-        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
 
     private:
         irr::scene::ISceneManager* smgr;
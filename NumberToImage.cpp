@@ -15,7 +15,6 @@
      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
 
 #include "NumberToImage.hpp"
-#include <vector>
 
 //using namespace irr;
 
@@ -25,69 +24,122 @@ namespace NumberToImage
     const irr::u32 PADDING_PX = 1;
     const irr::video::SColor BG_COLOUR = irr::video::SColor(0,0,0,0);
 
-    irr::video::IImage* getImage(irr::u32 number, irr::IrrlichtDevice* dev)
+    GlyphAtlas::GlyphAtlas() : atlas(0), maxHeight(0)
     {
 
-        irr::core::stringc numberString = irr::core::stringc(number);
-        const irr::u32 length = numberString.size();
-        //irr::u32 imageWidth = length * CHAR_WIDTH;
-        //irr::u32 imageHeight = CHAR_HEIGHT;
-
-        if (length > 0) {
-
-			std::vector<irr::video::IImage*> numberImages;
-			numberImages.resize(length);
-            //video::IImage* numberImages[length];
-            irr::u32 overallWidth = 0;
-            irr::u32 maxHeight = 0;
-            //video::IImage* numberImage = dev->getVideoDriver()->createImage(video::ECF_R8G8B8, irr::core::dimension2d<irr::u32>(imageWidth, imageHeight));
-
-            for (irr::u32 character = 0; character<length; character++) {
-                //Load character image from file (charName.png)
-                char thisChar = numberString.c_str()[character];
-
-                irr::io::path imagePath = "media/Char";
-                imagePath.append(thisChar);
-                imagePath += ".png";
-
-                numberImages[character] = dev->getVideoDriver()->createImageFromFile(imagePath);
-                if (numberImages[character]) {
-                    overallWidth+= numberImages[character]->getDimension().Width + PADDING_PX; //Padding at end
-                    if (numberImages[character]->getDimension().Height > maxHeight) {
-                        maxHeight = numberImages[character]->getDimension().Height;
-                    }
-                }
+    }
 
+    GlyphAtlas::~GlyphAtlas()
+    {
+        if (atlas) {
+            atlas->drop();
+        }
+    }
 
+    bool GlyphAtlas::load(irr::IrrlichtDevice* dev)
+    {
+        if (atlas) {
+            atlas->drop();
+            atlas = 0;
+        }
+        maxHeight = 0;
+
+        //Load character images from file (media/Char<digit>.png)
+        irr::video::IImage* digitImages[10];
+        irr::u32 overallWidth = 0;
+        for (irr::u32 digit = 0; digit < 10; digit++) {
+            irr::io::path imagePath = "media/Char";
+            imagePath += digit;
+            imagePath += ".png";
+            digitImages[digit] = dev->getVideoDriver()->createImageFromFile(imagePath);
+            if (digitImages[digit]) {
+                overallWidth += digitImages[digit]->getDimension().Width;
+                if (digitImages[digit]->getDimension().Height > maxHeight) {
+                    maxHeight = digitImages[digit]->getDimension().Height;
+                }
             }
+        }
 
-            if (overallWidth>0) {
-            	irr::video::IImage* numberImage = dev->getVideoDriver()->createImage(irr::video::ECF_A8R8G8B8, irr::core::dimension2d<irr::u32>(overallWidth, maxHeight));
-                if (!numberImage) {
-                    return 0;
-                }
+        if (overallWidth > 0) {
+            atlas = dev->getVideoDriver()->createImage(irr::video::ECF_A8R8G8B8, irr::core::dimension2d<irr::u32>(overallWidth, maxHeight));
+            if (atlas) {
+                atlas->fill(BG_COLOUR); //Transparent
+            }
+        }
 
-                numberImage->fill(BG_COLOUR); //Transparent
-                //paste in the characters
-                irr::u32 nextXStart = 0;
-                for (irr::u32 character = 0; character<length; character++) {
-                    if (numberImages[character]) {
-                        irr::core::rect<irr::s32> sourceRect = irr::core::rect<irr::s32>(0,0,numberImages[character]->getDimension().Width,numberImages[character]->getDimension().Height);
-                        numberImages[character]->copyToWithAlpha(numberImage,irr::core::vector2d<irr::s32>(nextXStart,0),sourceRect,irr::video::SColor(255,255,255,255));
-                        nextXStart += numberImages[character]->getDimension().Width + PADDING_PX;
-                        numberImages[character]->drop();
-                    }
+        //Copy each digit in side by side, keeping its alpha
+        irr::s32 nextXStart = 0;
+        for (irr::u32 digit = 0; digit < 10; digit++) {
+            glyphs[digit] = irr::core::rect<irr::s32>(0,0,0,0);
+            if (digitImages[digit]) {
+                if (atlas) {
+                    irr::core::dimension2d<irr::u32> size = digitImages[digit]->getDimension();
+                    digitImages[digit]->copyTo(atlas,irr::core::position2d<irr::s32>(nextXStart,0));
+                    glyphs[digit] = irr::core::rect<irr::s32>(nextXStart,0,nextXStart+size.Width,size.Height);
+                    nextXStart += size.Width;
                 }
-                return numberImage;
-            } else {
-                return 0;
+                digitImages[digit]->drop();
             }
+        }
 
-        } else {
-            return 0;
+        return atlas != 0;
+    }
+
+    irr::u32 GlyphAtlas::getDigits(irr::u32 number, irr::u8* digits) const
+    {
+        irr::u8 reversed[10];
+        irr::u32 length = 0;
+        do {
+            reversed[length++] = number % 10;
+            number /= 10;
+        } while (number > 0);
+
+        for (irr::u32 i = 0; i < length; i++) {
+            digits[i] = reversed[length-1-i];
         }
+        return length;
+    }
 
+    irr::core::dimension2d<irr::u32> GlyphAtlas::getSize(irr::u32 number) const
+    {
+        irr::u8 digits[10];
+        irr::u32 length = getDigits(number, digits);
+
+        irr::u32 overallWidth = 0;
+        for (irr::u32 i = 0; i < length; i++) {
+            if (glyphs[digits[i]].getWidth() > 0) {
+                overallWidth += glyphs[digits[i]].getWidth() + PADDING_PX; //Padding at end
+            }
+        }
+        if (overallWidth == 0) {
+            return irr::core::dimension2d<irr::u32>(0,0);
+        }
+        return irr::core::dimension2d<irr::u32>(overallWidth, maxHeight);
     }
 
-}
+    irr::core::rect<irr::s32> GlyphAtlas::draw(irr::u32 number, irr::video::IImage* target, irr::core::position2d<irr::s32> position) const
+    {
+        if (!atlas || !target) {
+            return irr::core::rect<irr::s32>(position,position);
+        }
 
+        irr::u8 digits[10];
+        irr::u32 length = getDigits(number, digits);
+
+        //Blend in each character from the atlas
+        irr::s32 nextXStart = position.X;
+        for (irr::u32 i = 0; i < length; i++) {
+            const irr::core::rect<irr::s32>& glyph = glyphs[digits[i]];
+            if (glyph.getWidth() > 0) {
+                atlas->copyToWithAlpha(target,irr::core::position2d<irr::s32>(nextXStart,position.Y),glyph,irr::video::SColor(255,255,255,255));
+                nextXStart += glyph.getWidth() + PADDING_PX;
+            }
+        }
+
+        if (nextXStart == position.X) {
+            return irr::core::rect<irr::s32>(position,position);
+        }
+        return irr::core::rect<irr::s32>(position.X,position.Y,nextXStart,position.Y+maxHeight);
+    }
+
+}
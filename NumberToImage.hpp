@@ -22,7 +22,27 @@
 namespace NumberToImage
 {
 
-    irr::video::IImage* getImage(irr::u32 number, irr::IrrlichtDevice* dev);
+    //The digit images (media/Char0.png to Char9.png), loaded once into a single image, so numbers can be drawn into another
+    //image without loading or allocating anything.
+    class GlyphAtlas
+    {
+        public:
+            GlyphAtlas();
+            ~GlyphAtlas();
+            bool load(irr::IrrlichtDevice* dev); //Returns false if none of the digits could be loaded
+            irr::core::dimension2d<irr::u32> getSize(irr::u32 number) const; //Size of the number when drawn
+            irr::core::rect<irr::s32> draw(irr::u32 number, irr::video::IImage* target, irr::core::position2d<irr::s32> position) const; //Blends the number into target, with its top left at position. Returns the area drawn on, before clipping to target.
+
+        private:
+            GlyphAtlas(const GlyphAtlas&); //Not copyable
+            GlyphAtlas& operator=(const GlyphAtlas&);
+
+            irr::u32 getDigits(irr::u32 number, irr::u8* digits) const; //Most significant first, into digits[10]. Returns how many.
+
+            irr::video::IImage* atlas;
+            irr::core::rect<irr::s32> glyphs[10]; //Area of each digit in atlas, empty if it couldn't be loaded
+            irr::u32 maxHeight;
+    };
 
 }
 
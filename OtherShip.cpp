@@ -141,6 +141,7 @@ OtherShip::OtherShip (const std::string& name,const irr::core::vector3df& locati
 
     //store leg information
     legs=legsLoaded;
+    currentLeg = 0;
 }
 
 OtherShip::~OtherShip()
@@ -152,38 +153,39 @@ OtherShip::~OtherShip()
     navLights.clear();
 }
 
-void OtherShip::update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel)
+bool OtherShip::getLegMotion(irr::f32 scenarioTime, irr::f32& hdg, irr::f32& spd)
 {
-
-    //move according to leg information
     if (legs.empty()) {
         //Don't change speed and hdg - may be in secondary mode, where these are set externally
-    } else {
-        //Work out which leg we're on
-        std::vector<Leg>::size_type currentLeg = findCurrentLeg(scenarioTime);
-
-        spd = legs[currentLeg].speed*KTS_TO_MPS;
-        hdg = legs[currentLeg].bearing;
+        return false;
     }
 
-    if (!positionManuallyUpdated) { //If the position has already been updated, skip (for this loop only)
-        xPos = xPos + sin(hdg*irr::core::DEGTORAD)*spd*deltaTime;
-        zPos = zPos + cos(hdg*irr::core::DEGTORAD)*spd*deltaTime;
-    } else {
-        positionManuallyUpdated = false;
-    }
-    yPos = tideHeight+heightCorrection;
+    //Work out which leg we're on
+    std::vector<Leg>::size_type legNumber = findCurrentLeg(scenarioTime);
+    spd = legs[legNumber].speed*KTS_TO_MPS;
+    hdg = legs[legNumber].bearing;
+    return true;
+}
 
-    //Set position & speed by calling ship methods
-    //setPosition(irr::core::vector3df(xPos,yPos,zPos));
-    ship->setPosition(irr::core::vector3df(xPos,yPos,zPos));
-    ship->setRotation(irr::core::vector3df(0, hdg+angleCorrection, 0)); //Global vectors
+void OtherShip::setMotionState(irr::f32 xPos, irr::f32 yPos, irr::f32 zPos, irr::f32 hdg, irr::f32 spd)
+{
+    this->xPos = xPos;
+    this->yPos = yPos;
+    this->zPos = zPos;
+    this->hdg = hdg;
+    this->spd = spd;
+    positionManuallyUpdated = false; //Handled by OtherShips
+
+    //Set angles. The scene node is moved to this pose by interpolateNode(), between simulation steps
+    rotation = irr::core::vector3df(0, hdg+angleCorrection, 0); //Global vectors
+}
 
+void OtherShip::updateLights(irr::f32 scenarioTime, irr::u32 lightLevel)
+{
     //for each light, find range and angle
     for(std::vector<NavLight*>::size_type currentLight = 0; currentLight<navLights.size(); currentLight++) {
         navLights[currentLight]->update(scenarioTime, lightLevel);
     }
-
 }
 
 irr::f32 OtherShip::getHeight() const
@@ -245,6 +247,8 @@ void OtherShip::changeLeg(int legNumber, irr::f32 bearing, irr::f32 speed, irr::
             legs.at(i).startTime = legs.at(i-1).startTime + SECONDS_IN_HOUR*legs.at(i-1).distance/legs.at(i-1).speed;
         }
 
+        currentLeg = 0; //Legs changed, so search from the start next time
+
     } //Check leg exists & can be changed
 
 }
@@ -288,6 +292,8 @@ void OtherShip::addLeg(int afterLegNumber, irr::f32 bearing, irr::f32 speed, irr
         }
 
 
+        currentLeg = 0; //Legs changed, so search from the start next time
+
     } //Check leg exists & can be changed
 
 }
@@ -321,6 +327,8 @@ void OtherShip::deleteLeg(int legNumber, irr::f32 scenarioTime)
         //Remove this leg
         legs.erase(legs.begin() + legNumber);
 
+        currentLeg = 0; //Legs changed, so search from the start next time
+
     } //Check leg exists & can be changed
 
 }
@@ -369,9 +377,16 @@ RadarData OtherShip::getRadarData(irr::core::vector3df scannerPosition) const
 
 std::vector<Leg>::size_type OtherShip::findCurrentLeg(irr::f32 scenarioTime)
 {
-    std::vector<Leg>::size_type currentLeg;
+    if (legs.empty()) {
+        return 0;
+    }
+
+    //Time normally only moves forward, so search on from the leg found last time, unless time has gone back before it
+    if (currentLeg >= legs.size() || legs[currentLeg].startTime > scenarioTime) {
+        currentLeg = 0;
+    }
 
-    for(currentLeg = 0; currentLeg<legs.size()-1; currentLeg++) {
+    for(; currentLeg<legs.size()-1; currentLeg++) {
         if (legs[currentLeg].startTime <=scenarioTime && legs[currentLeg+1].startTime > scenarioTime ) {
             break;
         }
@@ -43,7 +43,9 @@ class OtherShip : public Ship
         void addLeg(int afterLegNumber, irr::f32 bearing, irr::f32 speed, irr::f32 distance, irr::f32 scenarioTime);
         void deleteLeg(int legNumber, irr::f32 scenarioTime);
         RadarData getRadarData(irr::core::vector3df scannerPosition) const;
-        void update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel);
+        bool getLegMotion(irr::f32 scenarioTime, irr::f32& hdg, irr::f32& spd); //From the current leg. False, leaving hdg and spd unchanged, if there are no legs (e.g. in secondary mode)
+        void setMotionState(irr::f32 xPos, irr::f32 yPos, irr::f32 zPos, irr::f32 hdg, irr::f32 spd); //After each simulation step, from OtherShips::update()
+        void updateLights(irr::f32 scenarioTime, irr::u32 lightLevel);
 
     protected:
     private:
@@ -54,6 +56,7 @@ class OtherShip : public Ship
         irr::f32 height; //For radar
         irr::f32 solidHeight; //For radar
         irr::f32 rcs;
+        std::vector<Leg>::size_type currentLeg; //Found by the last findCurrentLeg(), where the next search starts. Reset when the legs change.
         std::vector<Leg>::size_type findCurrentLeg(irr::f32 scenarioTime);
 };
 
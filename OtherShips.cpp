@@ -23,6 +23,8 @@
 #include "SimulationModel.hpp"
 #include "ScenarioDataStructure.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream> //debugging
 
 //using namespace irr;
@@ -85,26 +87,68 @@ void OtherShips::load(std::vector<OtherShipData> otherShipsData, irr::f32 scenar
 
         //Create otherShip and load into vector
         otherShips.push_back(new OtherShip (otherShipName,irr::core::vector3df(shipX,0.0f,shipZ),legs,smgr, dev));
+        this->shipX.push_back(shipX);
+        this->shipY.push_back(0);
+        this->shipZ.push_back(shipZ);
+        shipHeadings.push_back(0);
+        shipSpeeds.push_back(0);
+        shipVelocityX.push_back(0);
+        shipVelocityZ.push_back(0);
+        setMotion(otherShips.size()-1, otherShips.back()->getHeading(), otherShips.back()->getSpeed());
+        shipHeightCorrections.push_back(otherShips.back()->getHeightCorrection());
+        waveHeightsFiltered.push_back(0);
+        positionsManuallyUpdated.push_back(0);
     }
+    waveHeights.resize(otherShips.size());
 
 }
 
-void OtherShips::update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel)
+void OtherShips::update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight)
 {
-    for(std::vector<OtherShip*>::iterator it = otherShips.begin(); it != otherShips.end(); ++it) {
+    irr::u32 numberOfShips = otherShips.size();
+    if (numberOfShips == 0) {
+        return;
+    }
 
-        //Find local wave height
-        irr::core::vector3df prevPosition = (*it)->getPosition();
-        irr::f32 waveHeightFiltered = prevPosition.Y - tideHeight - (*it)->getHeightCorrection(); //Calculate the previous wave height:
+    //Speed and heading from each ship's current leg, only recalculating the velocity when on a new leg
+    for(irr::u32 i = 0; i < numberOfShips; i++) {
+        irr::f32 hdg = shipHeadings[i];
+        irr::f32 spd = shipSpeeds[i];
+        if (otherShips[i]->getLegMotion(scenarioTime, hdg, spd) && (hdg != shipHeadings[i] || spd != shipSpeeds[i])) {
+            setMotion(i, hdg, spd);
+        }
+    }
 
-        //Apply up/down motion from waves, with some filtering
-        irr::f32 timeConstant = 0.5;//Time constant in s; TODO: Make dependent on vessel size
-        irr::f32 factor = deltaTime/(timeConstant+deltaTime);
-        waveHeightFiltered = (1-factor) * waveHeightFiltered + factor*model->getWaveHeight(prevPosition.X,prevPosition.Z); //TODO: Check implementation of simple filter!
+    //Find local wave heights for all the ships at once
+    model->getWaveHeightsAndNormals(&shipX[0],&shipZ[0],&waveHeights[0],0,numberOfShips);
 
-        (*it)->update(deltaTime, scenarioTime, tideHeight+waveHeightFiltered, lightLevel);
+    //Move all the ships. These loops have no branches or calls, and few enough arrays that the compiler can vectorise them.
+    for(irr::u32 i = 0; i < numberOfShips; i++) {
+        irr::f32 movingTime = deltaTime*(1 - positionsManuallyUpdated[i]); //If the position has been set, don't move (for this update only)
+        shipX[i] += shipVelocityX[i]*movingTime;
+        shipZ[i] += shipVelocityZ[i]*movingTime;
+    }
+    std::fill(positionsManuallyUpdated.begin(), positionsManuallyUpdated.end(), 0);
+
+    //Apply up/down motion from waves, with some filtering
+    irr::f32 timeConstant = 0.5;//Time constant in s; TODO: Make dependent on vessel size
+    irr::f32 factor = deltaTime/(timeConstant+deltaTime);
+    for(irr::u32 i = 0; i < numberOfShips; i++) {
+        waveHeightsFiltered[i] = (1-factor) * waveHeightsFiltered[i] + factor*waveHeights[i]; //TODO: Check implementation of simple filter!
+        shipY[i] = tideHeight + shipHeightCorrections[i] + waveHeightsFiltered[i];
     }
 
+    //Copy back to each ship, for the radar, collision checks and interpolateNodes()
+    for(irr::u32 i = 0; i < numberOfShips; i++) {
+        otherShips[i]->setMotionState(shipX[i], shipY[i], shipZ[i], shipHeadings[i], shipSpeeds[i]);
+    }
+}
+
+void OtherShips::updateLights(irr::f32 scenarioTime, irr::u32 lightLevel)
+{
+    for(std::vector<OtherShip*>::iterator it = otherShips.begin(); it != otherShips.end(); ++it) {
+        (*it)->updateLights(scenarioTime, lightLevel);
+    }
 }
 
 RadarData OtherShips::getRadarData(irr::u32 number, irr::core::vector3df scannerPosition) const
@@ -132,6 +176,15 @@ irr::core::vector3df OtherShips::getPosition(int number) const
     }
 }
 
+irr::scene::ISceneNode* OtherShips::getSceneNode(int number) const
+{
+    if (number < (int)otherShips.size() && number >= 0) {
+        return otherShips.at(number)->getSceneNode();
+    } else {
+        return 0;
+    }
+}
+
 irr::f32 OtherShips::getLength(int number) const
 {
     if (number < (int)otherShips.size() && number >= 0) {
@@ -172,6 +225,7 @@ void OtherShips::setSpeed(int number, irr::f32 speed)
 {
     if (number < (int)otherShips.size() && number >= 0) {
         otherShips.at(number)->setSpeed(speed);
+        setMotion(number, shipHeadings[number], speed);
     }
 }
 
@@ -179,6 +233,9 @@ void OtherShips::setPos(int number, irr::f32 positionX, irr::f32 positionZ)
 {
     if (number < (int)otherShips.size() && number >= 0) {
         otherShips.at(number)->setPosition(positionX,positionZ);
+        shipX[number] = positionX;
+        shipZ[number] = positionZ;
+        positionsManuallyUpdated[number] = 1;
     }
 }
 
@@ -186,6 +243,7 @@ void OtherShips::setHeading(int number, irr::f32 hdg)
 {
     if (number < (int)otherShips.size() && number >= 0) {
         otherShips.at(number)->setHeading(hdg);
+        setMotion(number, hdg, shipSpeeds[number]);
     }
 }
 
@@ -234,8 +292,33 @@ std::string OtherShips::getName(int number) const
 }
 
 void OtherShips::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
+{
+    for(irr::u32 i = 0; i < otherShips.size(); i++) {
+        otherShips[i]->moveNode(deltaX,deltaY,deltaZ);
+        shipX[i] += deltaX;
+        shipY[i] += deltaY;
+        shipZ[i] += deltaZ;
+    }
+}
+
+void OtherShips::savePoses()
 {
     for(std::vector<OtherShip*>::iterator it = otherShips.begin(); it != otherShips.end(); ++it) {
-        (*it)->moveNode(deltaX,deltaY,deltaZ);
+        (*it)->savePose();
     }
 }
+
+void OtherShips::interpolateNodes(irr::f32 alpha)
+{
+    for(std::vector<OtherShip*>::iterator it = otherShips.begin(); it != otherShips.end(); ++it) {
+        (*it)->interpolateNode(alpha);
+    }
+}
+
+void OtherShips::setMotion(irr::u32 number, irr::f32 hdg, irr::f32 spd)
+{
+    shipHeadings[number] = hdg;
+    shipSpeeds[number] = spd;
+    shipVelocityX[number] = std::sin(hdg*irr::core::DEGTORAD)*spd;
+    shipVelocityZ[number] = std::cos(hdg*irr::core::DEGTORAD)*spd;
+}
@@ -37,10 +37,12 @@ class OtherShips
         OtherShips();
         ~OtherShips();
         void load(std::vector<OtherShipData> otherShipsData, irr::f32 scenarioStartTime, OperatingMode::Mode mode, irr::scene::ISceneManager* smgr, SimulationModel* model, irr::IrrlichtDevice* dev);
-        void update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight, irr::u32 lightLevel);
+        void update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHeight); //One simulation step for all the ships
+        void updateLights(irr::f32 scenarioTime, irr::u32 lightLevel); //Once per frame
         RadarData getRadarData(irr::u32 number, irr::core::vector3df scannerPosition) const;
         irr::u32 getNumber() const;
         irr::core::vector3df getPosition(int number) const;
+        irr::scene::ISceneNode* getSceneNode(int number) const;
         irr::f32 getLength(int number) const;
         irr::f32 getWidth(int number) const;
         irr::f32 getHeading(int number) const;
@@ -54,10 +56,27 @@ class OtherShips
         void deleteLeg(int shipNumber, int legNumber, irr::f32 scenarioTime);
         std::string getName(int number) const;
         void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
+        void savePoses(); //Before each simulation step
+        void interpolateNodes(irr::f32 alpha); //Put the scene nodes between the last two simulation steps, alpha from 0 (previous) to 1 (latest)
 
     private:
         std::vector<OtherShip*> otherShips;
         SimulationModel* model;
+
+        //Motion of all the ships, [ship number], moved together in update() and then copied to each OtherShip. Changes from outside
+        //(setPos(), setHeading(), setSpeed() and moveNode()) are made here too, so these are always the latest.
+        std::vector<irr::f32> shipX;
+        std::vector<irr::f32> shipY;
+        std::vector<irr::f32> shipZ;
+        std::vector<irr::f32> shipHeadings; //Deg
+        std::vector<irr::f32> shipSpeeds; //m/s
+        std::vector<irr::f32> shipVelocityX; //m/s, from the heading and speed, only recalculated when these change
+        std::vector<irr::f32> shipVelocityZ;
+        std::vector<irr::f32> shipHeightCorrections;
+        std::vector<irr::f32> waveHeightsFiltered;
+        std::vector<irr::u8> positionsManuallyUpdated; //1 if set by setPos(), so not moved in the next update
+        std::vector<irr::f32> waveHeights; //Kept between updates to save reallocating
+        void setMotion(irr::u32 number, irr::f32 hdg, irr::f32 spd); //Heading, speed and velocity
 };
 
 #endif
@@ -633,9 +633,8 @@ void OwnShip::update(irr::f32 deltaTime, irr::f32 scenarioTime, irr::f32 tideHei
     if (rollPeriod>0)
         {roll = weather*rollAngle*sin(scenarioTime*2*PI/rollPeriod);}
 
-    //Set position & angles
-    ship->setPosition(irr::core::vector3df(xPos,yPos,zPos));
-    ship->setRotation(Angles::irrAnglesFromYawPitchRoll(hdg+angleCorrection,pitch,roll));
+    //Set angles. The scene node is moved to this pose by interpolateNode(), between simulation steps
+    rotation = Angles::irrAnglesFromYawPitchRoll(hdg+angleCorrection,pitch,roll);
 
 }
 
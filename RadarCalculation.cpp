@@ -24,12 +24,10 @@
 #include "Angles.hpp"
 #include "Constants.hpp"
 #include "IniFile.hpp"
-#include "NumberToImage.hpp"
 #include "Utilities.hpp"
 
 #include <iostream>
 #include <cmath>
-#include <cstdlib> //For rand()
 #include <algorithm> //For sort()
 
 ////using namespace irr;
@@ -54,19 +52,7 @@ RadarCalculation::RadarCalculation() : rangeResolution(64)
     arpaOn = false;
     largestARPADisplayId = 0;
 
-    //initialise scanArray size (360 x rangeResolution points per scan)
-    //rangeResolution = 64; now set initialiser list
-    scanArray.resize(360,std::vector<irr::f32>(rangeResolution,0.0));
-    scanArrayAmplified.resize(360,std::vector<irr::f32>(rangeResolution,0.0));
-    scanArrayAmplifiedPrevious.resize(360,std::vector<irr::f32>(rangeResolution,0.0));
-
-    //initialise arrays
-    for(irr::u32 i = 0; i<360; i++) {
-        for(irr::u32 j = 0; j<rangeResolution; j++) {
-            scanArray[i][j] = 0.0;
-            scanArrayAmplified[i][j] = 0.0;
-        }
-    }
+    arpaEstimatesLargestId = 0;
 
     //Hard coded in GUI and here for 10 parallel index lines
     for(irr::u32 i=0; i<10; i++) {
@@ -74,20 +60,53 @@ RadarCalculation::RadarCalculation() : rangeResolution(64)
         piRanges.push_back(0.0);
     }
 
+    rangeTablesStale = true; //Build the per range cell tables on the first scan, once the radar ranges are loaded
+    rangeCellLength = 0;
+    terrainProfileGeneration = 0;
+
+    //Render lookup tables are built on the first render, once the display size is known
+    renderTablesRadiusPx = 0;
+    renderTablesSpokes = 0;
+    bearingBinShift = 0;
+    bearingLookupShift = 0;
+
+    //Dirty tile grid is sized on the first render, to match the images
+    dirtyTilesX = 0;
+    dirtyTilesY = 0;
+    recomposeAll = true;
+
     radarScreenStale = true;
     radarRadiusPx = 10; //Set to an arbitrary value initially, will be set later.
 
-    currentScanAngle=0;
+    //Same noise sequence every run, unless a different seed is set
+    noiseRandom.setSeed(1);
+    noiseUniforms.assign(6*rangeResolution,0.0);
+    spokeNoise.assign(rangeResolution,0.0);
+    spokeSeaClutter.assign(rangeResolution,0.0);
+    terrainSampleX.assign(rangeResolution,0.0);
+    terrainSampleZ.assign(rangeResolution,0.0);
+
+    //initialise scan buffers, with 2 degrees per spoke until the radar config is loaded
+    //rangeResolution = 64; now set initialiser list
+    setNumberOfSpokes(180);
+
+    //Scan runs in update() unless startScanThread() is called
+    scanThreadRunning = false;
+    scanThreadStopRequested = false;
+    scanInputValid = false;
+    pendingScanTime = 0;
+    unsubmittedScanTime = 0;
 }
 
 RadarCalculation::~RadarCalculation()
 {
-    //dtor
+    stopScanThread();
 }
 
 void RadarCalculation::load(std::string radarConfigFile, irr::IrrlichtDevice* dev)
 {
     device = dev;
+    numberGlyphs.load(dev);
 
     //Load parameters from the radarConfig file (if it exists)
     irr::u32 numberOfRadarRanges = IniFile::iniFileTou32(radarConfigFile,"NumberOfRadarRanges");
@@ -105,7 +124,7 @@ void RadarCalculation::load(std::string radarConfigFile, irr::IrrlichtDevice* de
         //Initial radar range
         radarRangeIndex=3;
 
-        scanAngleStep=2; //Radar angular resolution (integer degree)
+        setNumberOfSpokes(180); //Radar angular resolution (2 degrees)
         radarScannerHeight = 2.0;
         radarNoiseLevel = 0.000000000005;
         radarSeaClutter = 0.000000001;
@@ -137,9 +156,16 @@ void RadarCalculation::load(std::string radarConfigFile, irr::IrrlichtDevice* de
         //Initial radar range
         radarRangeIndex=numberOfRadarRanges/2;
 
-        //Radar angular resolution (integer degree)
-        scanAngleStep=IniFile::iniFileTou32(radarConfigFile,"radar_sensitivity");
-        if (scanAngleStep < 1 || scanAngleStep > 180) {scanAngleStep = 2;}
+        //Radar angular resolution, as a number of spokes per revolution (e.g. 2048), or if not set, from the beam width (integer degree)
+        irr::u32 spokes = IniFile::iniFileTou32(radarConfigFile,"radar_spokes");
+        if (spokes == 0) {
+            irr::u32 scanAngleStep=IniFile::iniFileTou32(radarConfigFile,"radar_sensitivity");
+            if (scanAngleStep < 1 || scanAngleStep > 180) {scanAngleStep = 2;}
+            spokes = Utilities::round(360.0/scanAngleStep);
+        }
+        if (spokes < 2) {spokes = 2;}
+        if (spokes > 4096) {spokes = 4096;}
+        setNumberOfSpokes(spokes);
 
         //Radar scanner height (Metres)
         radarScannerHeight = IniFile::iniFileTof32(radarConfigFile,"radar_height");
@@ -164,22 +190,64 @@ void RadarCalculation::load(std::string radarConfigFile, irr::IrrlichtDevice* de
         radarForegroundColour.setBlue(IniFile::iniFileTou32(radarConfigFile,"radar1_blue"));
 
     }
+
+    rangeTablesStale = true;
+}
+
+void RadarCalculation::setNumberOfSpokes(irr::u32 spokes)
+{
+    numberOfSpokes = spokes;
+    spokeAngle = 360.0/numberOfSpokes;
+    currentSpoke = 0;
+
+    scanArray.assign(numberOfSpokes*rangeResolution,0.0);
+    scanArrayAmplified.assign(numberOfSpokes*rangeResolution,0.0);
+    scanArrayAmplifiedPrevious.assign(numberOfSpokes*rangeResolution,0.0);
+    scanArrayDisplayed.assign(numberOfSpokes*rangeResolution,0.0);
+    spokeUpdated.assign(numberOfSpokes,false);
+    terrainProfile.assign(numberOfSpokes*rangeResolution,0.0);
+    terrainProfileX.assign(numberOfSpokes,0.0);
+    terrainProfileZ.assign(numberOfSpokes,0.0);
+    terrainProfileValid.assign(numberOfSpokes,false);
+    cellColours.assign(numberOfSpokes*rangeResolution,irr::video::SColor(255, 128, 128, 128).color);
+
+    //Sin and cos of each spoke angle, so we don't need to calculate these in the scan loop
+    sinScanAngle.resize(numberOfSpokes);
+    cosScanAngle.resize(numberOfSpokes);
+    for(irr::u32 i = 0; i<numberOfSpokes; i++) {
+        sinScanAngle[i] = sin(i*spokeAngle*irr::core::DEGTORAD);
+        cosScanAngle[i] = cos(i*spokeAngle*irr::core::DEGTORAD);
+    }
+
+    radarScreenStale = true;
 }
 
 void RadarCalculation::decreaseRange()
 {
+    std::lock_guard<std::mutex> lock(scanMutex);
     if (radarRangeIndex>0) {
         radarRangeIndex--;
+        rangeTablesStale = true;
     }
 }
 
 void RadarCalculation::increaseRange()
 {
+    std::lock_guard<std::mutex> lock(scanMutex);
     if (radarRangeIndex<radarRangeNm.size()-1) {
         radarRangeIndex++;
+        rangeTablesStale = true;
     }
 }
 
+void RadarCalculation::setRangeNm(irr::f32 rangeNm)
+{
+    std::lock_guard<std::mutex> lock(scanMutex);
+    radarRangeNm.assign(1, rangeNm);
+    radarRangeIndex = 0;
+    rangeTablesStale = true;
+}
+
 irr::f32 RadarCalculation::getRangeNm() const
 {
     return radarRangeNm.at(radarRangeIndex); //Assume that radarRangeIndex is in bounds
@@ -187,17 +255,29 @@ irr::f32 RadarCalculation::getRangeNm() const
 
 void RadarCalculation::setGain(irr::f32 value)
 {
-    radarGain = value;
+    std::lock_guard<std::mutex> lock(scanMutex);
+    if (radarGain != value) { //If changed
+        radarGain = value;
+        rangeTablesStale = true;
+    }
 }
 
 void RadarCalculation::setClutter(irr::f32 value)
 {
-    radarSeaClutterReduction = value;
+    std::lock_guard<std::mutex> lock(scanMutex);
+    if (radarSeaClutterReduction != value) { //If changed
+        radarSeaClutterReduction = value;
+        rangeTablesStale = true;
+    }
 }
 
 void RadarCalculation::setRainClutter(irr::f32 value)
 {
-    radarRainClutterReduction = value;
+    std::lock_guard<std::mutex> lock(scanMutex);
+    if (radarRainClutterReduction != value) { //If changed
+        radarRainClutterReduction = value;
+        rangeTablesStale = true;
+    }
 }
 
 irr::f32 RadarCalculation::getGain() const
@@ -335,13 +415,23 @@ bool RadarCalculation::getHeadUp() const//Head or course up
     return headUp;
 }
 
+void RadarCalculation::setNoiseSeed(uint64_t seed)
+{
+    std::lock_guard<std::mutex> lock(scanMutex);
+    noiseRandom.setSeed(seed);
+}
+
 void RadarCalculation::setArpaOn(bool on)
 {
+    std::lock_guard<std::mutex> lock(scanMutex);
     arpaOn = on;
     if (!arpaOn) {
         //Clear arpa scans
         arpaContacts.clear();
+        arpaContactIndex.clear();
         largestARPADisplayId = 0;
+        arpaEstimates.clear();
+        arpaEstimatesLargestId = 0;
     }
 }
 
@@ -371,15 +461,15 @@ void RadarCalculation::setRadarDisplayRadius(irr::u32 radiusPx)
 irr::u32 RadarCalculation::getARPAContacts() const
 {
     //Get number of ARPA contacts with a user display ID
-    return largestARPADisplayId;
+    return arpaEstimatesLargestId;
 }
 
 irr::f32 RadarCalculation::getARPACPA(irr::u32 contactID) const
 {
     //Get information for a contact by its user display ID (if it exists), in Nm
-    for (unsigned int i = 0; i<arpaContacts.size(); i++) {
-        if (arpaContacts.at(i).estimate.displayID == contactID) {
-            return arpaContacts.at(i).estimate.cpa;
+    for (unsigned int i = 0; i<arpaEstimates.size(); i++) {
+        if (arpaEstimates.at(i).displayID == contactID) {
+            return arpaEstimates.at(i).cpa;
         }
     }
     return NAN; //If nothing found
@@ -388,9 +478,9 @@ irr::f32 RadarCalculation::getARPACPA(irr::u32 contactID) const
 irr::f32 RadarCalculation::getARPATCPA(irr::u32 contactID) const
 {
     //Get information for a contact by its user display ID (if it exists), in minutes
-    for (unsigned int i = 0; i<arpaContacts.size(); i++) {
-        if (arpaContacts.at(i).estimate.displayID == contactID) {
-            return arpaContacts.at(i).estimate.tcpa;
+    for (unsigned int i = 0; i<arpaEstimates.size(); i++) {
+        if (arpaEstimates.at(i).displayID == contactID) {
+            return arpaEstimates.at(i).tcpa;
         }
     }
     return NAN; //If nothing found
@@ -399,9 +489,9 @@ irr::f32 RadarCalculation::getARPATCPA(irr::u32 contactID) const
 irr::f32 RadarCalculation::getARPASpeed(irr::u32 contactID) const
 {
 	//Get information for a contact by its user display ID (if it exists), in minutes
-	for (unsigned int i = 0; i<arpaContacts.size(); i++) {
-		if (arpaContacts.at(i).estimate.displayID == contactID) {
-			return arpaContacts.at(i).estimate.speed;
+	for (unsigned int i = 0; i<arpaEstimates.size(); i++) {
+		if (arpaEstimates.at(i).displayID == contactID) {
+			return arpaEstimates.at(i).speed;
 		}
 	}
 	return NAN; //If nothing found
@@ -410,14 +500,19 @@ irr::f32 RadarCalculation::getARPASpeed(irr::u32 contactID) const
 irr::f32 RadarCalculation::getARPAHeading(irr::u32 contactID) const
 {
 	//Get information for a contact by its user display ID (if it exists), in minutes
-	for (unsigned int i = 0; i<arpaContacts.size(); i++) {
-		if (arpaContacts.at(i).estimate.displayID == contactID) {
-			return arpaContacts.at(i).estimate.absHeading;
+	for (unsigned int i = 0; i<arpaEstimates.size(); i++) {
+		if (arpaEstimates.at(i).displayID == contactID) {
+			return arpaEstimates.at(i).absHeading;
 		}
 	}
 	return NAN; //If nothing found
 }
 
+const std::vector<irr::core::rect<irr::s32> >& RadarCalculation::getDirtyRegions() const
+{
+    return dirtyRegions;
+}
+
 void RadarCalculation::update(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::core::vector3d<int64_t> offsetPosition, const Terrain& terrain, const OwnShip& ownShip, const Buoys& buoys, const OtherShips& otherShips, irr::f32 weather, irr::f32 rain, irr::f32 tideHeight, irr::f32 deltaTime, uint64_t absoluteTime, irr::core::vector2di mouseRelPosition, bool isMouseDown)
 {
 
@@ -425,11 +520,8 @@ void RadarCalculation::update(irr::video::IImage * radarImage, irr::video::IImag
     if(radarScreenStale) {
         radarImage->fill(irr::video::SColor(255, 128, 128, 128)); //Fill with background colour
         //Reset 'previous' array so it will all get re-drawn
-        for(irr::u32 i = 0; i<360; i++) {
-            for(irr::u32 j = 0; j<rangeResolution; j++) {
-                scanArrayAmplifiedPrevious[i][j] = -1.0;
-            }
-        }
+        std::fill(scanArrayAmplifiedPrevious.begin(),scanArrayAmplifiedPrevious.end(),-1.0);
+        recomposeAll = true;
         radarScreenStale = false;
     }
 
@@ -441,76 +533,255 @@ void RadarCalculation::update(irr::video::IImage * radarImage, irr::video::IImag
         std::cout << "Cursor E/W: " << cursorRangeXNm << " N/S:" << cursorRangeYNm << std::endl;
     }
 
-    scan(offsetPosition, terrain, ownShip, buoys, otherShips, weather, rain, tideHeight, deltaTime, absoluteTime); // scan into scanArray[row (angle)][column (step)], and with filtering and amplification into scanArrayAmplified[][]
-    updateARPA(offsetPosition, ownShip, absoluteTime); //From data in arpaContacts, updated in scan()
-    render(radarImage, radarImageOverlaid, ownShip.getHeading(), ownShip.getSpeed()); //From scanArrayAmplified[row (angle)][column (step)], render to radarImage
+    //Take a copy of everything the scan needs, so it can be run on the scan thread while the simulation carries on
+    RadarScanInput input;
+    input.position = ownShip.getPosition();
+    input.offsetPosition = offsetPosition;
+    input.heading = ownShip.getHeading();
+    input.speed = ownShip.getSpeed();
+    input.weather = weather;
+    input.rain = rain;
+    input.tideHeight = tideHeight;
+    input.absoluteTime = absoluteTime;
+    input.terrain = &terrain;
+    //Load radar data for other contacts
+    //For other ships
+    for (std::vector<RadarData>::size_type contactID=1; contactID<=otherShips.getNumber(); contactID++) {
+        input.radarData.push_back(otherShips.getRadarData(contactID,input.position));
+    }
+    //For buoys
+    for (std::vector<RadarData>::size_type contactID=1; contactID<=buoys.getNumber(); contactID++) {
+        input.radarData.push_back(buoys.getRadarData(contactID,input.position));
+    }
+
+    if (scanThreadRunning) {
+        //Pass the new data to the scan thread, and collect what it has scanned since last time. If it is still busy, don't wait, but try again next time
+        unsubmittedScanTime += deltaTime;
+        std::unique_lock<std::mutex> lock(scanMutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            scanInput = input;
+            scanInputValid = true;
+            pendingScanTime += unsubmittedScanTime;
+            unsubmittedScanTime = 0;
+            publishScan();
+            lock.unlock();
+            scanCondition.notify_one();
+        }
+    } else {
+        scan(input, deltaTime); // scan into scanArray[spoke*rangeResolution + step], and with filtering and amplification into scanArrayAmplified
+        updateARPA(input); //From data in arpaContacts, updated in scan()
+        publishScan();
+    }
+    render(radarImage, radarImageOverlaid, input.heading, input.speed); //From scanArrayDisplayed[spoke*rangeResolution + step], render to radarImage
+}
+
+irr::u32 RadarCalculation::stepScan(const RadarScanInput& input, irr::f32 deltaTime)
+{
+    irr::u32 spokeBefore = currentSpoke;
+    scan(input, deltaTime);
+    return (currentSpoke + numberOfSpokes - spokeBefore) % numberOfSpokes;
+}
+
+void RadarCalculation::stepARPA(const RadarScanInput& input)
+{
+    updateARPA(input);
+    publishScan();
+}
+
+void RadarCalculation::stepRender(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::f32 ownShipHeading, irr::f32 ownShipSpeed)
+{
+    render(radarImage, radarImageOverlaid, ownShipHeading, ownShipSpeed);
+}
+
+irr::u32 RadarCalculation::getRangeResolution() const
+{
+    return rangeResolution;
+}
+
+irr::u32 RadarCalculation::getDisplayPixels() const
+{
+    irr::u32 displayPixels = 0;
+    for (irr::u32 row = 0; row < pixelRowStart.size(); row++) {
+        displayPixels += pixelRowEnd.at(row) - pixelRowStart.at(row);
+    }
+    return displayPixels;
+}
+
+void RadarCalculation::startScanThread()
+{
+    if (!scanThreadRunning) {
+        scanThreadStopRequested = false;
+        scanThread = std::thread(&RadarCalculation::scanThreadLoop, this);
+        scanThreadRunning = true;
+    }
+}
+
+void RadarCalculation::stopScanThread()
+{
+    if (scanThreadRunning) {
+        {
+            std::lock_guard<std::mutex> lock(scanMutex);
+            scanThreadStopRequested = true;
+        }
+        scanCondition.notify_one();
+        scanThread.join();
+        scanThreadRunning = false;
+    }
+}
+
+void RadarCalculation::pauseScanThread()
+{
+    if (scanThreadRunning) {
+        scanMutex.lock(); //Waits for any scan in progress to finish
+        scanInputValid = false; //Input refers to the scene before the change, so wait for the next update()
+    }
+}
+
+void RadarCalculation::resumeScanThread()
+{
+    if (scanThreadRunning) {
+        scanMutex.unlock();
+    }
+}
+
+void RadarCalculation::scanThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(scanMutex);
+    while (!scanThreadStopRequested) {
+        if (scanInputValid && pendingScanTime > 0) {
+            scan(scanInput, pendingScanTime);
+            updateARPA(scanInput);
+            pendingScanTime = 0;
+        } else {
+            scanCondition.wait(lock); //Releases scanMutex while waiting for update() to pass in more data
+        }
+    }
 }
 
+void RadarCalculation::publishScan()
+{
+    //Copy the spokes scanned since last time
+    for (irr::u32 i = 0; i<numberOfSpokes; i++) {
+        if (spokeUpdated[i]) {
+            std::copy(scanArrayAmplified.begin() + i*rangeResolution, scanArrayAmplified.begin() + (i+1)*rangeResolution, scanArrayDisplayed.begin() + i*rangeResolution);
+            spokeUpdated[i] = false;
+        }
+    }
+
+    //And the current ARPA estimates
+    arpaEstimates.resize(arpaContacts.size());
+    for (unsigned int i = 0; i<arpaContacts.size(); i++) {
+        arpaEstimates[i] = arpaContacts[i].estimate;
+    }
+    arpaEstimatesLargestId = largestARPADisplayId;
+}
 
-void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const Terrain& terrain, const OwnShip& ownShip, const Buoys& buoys, const OtherShips& otherShips, irr::f32 weather, irr::f32 rain, irr::f32 tideHeight, irr::f32 deltaTime, uint64_t absoluteTime)
+void RadarCalculation::scan(const RadarScanInput& input, irr::f32 deltaTime)
 {
 
     const irr::u32 SECONDS_BETWEEN_SCANS = 20;
 
-    irr::core::vector3df position = ownShip.getPosition();
+    irr::core::vector3df position = input.position;
     //Get absolute position relative to SW corner of world model
-    irr::core::vector3d<int64_t> absolutePosition = offsetPosition;
+    irr::core::vector3d<int64_t> absolutePosition = input.offsetPosition;
     absolutePosition.X += position.X;
     absolutePosition.Y += position.Y;
     absolutePosition.Z += position.Z;
 
-    //Some tuning constants
-    irr::f32 radarFactorLand=2.0;
-    irr::f32 radarFactorVessel=0.0001;
+    //Own ship position for checking the terrain profiles, in double precision so it is unaffected by moving the origin
+    irr::f64 profileX = (irr::f64)input.offsetPosition.X + position.X;
+    irr::f64 profileZ = (irr::f64)input.offsetPosition.Z + position.Z;
 
-    //Convert range to cell size
-    irr::f32 cellLength = M_IN_NM*radarRangeNm.at(radarRangeIndex)/rangeResolution; ; //Assume that radarRangeIndex is in bounds
+    irr::f32 weather = input.weather;
+    irr::f32 rain = input.rain;
+    uint64_t absoluteTime = input.absoluteTime;
 
-    //Load radar data for other contacts
-    std::vector<RadarData> radarData;
-    //For other ships
-    for (std::vector<RadarData>::size_type contactID=1; contactID<=otherShips.getNumber(); contactID++) {
-        radarData.push_back(otherShips.getRadarData(contactID,position));
+    //Make sure the per range cell tables match the current range and gain/clutter settings
+    if (rangeTablesStale) {
+        updateRangeTables();
     }
-    //For buoys
-    for (std::vector<RadarData>::size_type contactID=1; contactID<=buoys.getNumber(); contactID++) {
-        radarData.push_back(buoys.getRadarData(contactID,position));
+    irr::f32 cellLength = rangeCellLength;
+
+    //Tiles loaded or unloaded since the terrain profiles were sampled change the heights along them, so sample them all again
+    irr::u32 terrainGeneration = input.terrain->getTileGeneration();
+    if (terrainGeneration != terrainProfileGeneration) {
+        std::fill(terrainProfileValid.begin(),terrainProfileValid.end(),false);
+        terrainProfileGeneration = terrainGeneration;
     }
 
+    //Terrain profiles can be re-used if own ship has moved less than this
+    const irr::f32 TERRAIN_PROFILE_TOLERANCE = 0.25; //Fraction of a range cell
+    irr::f64 maxProfileMoveSquared = std::pow(TERRAIN_PROFILE_TOLERANCE*cellLength,2);
+
+    //Radar data for other contacts
+    const std::vector<RadarData>& radarData = input.radarData;
+
     const irr::f32 RADAR_RPM = 25; //Todo: Make a ship parameter
     const irr::f32 RPMtoDEGPERSECOND = 6;
-    irr::u32 scansPerLoop = RADAR_RPM*RPMtoDEGPERSECOND*deltaTime/(irr::f32)scanAngleStep + (irr::f32)rand()/RAND_MAX ; //Add random value (0-1, mean 0.5), so with rounding, we get the correct radar speed, even though we can only do an integer number of scans
+    irr::u32 scansPerLoop = RADAR_RPM*RPMtoDEGPERSECOND*deltaTime/spokeAngle + noiseRandom.uniform() ; //Add random value (0-1, mean 0.5), so with rounding, we get the correct radar speed, even though we can only do an integer number of scans
+
+    irr::u32 maxScansPerLoop = std::max<irr::u32>(10,numberOfSpokes/36); //At least 10 degrees, so fine spoke counts still keep up with the antenna
+    if (scansPerLoop > maxScansPerLoop) {scansPerLoop=maxScansPerLoop;} //Limit to reasonable bounds
+
+    //Bin contacts by the sectors swept in this call and by range cell, so each cell only checks contacts that could overlap it
+    buildContactIndex(radarData, scansPerLoop, cellLength);
 
-    if (scansPerLoop > 10) {scansPerLoop=10;} //Limit to reasonable bounds
     for(irr::u32 i = 0; i<scansPerLoop;i++) { //Start of repeatable scan section
         irr::f32 scanSlope = -0.5; //Slope at start of scan (in metres/metre) - Make slightly negative so vessel contacts close in get detected
+
+        //This spoke's rows in the scan buffers
+        irr::f32* spokeScan = &scanArray[currentSpoke*rangeResolution];
+        irr::f32* spokeAmplified = &scanArrayAmplified[currentSpoke*rangeResolution];
+
+        //Angular extents, the same for all cells in the spoke
+        irr::f32 scanAngle = currentSpoke*spokeAngle;
+        irr::f32 minCellAngle = Angles::normaliseAngle(scanAngle - spokeAngle/2.0);
+        irr::f32 maxCellAngle = Angles::normaliseAngle(scanAngle + spokeAngle/2.0);
+
+        //Terrain heights along the spoke, only looked up again if own ship has moved too far since last time
+        irr::f32* spokeTerrain = &terrainProfile[currentSpoke*rangeResolution];
+        irr::f64 profileMoveX = profileX - terrainProfileX[currentSpoke];
+        irr::f64 profileMoveZ = profileZ - terrainProfileZ[currentSpoke];
+        if (!terrainProfileValid[currentSpoke] || profileMoveX*profileMoveX + profileMoveZ*profileMoveZ > maxProfileMoveSquared) {
+            for (irr::u32 currentStep = 1; currentStep<rangeResolution; currentStep++) {
+                terrainSampleX[currentStep] = position.X + cellRange[currentStep]*sinScanAngle[currentSpoke];
+                terrainSampleZ[currentStep] = position.Z + cellRange[currentStep]*cosScanAngle[currentSpoke];
+            }
+            input.terrain->getHeights(&terrainSampleX[1],&terrainSampleZ[1],&spokeTerrain[1],rangeResolution-1);
+            terrainProfileX[currentSpoke] = profileX;
+            terrainProfileZ[currentSpoke] = profileZ;
+            terrainProfileValid[currentSpoke] = true;
+        }
+
+        //Noise and clutter for the whole spoke
+        generateSpokeNoise(scanAngle,0,weather,rain); //FIXME: Needs wind direction
+
         for (irr::u32 currentStep = 1; currentStep<rangeResolution; currentStep++) { //Note that currentStep starts as 1, not 0. This is used in anti-rain clutter filter, which checks element at currentStep-1
-            //scan into array, accessed as  scanArray[row (angle)][column (step)]
+            //scan into array, accessed as  spokeScan[step]
 
             //Clear old value
-            scanArray[currentScanAngle][currentStep] = 0.0;
+            spokeScan[currentStep] = 0.0;
 
-            //Get location of area being scanned
-            irr::f32 localRange = cellLength*currentStep;
-            irr::f32 relX = localRange*sin(currentScanAngle*irr::core::DEGTORAD); //Distance from ship
-            irr::f32 relZ = localRange*cos(currentScanAngle*irr::core::DEGTORAD);
-            irr::f32 localX = position.X + relX;
-            irr::f32 localZ = position.Z + relZ;
+            //Range of area being scanned
+            irr::f32 localRange = cellRange[currentStep];
 
             //get extents
-            irr::f32 minCellAngle = Angles::normaliseAngle(currentScanAngle - scanAngleStep/2.0);
-            irr::f32 maxCellAngle = Angles::normaliseAngle(currentScanAngle + scanAngleStep/2.0);
             irr::f32 minCellRange = localRange - cellLength/2.0;
             irr::f32 maxCellRange = localRange + cellLength/2.0;
 
             //get adjustment of height for earth's curvature
-            irr::f32 dropWithCurvature = std::pow(localRange,2)/(2*EARTH_RAD_M*EARTH_RAD_CORRECTION);
+            irr::f32 dropWithCurvature = cellCurvatureDrop[currentStep];
 
-            //Calculate noise
-            irr::f32 localNoise = radarNoise(radarNoiseLevel,radarSeaClutter,radarRainClutter,weather,localRange,currentScanAngle,0,scanSlope,rain); //FIXME: Needs wind direction
+            //Noise for this cell. If radar is scanning upwards, must be above sea surface, so don't add sea clutter
+            irr::f32 localNoise = spokeNoise[currentStep];
+            if (scanSlope <= 0) {
+                localNoise += spokeSeaClutter[currentStep];
+            }
 
-            //Scan other contacts here
-            for(unsigned int thisContact = 0; thisContact<radarData.size(); thisContact++) {
+            //Scan other contacts here (only those the broadphase index found could overlap this cell, in their original order)
+            const std::vector<irr::u32>& cellContacts = contactCellIndex.at(i*rangeResolution + currentStep);
+            for(unsigned int k = 0; k<cellContacts.size(); k++) {
+                unsigned int thisContact = cellContacts[k];
                 irr::f32 contactHeightAboveLine = (radarData.at(thisContact).height - radarScannerHeight - dropWithCurvature) - scanSlope*localRange;
                 if (contactHeightAboveLine > 0) {
                     //Contact would be visible if in this cell. Check if it is
@@ -525,19 +796,18 @@ void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const T
                             //Also check if the target centre is in the cell, or the extended target spans the cell (ie RangeAtCellMin less than minCellRange and rangeAtCellMax greater than maxCellRange and vice versa)
                             if ((((radarData.at(thisContact).range >= minCellRange && radarData.at(thisContact).range <= maxCellRange) && (Angles::isAngleBetween(radarData.at(thisContact).angle,minCellAngle,maxCellAngle))) || (rangeAtCellMin >= minCellRange && rangeAtCellMin <= maxCellRange) || (rangeAtCellMax >= minCellRange && rangeAtCellMax <= maxCellRange) || (rangeAtCellMin < minCellRange && rangeAtCellMax > maxCellRange) || (rangeAtCellMax < minCellRange && rangeAtCellMin > maxCellRange))){
 
-                                irr::f32 radarEchoStrength = radarFactorVessel * std::pow(M_IN_NM/localRange,4) * radarData.at(thisContact).rcs;
-                                scanArray[currentScanAngle][currentStep] += radarEchoStrength;
+                                irr::f32 radarEchoStrength = cellVesselEcho[currentStep] * radarData.at(thisContact).rcs;
+                                spokeScan[currentStep] += radarEchoStrength;
 
                                 //Start ARPA section
                                 if (arpaOn && radarEchoStrength*2 > localNoise) {
                                     //Contact is detectable in noise
 
-                                    //Iterate through arpaContacts array, checking if this contact is in the list (by checking the if the 'contact' pointer is to the same underlying ship/buoy)
+                                    //Look up this contact in arpaContacts (by the 'contact' pointer to the underlying ship/buoy)
                                     int existingArpaContact=-1;
-                                    for (unsigned int j = 0; j<arpaContacts.size(); j++) {
-                                        if (arpaContacts.at(j).contact == radarData.at(thisContact).contact) {
-                                            existingArpaContact = j;
-                                        }
+                                    std::unordered_map<void*, irr::u32>::const_iterator indexEntry = arpaContactIndex.find(radarData.at(thisContact).contact);
+                                    if (indexEntry != arpaContactIndex.end()) {
+                                        existingArpaContact = indexEntry->second;
                                     }
                                     //If it doesn't exist, add it, and make existingArpaContact point to it
                                     if (existingArpaContact<0) {
@@ -558,20 +828,34 @@ void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const T
                                         newContact.estimate.bearing = 0;
                                         newContact.estimate.range = 0;
                                         newContact.estimate.speed = 0;
+                                        newContact.estimate.relVectorX = 0;
+                                        newContact.estimate.relVectorZ = 0;
+                                        newContact.estimate.relHeading = 0;
+                                        newContact.estimate.cpa = 0;
+                                        newContact.estimate.tcpa = 0;
+
+                                        //No scans in the tracking filter yet
+                                        newContact.filter.x = 0;
+                                        newContact.filter.z = 0;
+                                        newContact.filter.vx = 0;
+                                        newContact.filter.vz = 0;
+                                        newContact.filter.timeStamp = 0;
+                                        newContact.filter.updates = 0;
 
                                         arpaContacts.push_back(newContact);
                                         existingArpaContact = arpaContacts.size()-1;
+                                        arpaContactIndex[newContact.contact] = existingArpaContact;
                                         //std::cout << "Adding contact " << existingArpaContact << std::endl;
                                     }
                                     //Add this scan (if not already scanned in the last X seconds
                                     size_t scansSize = arpaContacts.at(existingArpaContact).scans.size();
-                                    if (scansSize==0 || absoluteTime > SECONDS_BETWEEN_SCANS + arpaContacts.at(existingArpaContact).scans.at(scansSize-1).timeStamp) {
+                                    if (scansSize==0 || absoluteTime > SECONDS_BETWEEN_SCANS + arpaContacts.at(existingArpaContact).scans.back().timeStamp) {
                                         ARPAScan newScan;
                                         newScan.timeStamp = absoluteTime;
 
                                         //Add noise/uncertainty
-                                        irr::f32 angleUncertainty = scanAngleStep/2.0 * (2.0*(irr::f32)rand()/RAND_MAX - 1);
-                                        irr::f32 rangeUncertainty = rangeSensitivity * (2.0*(irr::f32)rand()/RAND_MAX - 1)/M_IN_NM;
+                                        irr::f32 angleUncertainty = spokeAngle/2.0 * (2.0*noiseRandom.uniform() - 1);
+                                        irr::f32 rangeUncertainty = rangeSensitivity * (2.0*noiseRandom.uniform() - 1)/M_IN_NM;
 
                                         newScan.bearingDeg = angleUncertainty + radarData.at(thisContact).angle;
                                         newScan.rangeNm = rangeUncertainty + radarData.at(thisContact).range / M_IN_NM;
@@ -582,16 +866,16 @@ void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const T
 
                                         //Keep track of estimated total movement
                                         if (scansSize > 0 && arpaOn) {
-                                            arpaContacts.at(existingArpaContact).totalXMovementEst += arpaContacts.at(existingArpaContact).scans.at(scansSize-1).x - newScan.x;
-                                            arpaContacts.at(existingArpaContact).totalZMovementEst += arpaContacts.at(existingArpaContact).scans.at(scansSize-1).z - newScan.z;
+                                            arpaContacts.at(existingArpaContact).totalXMovementEst += arpaContacts.at(existingArpaContact).scans.back().x - newScan.x;
+                                            arpaContacts.at(existingArpaContact).totalZMovementEst += arpaContacts.at(existingArpaContact).scans.back().z - newScan.z;
                                         } else {
                                             arpaContacts.at(existingArpaContact).totalXMovementEst = 0;
                                             arpaContacts.at(existingArpaContact).totalZMovementEst = 0;
                                         }
 
-                                        arpaContacts.at(existingArpaContact).scans.push_back(newScan);
+                                        arpaContacts.at(existingArpaContact).scans.push_back(newScan); //Only the most recent scans are kept
+                                        updateARPAFilter(arpaContacts.at(existingArpaContact).filter, newScan);
                                         //std::cout << "ARPA update on " << existingArpaContact << std::endl;
-                                        //Todo: should we limit the size of this, so it doesn't continue accumulating?
 
                                     }
 
@@ -645,7 +929,7 @@ void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const T
             }
 
             //Add land scan
-            irr::f32 terrainHeightAboveSea = terrain.getHeight(localX,localZ) - tideHeight;
+            irr::f32 terrainHeightAboveSea = spokeTerrain[currentStep] - input.tideHeight;
             irr::f32 radarHeight = terrainHeightAboveSea - dropWithCurvature - radarScannerHeight;
             irr::f32 localSlope = radarHeight/localRange;
             irr::f32 heightAboveLine = radarHeight - scanSlope*localRange; //Find height above previous maximum scan slope
@@ -653,54 +937,195 @@ void RadarCalculation::scan(irr::core::vector3d<int64_t> offsetPosition, const T
             if (heightAboveLine>0 && terrainHeightAboveSea>0) {
                 irr::f32 radarLocalGradient = heightAboveLine/cellLength;
                 scanSlope = localSlope; //Highest so far on scan
-                scanArray[currentScanAngle][currentStep] += radarFactorLand*std::atan(radarLocalGradient)*(2/PI)/std::pow(localRange/M_IN_NM,3); //make a reflection off a plane wall at 1nm have a magnitude of 1*radarFactorLand
+                spokeScan[currentStep] += cellLandEcho[currentStep]*std::atan(radarLocalGradient);
             }
 
             //Add radar noise
-            scanArray[currentScanAngle][currentStep] += localNoise;
+            spokeScan[currentStep] += localNoise;
 
             //Do amplification: scanArrayAmplified between 0 and 1 will set displayed intensity, values above 1 will be limited at max intensity
 
-            //Calculate from parameters
-            //localRange is range in metres
-            irr::f32 rainFilter = pow(radarRainClutterReduction/100.0,0.1);
-            irr::f32 maxSTCdistance = 8*M_IN_NM*radarSeaClutterReduction/100.0; //This sets the distance at which the swept gain control becomes 1, and is 8Nm at full reduction
-            irr::f32 radarSTCGain;
-            if(maxSTCdistance>0) {
-                radarSTCGain = pow(localRange/maxSTCdistance,3);
-                if (radarSTCGain > 1) {radarSTCGain=1;} //Gain should never be increased (above 1.0)
-            } else {
-                radarSTCGain = 1;
-            }
-
             //calculate high pass filter
-            irr::f32 intensityGradient = scanArray[currentScanAngle][currentStep] - scanArray[currentScanAngle][currentStep-1];
+            irr::f32 intensityGradient = spokeScan[currentStep] - spokeScan[currentStep-1];
             if (intensityGradient<0) {intensityGradient=0;}
 
-            irr::f32 filteredSignal = intensityGradient*rainFilter + scanArray[currentScanAngle][currentStep]*(1-rainFilter);
-            irr::f32 radarLocalGain = 500000*(8*pow(radarGain/100.0,4)) * radarSTCGain ;
+            irr::f32 filteredSignal = intensityGradient*rainFilter + spokeScan[currentStep]*(1-rainFilter);
 
             //take log (natural) of signal
-            scanArrayAmplified[currentScanAngle][currentStep] = log(filteredSignal*radarLocalGain);
+            spokeAmplified[currentStep] = log(filteredSignal*cellAmplification[currentStep]);
 
         } //End of for loop scanning out
 
-        //Increment scan angle for next time
-        currentScanAngle += scanAngleStep;
-        if (currentScanAngle>=360) {
-            currentScanAngle=0;
+        spokeUpdated[currentSpoke] = true;
+
+        //Move on to the next spoke for next time
+        currentSpoke++;
+        if (currentSpoke>=numberOfSpokes) {
+            currentSpoke=0;
         }
     } //End of repeatable scan section
 
 }
 
-void RadarCalculation::updateARPA(irr::core::vector3d<int64_t> offsetPosition, const OwnShip& ownShip, uint64_t absoluteTime)
+void RadarCalculation::updateRangeTables()
+//Precalculate everything in the scan that only depends on the range cell, so it isn't repeated for every cell on every sweep.
+//Called from scan() when rangeTablesStale has been set by a change of range, gain or clutter controls.
 {
+    //Some tuning constants
+    irr::f32 radarFactorLand=2.0;
+    irr::f32 radarFactorVessel=0.0001;
+
+    //Convert range to cell size
+    irr::f32 previousCellLength = rangeCellLength;
+    rangeCellLength = M_IN_NM*radarRangeNm.at(radarRangeIndex)/rangeResolution; //Assume that radarRangeIndex is in bounds
+
+    //If the range has changed, cells are now at different ranges, so the terrain profiles need sampling again
+    if (rangeCellLength != previousCellLength) {
+        std::fill(terrainProfileValid.begin(),terrainProfileValid.end(),false);
+    }
+
+    //Anti rain clutter filter, applied to all cells
+    rainFilter = pow(radarRainClutterReduction/100.0,0.1);
+
+    //Swept gain and overall gain
+    irr::f32 maxSTCdistance = 8*M_IN_NM*radarSeaClutterReduction/100.0; //This sets the distance at which the swept gain control becomes 1, and is 8Nm at full reduction
+    irr::f32 radarGainFactor = 500000*(8*pow(radarGain/100.0,4));
+
+    cellRange.resize(rangeResolution);
+    cellCurvatureDrop.resize(rangeResolution);
+    cellVesselEcho.resize(rangeResolution);
+    cellLandEcho.resize(rangeResolution);
+    cellAmplification.resize(rangeResolution);
+    cellSeaClutter.resize(rangeResolution);
+    cellRainClutter.resize(rangeResolution);
+
+    for (irr::u32 currentStep = 0; currentStep<rangeResolution; currentStep++) {
+        //localRange is range in metres
+        irr::f32 localRange = rangeCellLength*currentStep;
+        cellRange[currentStep] = localRange;
+
+        //get adjustment of height for earth's curvature
+        cellCurvatureDrop[currentStep] = std::pow(localRange,2)/(2*EARTH_RAD_M*EARTH_RAD_CORRECTION);
+
+        if (currentStep > 0) {
+            cellVesselEcho[currentStep] = radarFactorVessel * std::pow(M_IN_NM/localRange,4);
+            cellLandEcho[currentStep] = radarFactorLand*(2/PI)/std::pow(localRange/M_IN_NM,3); //make a reflection off a plane wall at 1nm have a magnitude of 1*radarFactorLand
+            cellSeaClutter[currentStep] = radarSeaClutter * std::pow(M_IN_NM/localRange,3);
+            cellRainClutter[currentStep] = radarRainClutter * std::pow(M_IN_NM/localRange,2);
+        } else {
+            //Cell 0 is never scanned, avoid division by zero
+            cellVesselEcho[currentStep] = 0;
+            cellLandEcho[currentStep] = 0;
+            cellSeaClutter[currentStep] = 0;
+            cellRainClutter[currentStep] = 0;
+        }
+
+        irr::f32 radarSTCGain;
+        if(maxSTCdistance>0) {
+            radarSTCGain = pow(localRange/maxSTCdistance,3);
+            if (radarSTCGain > 1) {radarSTCGain=1;} //Gain should never be increased (above 1.0)
+        } else {
+            radarSTCGain = 1;
+        }
+        cellAmplification[currentStep] = radarGainFactor * radarSTCGain;
+    }
+
+    rangeTablesStale = false;
+}
+
+void RadarCalculation::buildContactIndex(const std::vector<RadarData>& radarData, irr::u32 scansPerLoop, irr::f32 cellLength)
+//Broadphase for scan(). For each sector to be swept in this call, and each range cell, list the contacts that could pass the
+//detailed overlap tests. This is conservative (a superset of the contacts that can be detected in the cell), and keeps the
+//contacts in their original order, so the scan result is exactly the same as checking every contact in every cell.
+{
+    irr::u32 cellsNeeded = scansPerLoop*rangeResolution;
+    if (contactCellIndex.size() < cellsNeeded) {
+        contactCellIndex.resize(cellsNeeded);
+    }
+    for (irr::u32 i = 0; i<cellsNeeded; i++) {
+        contactCellIndex[i].clear(); //Keeps the allocated capacity for the next call
+    }
+
+    if (radarData.empty() || scansPerLoop == 0 || cellLength <= 0) {
+        return;
+    }
+
+    //Find the range cells each contact could overlap. Cell n covers (n-0.5)*cellLength to (n+0.5)*cellLength, and we allow
+    //one extra cell each side for rounding.
+    std::vector<irr::u32> firstStep(radarData.size(),1);
+    std::vector<irr::u32> lastStep(radarData.size(),0); //lastStep < firstStep means not in any cell
+    for (unsigned int thisContact = 0; thisContact<radarData.size(); thisContact++) {
+        const RadarData& contact = radarData.at(thisContact);
+        irr::f32 nearRange = std::min(contact.range,contact.minRange);
+        irr::f32 farRange = std::max(contact.range,contact.maxRange);
+
+        if (Angles::localisnan(contact.range) || Angles::localisnan(contact.minRange) || Angles::localisnan(contact.maxRange) || Angles::localisinf(nearRange) || Angles::localisinf(farRange)) {
+            //Can't bin this, so check it in every cell
+            firstStep.at(thisContact) = 1;
+            lastStep.at(thisContact) = rangeResolution-1;
+            continue;
+        }
+
+        irr::f32 nearStep = std::floor(nearRange/cellLength + 0.5) - 1;
+        irr::f32 farStep = std::floor(farRange/cellLength + 0.5) + 1;
+        if (nearStep < 1) {nearStep = 1;}
+        if (farStep > rangeResolution-1) {farStep = rangeResolution-1;}
+        if (farStep >= nearStep) {
+            firstStep.at(thisContact) = nearStep;
+            lastStep.at(thisContact) = farStep;
+        }
+    }
+
+    //Fill the bins for each spoke that will be swept, stepping in the same way as scan() does
+    irr::u32 sweepSpoke = currentSpoke;
+    for (irr::u32 i = 0; i<scansPerLoop; i++) {
+        for (unsigned int thisContact = 0; thisContact<radarData.size(); thisContact++) {
+            if (lastStep.at(thisContact) >= firstStep.at(thisContact) && contactMayOverlapSector(radarData.at(thisContact),sweepSpoke*spokeAngle,spokeAngle/2.0)) {
+                for (irr::u32 currentStep = firstStep.at(thisContact); currentStep<=lastStep.at(thisContact); currentStep++) {
+                    contactCellIndex[i*rangeResolution + currentStep].push_back(thisContact);
+                }
+            }
+        }
+
+        sweepSpoke++;
+        if (sweepSpoke>=numberOfSpokes) {
+            sweepSpoke=0;
+        }
+    }
+}
+
+bool RadarCalculation::contactMayOverlapSector(const RadarData& contact, irr::f32 sectorCentre, irr::f32 sectorHalfWidth) const
+//Conservative angular check for the broadphase: false only if the contact can't pass any of the angle tests in scan()
+{
+    if (Angles::localisnan(contact.angle) || Angles::localisnan(contact.minAngle) || Angles::localisnan(contact.maxAngle) ||
+        Angles::localisinf(contact.angle) || Angles::localisinf(contact.minAngle) || Angles::localisinf(contact.maxAngle)) {
+        return true;
+    }
+
+    irr::f32 margin = sectorHalfWidth + 0.5; //Extra half degree to allow for rounding in the detailed tests
+
+    //Centre of the contact within (or close to) the sector
+    irr::f32 centreOffset = Angles::normaliseAngle(contact.angle - sectorCentre);
+    if (centreOffset <= margin || centreOffset >= 360 - margin) {
+        return true;
+    }
+
+    //Sector within (or close to) the arc from minAngle clockwise to maxAngle. This covers either end being in the sector,
+    //and the contact spanning the sector.
+    irr::f32 arcLength = Angles::normaliseAngle(contact.maxAngle - contact.minAngle);
+    irr::f32 sectorOffset = Angles::normaliseAngle(sectorCentre - contact.minAngle);
+    return (sectorOffset <= arcLength + margin || sectorOffset >= 360 - margin);
+}
+
+void RadarCalculation::updateARPA(const RadarScanInput& input)
+{
+
+    uint64_t absoluteTime = input.absoluteTime;
 
     //Own ship absolute position
-    irr::core::vector3df position = ownShip.getPosition();
+    irr::core::vector3df position = input.position;
     //Get absolute position relative to SW corner of world model
-    irr::core::vector3d<int64_t> absolutePosition = offsetPosition;
+    irr::core::vector3d<int64_t> absolutePosition = input.offsetPosition;
     absolutePosition.X += position.X;
     absolutePosition.Y += position.Y;
     absolutePosition.Z += position.Z;
@@ -742,50 +1167,36 @@ void RadarCalculation::updateARPA(irr::core::vector3d<int64_t> offsetPosition, c
                     arpaContacts.at(i).estimate.lost=true;
                     //std::cout << "Contact " << i << " lost" << std::endl;
                 } else if (!arpaContacts.at(i).estimate.stationary) {
-                    /* Update contact tracking: Initially based on latest scan, and 6 scans back if available, or earliest otherwise
-                    TODO: Improve the logic of this, probably getting longest time possible before the behaviour was significantly
-                    different */
+                    //Update contact tracking, from the position and velocity in the contact's tracking filter, updated in scan()
 
                     //If ID is 0 (unassigned), set id and increment
                     if (arpaContacts.at(i).estimate.displayID==0) {
                         arpaContacts.at(i).estimate.displayID = ++largestARPADisplayId;
                     }
 
-                    irr::s32 stepsBack = 6;
+                    const ARPAFilterState& filter = arpaContacts.at(i).filter;
 
-                    irr::s32 currentScanIndex = arpaContacts.at(i).scans.size() - 1;
-                    irr::s32 referenceScanIndex = currentScanIndex - stepsBack;
-                    if (referenceScanIndex < 0) {
-                        referenceScanIndex = 0;
-                    }
-
-                    ARPAScan currentScanData = arpaContacts.at(i).scans.at(currentScanIndex);
-                    ARPAScan referenceScanData = arpaContacts.at(i).scans.at(referenceScanIndex);
-
-                    //Find difference in time, position x, position z
-                    irr::f32 deltaTime = currentScanData.timeStamp - referenceScanData.timeStamp;
-                    if (deltaTime>0) {
-                        irr::f32 deltaX = currentScanData.x - referenceScanData.x;
-                        irr::f32 deltaZ = currentScanData.z - referenceScanData.z;
+                    //Need at least two scans in the filter to have a velocity
+                    if (filter.updates > 1) {
 
                         //Absolute vector
-                        arpaContacts.at(i).estimate.absVectorX = deltaX/deltaTime; //m/s
-                        arpaContacts.at(i).estimate.absVectorZ = deltaZ/deltaTime; //m/s
-                        arpaContacts.at(i).estimate.absHeading = std::atan2(deltaX,deltaZ)/RAD_IN_DEG;
+                        arpaContacts.at(i).estimate.absVectorX = filter.vx; //m/s
+                        arpaContacts.at(i).estimate.absVectorZ = filter.vz; //m/s
+                        arpaContacts.at(i).estimate.absHeading = std::atan2(filter.vx,filter.vz)/RAD_IN_DEG;
                         if (arpaContacts.at(i).estimate.absHeading < 0 ) {
                             arpaContacts.at(i).estimate.absHeading += 360;
                         }
                         //Relative vector:
-                        arpaContacts.at(i).estimate.relVectorX = arpaContacts.at(i).estimate.absVectorX - ownShip.getSpeed() * sin((ownShip.getHeading())*irr::core::DEGTORAD);
-                        arpaContacts.at(i).estimate.relVectorZ = arpaContacts.at(i).estimate.absVectorZ - ownShip.getSpeed() * cos((ownShip.getHeading())*irr::core::DEGTORAD); //ownShipSpeed in m/s
+                        arpaContacts.at(i).estimate.relVectorX = arpaContacts.at(i).estimate.absVectorX - input.speed * sin((input.heading)*irr::core::DEGTORAD);
+                        arpaContacts.at(i).estimate.relVectorZ = arpaContacts.at(i).estimate.absVectorZ - input.speed * cos((input.heading)*irr::core::DEGTORAD); //ownShipSpeed in m/s
                         arpaContacts.at(i).estimate.relHeading = std::atan2(arpaContacts.at(i).estimate.relVectorX,arpaContacts.at(i).estimate.relVectorZ)/RAD_IN_DEG;
                         if (arpaContacts.at(i).estimate.relHeading < 0 ) {
                             arpaContacts.at(i).estimate.relHeading += 360;
                         }
 
                         //Estimated current position:
-                        irr::f32 relX = currentScanData.x - absolutePosition.X + arpaContacts.at(i).estimate.absVectorX * (absoluteTime - currentScanData.timeStamp);
-                        irr::f32 relZ = currentScanData.z - absolutePosition.Z + arpaContacts.at(i).estimate.absVectorZ * (absoluteTime - currentScanData.timeStamp);
+                        irr::f32 relX = filter.x - absolutePosition.X + arpaContacts.at(i).estimate.absVectorX * (absoluteTime - filter.timeStamp);
+                        irr::f32 relZ = filter.z - absolutePosition.Z + arpaContacts.at(i).estimate.absVectorZ * (absoluteTime - filter.timeStamp);
                         arpaContacts.at(i).estimate.bearing = std::atan2(relX,relZ)/RAD_IN_DEG;
                         if (arpaContacts.at(i).estimate.bearing < 0 ) {
                             arpaContacts.at(i).estimate.bearing += 360;
@@ -805,68 +1216,133 @@ void RadarCalculation::updateARPA(irr::core::vector3d<int64_t> offsetPosition, c
                         //std::cout << "Contact " << arpaContacts.at(i).estimate.displayID << " CPA: " <<  arpaContacts.at(i).estimate.cpa << " nm in " << arpaContacts.at(i).estimate.tcpa << " minutes" << std::endl;
 
 
-                    } //If time between scans > 0
+                    } //If filter has a velocity
                 } //Contact not lost
             } //If at least 2 scans
         } //If ARPA is on
     } //For loop through arpa contacts
 }
 
+void RadarCalculation::updateARPAFilter(ARPAFilterState& filter, const ARPAScan& newScan)
+//Alpha-beta filter for ARPA tracking. The gains start as for a least squares straight line fit through all scans so far,
+//so the track settles quickly, then are held at the values for ARPA_FILTER_SCANS scans, so older scans are gradually forgotten.
+{
+    const irr::u32 ARPA_FILTER_SCANS = 10;
+
+    if (filter.updates == 0) {
+        //First scan: Position only
+        filter.x = newScan.x;
+        filter.z = newScan.z;
+        filter.vx = 0;
+        filter.vz = 0;
+        filter.timeStamp = newScan.timeStamp;
+        filter.updates = 1;
+        return;
+    }
+
+    irr::f32 deltaTime = newScan.timeStamp - filter.timeStamp;
+    if (deltaTime <= 0) {
+        return;
+    }
+
+    //Predict where the contact should be now, and correct towards the measurement
+    irr::f32 predictedX = filter.x + filter.vx*deltaTime;
+    irr::f32 predictedZ = filter.z + filter.vz*deltaTime;
+    irr::f32 residualX = newScan.x - predictedX;
+    irr::f32 residualZ = newScan.z - predictedZ;
+
+    irr::u32 n = filter.updates + 1; //Number of scans including this one
+    if (n > ARPA_FILTER_SCANS) {
+        n = ARPA_FILTER_SCANS;
+    }
+    irr::f32 alpha = 2.0*(2.0*n - 1)/(n*(n + 1.0));
+    irr::f32 beta = 6.0/(n*(n + 1.0));
+
+    filter.x = predictedX + alpha*residualX;
+    filter.z = predictedZ + alpha*residualZ;
+    filter.vx += beta*residualX/deltaTime;
+    filter.vz += beta*residualZ/deltaTime;
+    filter.timeStamp = newScan.timeStamp;
+    filter.updates++;
+}
+
 void RadarCalculation::render(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::f32 ownShipHeading, irr::f32 ownShipSpeed)
 {
     //*************************
     //generate image from array
     //*************************
 
-    //Render background radar picture into radarImage, then copy to radarImageOverlaid and do any 2d drawing on top (so we don't have to redraw all pixels each time
+    //Render background radar picture into radarImage, then copy the changed parts to radarImageOverlaid and do any 2d drawing on top (so we don't have to redraw all pixels each time
     irr::u32 bitmapWidth = radarRadiusPx*2; //Set width to use - to map GUI radar display diameter in screen pixels
+    dirtyRegions.clear();
     if (radarImage->getDimension().Width < bitmapWidth) //Check the image we're rendering into is big enough
         {return;}
 
     //draw from array to image
     irr::f32 centrePixel = (bitmapWidth-1.0)/2.0; //The centre of the bitmap. Normally this will be a fractional number (##.5)
 
-    //precalculate cell max/min range for speed outside nested loop
-	std::vector<irr::f32> cellMinRange;
-	std::vector<irr::f32> cellMaxRange;
-	//irr::f32 cellMinRange [rangeResolution];
-    //irr::f32 cellMaxRange [rangeResolution];
-	cellMinRange.push_back(0);
-	cellMaxRange.push_back(0);
-    for (irr::u32 currentStep = 1; currentStep<rangeResolution; currentStep++) { //Note that we start with the element at 1, so we've already pushed in a dummy entry at 0
-        cellMinRange.push_back((currentStep-0.5)*(bitmapWidth*0.5/(float)rangeResolution));//Range in pixels from centre
-        cellMaxRange.push_back((currentStep+0.5)*(bitmapWidth*0.5/(float)rangeResolution));
+    //Make sure the pixel lookup tables match the current display size and angular resolution
+    if (renderTablesRadiusPx != radarRadiusPx || renderTablesSpokes != numberOfSpokes) {
+        updateRenderTables();
     }
 
-    for (int scanAngle = 0; scanAngle <360; scanAngle+=scanAngleStep) {
-
-        irr::f32 cellMinAngle = scanAngle - scanAngleStep/2.0;
-        irr::f32 cellMaxAngle = scanAngle + scanAngleStep/2.0;
+    //Make sure the dirty tile grid covers the images
+    irr::u32 tilesX = (radarImageOverlaid->getDimension().Width + (1 << DIRTY_TILE_SHIFT) - 1) >> DIRTY_TILE_SHIFT;
+    irr::u32 tilesY = (radarImageOverlaid->getDimension().Height + (1 << DIRTY_TILE_SHIFT) - 1) >> DIRTY_TILE_SHIFT;
+    if (tilesX != dirtyTilesX || tilesY != dirtyTilesY) {
+        dirtyTilesX = tilesX;
+        dirtyTilesY = tilesY;
+        dirtyTiles.assign(dirtyTilesX*dirtyTilesY,0);
+        overlayTiles.assign(dirtyTilesX*dirtyTilesY,0);
+        recomposeAll = true;
+    }
+    if (recomposeAll) {
+        std::fill(dirtyTiles.begin(),dirtyTiles.end(),1);
+        recomposeAll = false;
+    }
 
+    //Update colours for any cells that have changed, and note which spokes need re-drawing
+    std::vector<irr::u32> changedSpokes;
+    for (irr::u32 spoke = 0; spoke<numberOfSpokes; spoke++) {
+        const irr::f32* spokeDisplayed = &scanArrayDisplayed[spoke*rangeResolution];
+        irr::f32* spokePrevious = &scanArrayAmplifiedPrevious[spoke*rangeResolution];
+        bool spokeChanged = false;
         for (irr::u32 currentStep = 1; currentStep<rangeResolution; currentStep++) {
+            if(spokeDisplayed[currentStep]!=spokePrevious[currentStep]) {
 
-            //If the sector has changed, draw it. If we're stabilising the picture, need to re-draw all in case the ship's head has changed
-            if(scanArrayAmplified[scanAngle][currentStep]!=scanArrayAmplifiedPrevious[scanAngle][currentStep] || stabilised)
-            {
-
-                irr::f32 pixelColour=scanArrayAmplified[scanAngle][currentStep];
+                irr::f32 pixelColour=spokeDisplayed[currentStep];
 
                 if (pixelColour>1.0) {pixelColour = 1.0;}
                 if (pixelColour<0)   {pixelColour =   0;}
 
                 //Interpolate colour between foreground and background
-                irr::video::SColor thisColour = radarForegroundColour.getInterpolated(radarBackgroundColour, pixelColour);
+                cellColours[spoke*rangeResolution + currentStep] = radarForegroundColour.getInterpolated(radarBackgroundColour, pixelColour).color;
 
-                drawSector(radarImage,centrePixel,centrePixel,cellMinRange[currentStep],cellMaxRange[currentStep],cellMinAngle,cellMaxAngle,thisColour.getAlpha(),thisColour.getRed(),thisColour.getGreen(),thisColour.getBlue(), ownShipHeading);
-
-                //Store what we've just plotted, so we don't need to re-plot if unchanged
-                scanArrayAmplifiedPrevious[scanAngle][currentStep]=scanArrayAmplified[scanAngle][currentStep];
+                //Store what we've just updated, so we don't need to re-plot if unchanged
+                spokePrevious[currentStep]=spokeDisplayed[currentStep];
+                spokeChanged = true;
             }
         }
+        if (spokeChanged) {
+            changedSpokes.push_back(spoke);
+        }
+    }
+
+    //Rotate for head up/course up, as an offset to the bearing of each pixel (in 1/65536ths of a turn)
+    irr::u16 bearingOffset = 0;
+    if (headUp) {
+        bearingOffset = (irr::u16)(irr::s32)std::floor(Angles::normaliseAngle(ownShipHeading)*65536.0/360.0 + 0.5);
     }
 
-    //Copy image into overlaid
-    radarImage->copyTo(radarImageOverlaid);
+    //If we're stabilising the picture, need to re-draw all in case the ship's head has changed. Marks the tiles drawn in dirtyTiles.
+    drawScan(radarImage, bearingOffset, changedSpokes, stabilised);
+
+    //Copy the changed parts of the image into overlaid, and also where overlays were drawn last time, so they are removed
+    for (irr::u32 t = 0; t<dirtyTiles.size(); t++) {
+        dirtyTiles[t] |= overlayTiles[t];
+    }
+    copyDirtyTiles(radarImage, radarImageOverlaid);
+    std::fill(overlayTiles.begin(),overlayTiles.end(),0);
 
     //Adjust for head up/course up
     irr::f32 radarOffsetAngle = 0;
@@ -916,12 +1392,7 @@ void RadarCalculation::render(irr::video::IImage * radarImage, irr::video::IImag
                     irr::s32 xTextPos = x_a + 15*xDirection;
                     irr::s32 yTextPos = z_a + 15*yDirection;
 
-                    irr::video::IImage* idNumberImage = NumberToImage::getImage(i+1,device);
-                    if (idNumberImage) {
-                        irr::core::rect<irr::s32> sourceRect = irr::core::rect<irr::s32>(0,0,idNumberImage->getDimension().Width,idNumberImage->getDimension().Height);
-                        idNumberImage->copyToWithAlpha(radarImageOverlaid,irr::core::position2d<irr::s32>(xTextPos,yTextPos),sourceRect,irr::video::SColor(255,255,255,255));
-                        idNumberImage->drop();
-                    }
+                    markOverlayRect(numberGlyphs.draw(i+1,radarImageOverlaid,irr::core::position2d<irr::s32>(xTextPos,yTextPos)));
 				}
 
 
@@ -930,9 +1401,9 @@ void RadarCalculation::render(irr::video::IImage * radarImage, irr::video::IImag
         }
     }
 
-    //Draw ARPA stuff here from arpaContacts, into radarImage
-    for(unsigned int i = 0; i < arpaContacts.size(); i++) {
-        ARPAEstimatedState thisEstimate = arpaContacts.at(i).estimate;
+    //Draw ARPA stuff here from arpaEstimates, into radarImage
+    for(unsigned int i = 0; i < arpaEstimates.size(); i++) {
+        ARPAEstimatedState thisEstimate = arpaEstimates.at(i);
 
 
         if (!thisEstimate.stationary && thisEstimate.range <= getRangeNm()*M_IN_NM && thisEstimate.range != 0) {
@@ -949,13 +1420,7 @@ void RadarCalculation::render(irr::video::IImage * radarImage, irr::video::IImag
             drawCircle(radarImageOverlaid,deltaX,deltaY,radarRadiusPx/40,255,255,255,255); //Draw circle around contact
 
             //Draw contact's display ID :
-            irr::video::IImage* idNumberImage = NumberToImage::getImage(thisEstimate.displayID,device);
-
-            if (idNumberImage) {
-                irr::core::rect<irr::s32> sourceRect = irr::core::rect<irr::s32>(0,0,idNumberImage->getDimension().Width,idNumberImage->getDimension().Height);
-                idNumberImage->copyToWithAlpha(radarImageOverlaid,irr::core::position2d<irr::s32>(deltaX-10,deltaY-10),sourceRect,irr::video::SColor(255,255,255,255));
-                idNumberImage->drop();
-            }
+            markOverlayRect(numberGlyphs.draw(thisEstimate.displayID,radarImageOverlaid,irr::core::position2d<irr::s32>(deltaX-10,deltaY-10)));
 
             //draw a vector
             irr::f32 adjustedVectorX;
@@ -991,66 +1456,226 @@ void RadarCalculation::render(irr::video::IImage * radarImage, irr::video::IImag
         }
     }
 
+    //Everything changed in radarImageOverlaid this time, as rectangles (runs of tiles along each row of tiles) to upload
+    for (irr::u32 ty = 0; ty<dirtyTilesY; ty++) {
+        irr::u32 tx = 0;
+        while (tx < dirtyTilesX) {
+            if (!dirtyTiles[ty*dirtyTilesX + tx] && !overlayTiles[ty*dirtyTilesX + tx]) {
+                tx++;
+                continue;
+            }
+            irr::u32 runStart = tx;
+            while (tx < dirtyTilesX && (dirtyTiles[ty*dirtyTilesX + tx] || overlayTiles[ty*dirtyTilesX + tx])) {
+                tx++;
+            }
+            irr::s32 x0 = runStart << DIRTY_TILE_SHIFT;
+            irr::s32 y0 = ty << DIRTY_TILE_SHIFT;
+            irr::s32 x1 = std::min<irr::s32>(tx << DIRTY_TILE_SHIFT, radarImageOverlaid->getDimension().Width);
+            irr::s32 y1 = std::min<irr::s32>((ty+1) << DIRTY_TILE_SHIFT, radarImageOverlaid->getDimension().Height);
+            dirtyRegions.push_back(irr::core::rect<irr::s32>(x0,y0,x1,y1));
+        }
+    }
+    std::fill(dirtyTiles.begin(),dirtyTiles.end(),0);
+
 
 }
 
-void RadarCalculation::drawSector(irr::video::IImage * radarImage,irr::f32 centreX, irr::f32 centreY, irr::f32 innerRadius, irr::f32 outerRadius, irr::f32 startAngle, irr::f32 endAngle, irr::u32 alpha, irr::u32 red, irr::u32 green, irr::u32 blue, irr::f32 ownShipHeading)
-//draw a bounded sector
+void RadarCalculation::updateRenderTables()
+//Build the lookup tables used by drawScan(): the bearing and range cell for each pixel of the display, the pixels sorted by
+//bearing so a sector can be found quickly, and which spoke covers each bearing.
 {
-    if (headUp) {
-        startAngle -= ownShipHeading;
-        endAngle -= ownShipHeading;
-    }
-
-    //find the corner points (Fixme: Not quite right when the extreme point is on the outer curve)
-    irr::f32 sinStartAngle = std::sin(irr::core::DEGTORAD*startAngle);
-    irr::f32 cosStartAngle = std::cos(irr::core::DEGTORAD*startAngle);
-    irr::f32 sinEndAngle = std::sin(irr::core::DEGTORAD*endAngle);
-    irr::f32 cosEndAngle = std::cos(irr::core::DEGTORAD*endAngle);
-
-    irr::f32 point1X = centreX + sinStartAngle*innerRadius;
-    irr::f32 point1Y = centreY - cosStartAngle*innerRadius;
-    irr::f32 point2X = centreX + sinStartAngle*outerRadius;
-    irr::f32 point2Y = centreY - cosStartAngle*outerRadius;
-    irr::f32 point3X = centreX + sinEndAngle*outerRadius;
-    irr::f32 point3Y = centreY - cosEndAngle*outerRadius;
-    irr::f32 point4X = centreX + sinEndAngle*innerRadius;
-    irr::f32 point4Y = centreY - cosEndAngle*innerRadius;
-
-    //find the 'bounding box'
-    irr::f32 minX = std::min(std::min(point1X,point2X),std::min(point3X,point4X));
-    irr::f32 maxX = std::max(std::max(point1X,point2X),std::max(point3X,point4X));
-    irr::f32 minY = std::min(std::min(point1Y,point2Y),std::min(point3Y,point4Y));
-    irr::f32 maxY = std::max(std::max(point1Y,point2Y),std::max(point3Y,point4Y));
-
-    irr::f32 innerRadiusSqr = std::pow(innerRadius,2);
-    irr::f32 outerRadiusSqr = std::pow(outerRadius,2);
-
-    //draw the points
-    for (int i = minX;i<=maxX;i++) {
-        irr::f32 localX = i - centreX; //position referred to centre
-        irr::f32 localXSq = localX*localX;
-
-        for (int j = minY;j<=maxY;j++) {
-
-            irr::f32 localY = j - centreY; //position referred to centre
-
-            irr::f32 localRadiusSqr = localXSq + localY*localY; //check radius of points
-            //irr::f32 localAngle = irr::core::RADTODEG*std::atan2(localX,-1*localY); //check angle of point
-            //irr::f32 localAngle = irr::core::RADTODEG*fast_atan2f(localX,-1*localY);
-
-            //if the point is within the limits, plot it
-            if (localRadiusSqr >= innerRadiusSqr && localRadiusSqr <= outerRadiusSqr) {
-                //if (Angles::isAngleBetween(localAngle,startAngle,endAngle)) {
-                if (Angles::isAngleBetween(irr::core::vector2df(localX,-1*localY),irr::core::vector2df(sinStartAngle,cosStartAngle),irr::core::vector2df(sinEndAngle,cosEndAngle))) {
-                    //Plot i,j
-                    if (i >= 0 && j >= 0) {radarImage->setPixel(i,j,irr::video::SColor(alpha,red,green,blue));}
+    //Bins for pixels sorted by bearing, a power of 2 (top bits of the 16 bit bearing): at least 1024, and at least one per spoke
+    irr::u32 binBits = 10;
+    while ((1u << binBits) < numberOfSpokes && binBits < 16) {
+        binBits++;
+    }
+    const irr::u32 BEARING_BINS = 1 << binBits;
+    bearingBinShift = 16 - binBits;
+
+    //Resolution of bearingToColourIndex, also a power of 2: at least 4096, and at least 4 per spoke
+    irr::u32 lookupBits = 12;
+    while ((1u << lookupBits) < 4*numberOfSpokes && lookupBits < 16) {
+        lookupBits++;
+    }
+    const irr::u32 SECTOR_LOOKUP_SIZE = 1 << lookupBits;
+    bearingLookupShift = 16 - lookupBits;
+
+    irr::u32 bitmapWidth = radarRadiusPx*2;
+    irr::f32 centrePixel = (bitmapWidth-1.0)/2.0;
+    irr::f32 cellWidthPx = bitmapWidth*0.5/(irr::f32)rangeResolution;
+
+    pixelBearing.assign(bitmapWidth*bitmapWidth,0);
+    pixelCell.assign(bitmapWidth*bitmapWidth,0);
+    pixelRowStart.assign(bitmapWidth,0);
+    pixelRowEnd.assign(bitmapWidth,0);
+    bearingBinStart.assign(BEARING_BINS+1,0);
+
+    for (irr::u32 j = 0; j<bitmapWidth; j++) {
+        irr::f32 localY = j - centrePixel; //position referred to centre
+        bool foundStart = false;
+        for (irr::u32 i = 0; i<bitmapWidth; i++) {
+            irr::f32 localX = i - centrePixel;
+
+            //Same limits as cells are drawn to: cell n covers radius (n-0.5)*cellWidthPx to (n+0.5)*cellWidthPx. Cell 0 is never scanned, so keeps the background colour.
+            irr::f32 cellFromCentre = std::sqrt(localX*localX + localY*localY)/cellWidthPx;
+            irr::u32 cell = cellFromCentre + 0.5;
+            if (cell >= rangeResolution) {
+                continue; //Outside the display
+            }
+
+            if (!foundStart) {
+                pixelRowStart[j] = i;
+                foundStart = true;
+            }
+            pixelRowEnd[j] = i+1;
+
+            irr::f32 bearing = Angles::normaliseAngle(irr::core::RADTODEG*std::atan2(localX,-1*localY));
+            irr::u32 pixelIndex = j*bitmapWidth + i;
+            pixelBearing[pixelIndex] = (irr::u16)((irr::u32)(bearing*65536.0/360.0 + 0.5) & 0xFFFF);
+            pixelCell[pixelIndex] = cell;
+            bearingBinStart[(pixelBearing[pixelIndex] >> bearingBinShift) + 1]++;
+        }
+    }
+
+    //Sort the pixel indices by bearing bin (counting sort)
+    for (irr::u32 bin = 0; bin<BEARING_BINS; bin++) {
+        bearingBinStart[bin+1] += bearingBinStart[bin];
+    }
+    bearingBinPixels.resize(bearingBinStart[BEARING_BINS]);
+    std::vector<irr::u32> binFill(bearingBinStart.begin(),bearingBinStart.end()-1);
+    for (irr::u32 j = 0; j<bitmapWidth; j++) {
+        for (irr::u32 i = pixelRowStart[j]; i<pixelRowEnd[j]; i++) {
+            irr::u32 pixelIndex = j*bitmapWidth + i;
+            bearingBinPixels[binFill[pixelBearing[pixelIndex] >> bearingBinShift]++] = pixelIndex;
+        }
+    }
+
+    //For each bearing, find the nearest spoke, as spoke n covers n*spokeAngle +-spokeAngle/2
+    bearingToColourIndex.resize(SECTOR_LOOKUP_SIZE);
+    for (irr::u32 i = 0; i<SECTOR_LOOKUP_SIZE; i++) {
+        irr::f32 bearing = (i + 0.5)*360.0/SECTOR_LOOKUP_SIZE;
+        irr::u32 spoke = (irr::u32)(bearing/spokeAngle + 0.5);
+        if (spoke >= numberOfSpokes) {
+            spoke = 0;
+        }
+        bearingToColourIndex[i] = spoke*rangeResolution;
+    }
+
+    renderTablesRadiusPx = radarRadiusPx;
+    renderTablesSpokes = numberOfSpokes;
+}
+
+void RadarCalculation::drawScan(irr::video::IImage * radarImage, irr::u16 bearingOffset, const std::vector<irr::u32>& changedSpokes, bool fullRedraw)
+//Draw the cell colours into radarImage using the lookup tables. For a full redraw, this is a single pass over the display
+//area. Otherwise only the pixels near the changed spokes are drawn.
+{
+    irr::u32 bitmapWidth = radarRadiusPx*2;
+    bool directWrite = (radarImage->getColorFormat() == irr::video::ECF_A8R8G8B8); //Write straight into the image data if we can, otherwise use setPixel
+    irr::u8* imageData = (irr::u8*)radarImage->getData();
+    irr::u32 imagePitch = radarImage->getPitch();
+
+    if (fullRedraw) {
+        for (irr::u32 j = 0; j<bitmapWidth; j++) {
+            const irr::u16* rowBearings = &pixelBearing[j*bitmapWidth];
+            const irr::u16* rowCells = &pixelCell[j*bitmapWidth];
+            irr::u32 rowStart = pixelRowStart[j];
+            irr::u32 rowEnd = pixelRowEnd[j];
+            if (rowEnd > rowStart) {
+                irr::u8* rowTiles = &dirtyTiles[(j >> DIRTY_TILE_SHIFT)*dirtyTilesX];
+                std::fill(rowTiles + (rowStart >> DIRTY_TILE_SHIFT), rowTiles + ((rowEnd-1) >> DIRTY_TILE_SHIFT) + 1, 1);
+            }
+            if (directWrite) {
+                irr::u32* rowPixels = (irr::u32*)(imageData + j*imagePitch);
+                for (irr::u32 i = rowStart; i<rowEnd; i++) {
+                    rowPixels[i] = cellColours[bearingToColourIndex[(irr::u16)(rowBearings[i] + bearingOffset) >> bearingLookupShift] + rowCells[i]];
+                }
+            } else {
+                for (irr::u32 i = rowStart; i<rowEnd; i++) {
+                    radarImage->setPixel(i,j,irr::video::SColor(cellColours[bearingToColourIndex[(irr::u16)(rowBearings[i] + bearingOffset) >> bearingLookupShift] + rowCells[i]]));
+                }
+            }
+        }
+        return;
+    }
+
+    //Partial redraw: for each changed spoke, go through the bearing bins it covers on screen (with one bin margin each
+    //side), and draw those pixels with their current colour
+    const irr::u32 BEARING_BINS = bearingBinStart.size()-1;
+    irr::u32 binsPerSector = (irr::u32)(spokeAngle*BEARING_BINS/360.0) + 3;
+    for (unsigned int k = 0; k<changedSpokes.size(); k++) {
+        irr::u16 sectorStart = (irr::u16)((irr::s32)std::floor(Angles::normaliseAngle(changedSpokes[k]*spokeAngle - spokeAngle/2.0)*65536.0/360.0) - bearingOffset);
+        irr::u32 firstBin = (sectorStart >> bearingBinShift) + BEARING_BINS - 1;
+        for (irr::u32 n = 0; n<binsPerSector && n<BEARING_BINS; n++) {
+            irr::u32 bin = (firstBin + n) & (BEARING_BINS - 1);
+            for (irr::u32 p = bearingBinStart[bin]; p<bearingBinStart[bin+1]; p++) {
+                irr::u32 pixelIndex = bearingBinPixels[p];
+                irr::u32 colour = cellColours[bearingToColourIndex[(irr::u16)(pixelBearing[pixelIndex] + bearingOffset) >> bearingLookupShift] + pixelCell[pixelIndex]];
+                irr::u32 i = pixelIndex % bitmapWidth;
+                irr::u32 j = pixelIndex / bitmapWidth;
+                dirtyTiles[(j >> DIRTY_TILE_SHIFT)*dirtyTilesX + (i >> DIRTY_TILE_SHIFT)] = 1;
+                if (directWrite) {
+                    ((irr::u32*)(imageData + j*imagePitch))[i] = colour;
+                } else {
+                    radarImage->setPixel(i,j,irr::video::SColor(colour));
                 }
             }
         }
     }
 }
 
+void RadarCalculation::copyDirtyTiles(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid)
+//Copy the tiles marked in dirtyTiles from radarImage to radarImageOverlaid, a run of neighbouring tiles at a time
+{
+    irr::s32 imageWidth = radarImageOverlaid->getDimension().Width;
+    irr::s32 imageHeight = radarImageOverlaid->getDimension().Height;
+    for (irr::u32 ty = 0; ty<dirtyTilesY; ty++) {
+        irr::u32 tx = 0;
+        while (tx < dirtyTilesX) {
+            if (!dirtyTiles[ty*dirtyTilesX + tx]) {
+                tx++;
+                continue;
+            }
+            irr::u32 runStart = tx;
+            while (tx < dirtyTilesX && dirtyTiles[ty*dirtyTilesX + tx]) {
+                tx++;
+            }
+            irr::s32 x0 = runStart << DIRTY_TILE_SHIFT;
+            irr::s32 y0 = ty << DIRTY_TILE_SHIFT;
+            irr::s32 x1 = std::min<irr::s32>(tx << DIRTY_TILE_SHIFT, imageWidth);
+            irr::s32 y1 = std::min<irr::s32>((ty+1) << DIRTY_TILE_SHIFT, imageHeight);
+            radarImage->copyTo(radarImageOverlaid,irr::core::position2d<irr::s32>(x0,y0),irr::core::rect<irr::s32>(x0,y0,x1,y1));
+        }
+    }
+}
+
+void RadarCalculation::markOverlayPixel(irr::s32 x, irr::s32 y)
+{
+    if (x >= 0 && y >= 0) {
+        irr::u32 tx = (irr::u32)x >> DIRTY_TILE_SHIFT;
+        irr::u32 ty = (irr::u32)y >> DIRTY_TILE_SHIFT;
+        if (tx < dirtyTilesX && ty < dirtyTilesY) {
+            overlayTiles[ty*dirtyTilesX + tx] = 1;
+        }
+    }
+}
+
+void RadarCalculation::markOverlayRect(const irr::core::rect<irr::s32>& area)
+{
+    //Clip to the tile grid (area's LowerRightCorner is one past the last pixel)
+    irr::s32 x0 = std::max<irr::s32>(area.UpperLeftCorner.X, 0);
+    irr::s32 y0 = std::max<irr::s32>(area.UpperLeftCorner.Y, 0);
+    irr::s32 x1 = std::min<irr::s32>(area.LowerRightCorner.X, dirtyTilesX << DIRTY_TILE_SHIFT);
+    irr::s32 y1 = std::min<irr::s32>(area.LowerRightCorner.Y, dirtyTilesY << DIRTY_TILE_SHIFT);
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    for (irr::u32 ty = (irr::u32)y0 >> DIRTY_TILE_SHIFT; ty <= (irr::u32)(y1-1) >> DIRTY_TILE_SHIFT; ty++) {
+        for (irr::u32 tx = (irr::u32)x0 >> DIRTY_TILE_SHIFT; tx <= (irr::u32)(x1-1) >> DIRTY_TILE_SHIFT; tx++) {
+            overlayTiles[ty*dirtyTilesX + tx] = 1;
+        }
+    }
+}
+
 void RadarCalculation::drawLine(irr::video::IImage * radarImage, irr::f32 startX, irr::f32 startY, irr::f32 endX, irr::f32 endY, irr::u32 alpha, irr::u32 red, irr::u32 green, irr::u32 blue)//Try with irr::f32 as inputs so we can do interpolation based on the theoretical start and end
 {
 
@@ -1071,6 +1696,7 @@ void RadarCalculation::drawLine(irr::video::IImage * radarImage, irr::f32 startX
             if (pow(centreToX,2) + pow(centreToY,2) <= radiusSquared) {
                 if (thisX >= 0 && thisY >= 0) {
                     radarImage->setPixel(thisX,thisY,irr::video::SColor(alpha,red,green,blue));
+                    markOverlayPixel(thisX,thisY);
                 }
             }
         }
@@ -1081,7 +1707,10 @@ void RadarCalculation::drawLine(irr::video::IImage * radarImage, irr::f32 startX
         irr::s32 centreToX = thisX - radarRadiusPx;
         irr::s32 centreToY = thisY - radarRadiusPx;
         if (pow(centreToX,2) + pow(centreToY,2) <= radiusSquared) {
-            if (thisX >= 0 && thisY >= 0) {radarImage->setPixel(thisX,thisY,irr::video::SColor(alpha,red,green,blue));}
+            if (thisX >= 0 && thisY >= 0) {
+                radarImage->setPixel(thisX,thisY,irr::video::SColor(alpha,red,green,blue));
+                markOverlayPixel(thisX,thisY);
+            }
         }
     }
 }
@@ -1102,6 +1731,7 @@ void RadarCalculation::drawCircle(irr::video::IImage * radarImage, irr::f32 cent
             if (pow(centreToX,2) + pow(centreToY,2) <= radiusSquared) {
                 if (thisX >= 0 && thisY >= 0) {
                     radarImage->setPixel(thisX,thisY,irr::video::SColor(alpha,red,green,blue));
+                    markOverlayPixel(thisX,thisY);
                 }
             }
         }
@@ -1114,6 +1744,7 @@ void RadarCalculation::drawCircle(irr::video::IImage * radarImage, irr::f32 cent
         if (pow(centreToX,2) + pow(centreToY,2) <= radiusSquared) {
             if (thisX >= 0 && thisY >= 0) {
                 radarImage->setPixel(thisX,thisY,irr::video::SColor(alpha,red,green,blue));
+                markOverlayPixel(thisX,thisY);
             }
         }
     }
@@ -1146,49 +1777,43 @@ irr::f32 RadarCalculation::rangeAtAngle(irr::f32 checkAngle,irr::f32 centreX, ir
 
 }
 
-irr::f32 RadarCalculation::radarNoise(irr::f32 radarNoiseLevel, irr::f32 radarSeaClutter, irr::f32 radarRainClutter, irr::f32 weather, irr::f32 radarRange,irr::f32 radarBrgDeg, irr::f32 windDirectionDeg, irr::f32 radarInclinationAngle, irr::f32 rainIntensity)
-//radarRange in metres
+void RadarCalculation::generateSpokeNoise(irr::f32 radarBrgDeg, irr::f32 windDirectionDeg, irr::f32 weather, irr::f32 rainIntensity)
+//Fill spokeNoise and spokeSeaClutter for cells 1 to rangeResolution-1 of one spoke. Sea clutter is kept separate, as scan() only
+//adds it while the scan is looking down onto the sea surface. Random values are generated first, so the main loop has no
+//dependencies between cells.
 {
-	irr::f32 radarNoiseVal = 0;
-
-	if (radarRange != 0) {
-
-		irr::f32 randomValue = (irr::f32)rand()/RAND_MAX; //store this so we can manipulate the random distribution;
-		irr::f32 randomValueSea = (irr::f32)rand()/RAND_MAX; //different value for sea clutter;
-
-		//reshape the uniform random distribution into one with an infinite tail up to high values
-		irr::f32 randomValueWithTail=0;
-		if (randomValue > 0) {
-            //3rd power is to shape distribution so sufficient high energy returns are generated
-			randomValueWithTail = randomValue * pow( (1/randomValue) - 1, 3);
-		}
-
-		//same for sea clutter noise
-		irr::f32 randomValueWithTailSea=0;
-		if (randomValueSea > 0) {
-            if (radarInclinationAngle > 0) {
-                randomValueWithTailSea = 0; //if radar is scanning upwards, must be above sea surface, so don't add clutter
-            } else {
-                //3rd power is to shape distribution so sufficient high energy returns are generated
-                randomValueWithTailSea = randomValueSea * pow((1/randomValueSea) - 1, 3);
-            }
-		}
-
-		//less high power returns for rain clutter - roughly gaussian, so get an average of independent random numbers
-		irr::f32 randomValueWithTailRain = ((irr::f32)rand()/RAND_MAX + (irr::f32)rand()/RAND_MAX + (irr::f32)rand()/RAND_MAX + (irr::f32)rand()/RAND_MAX)/4.0;
-
-		//Apply directional correction to the clutter, so most is upwind, some is downwind. Mean value = 1
-		irr::f32 relativeWindAngle = (windDirectionDeg - radarBrgDeg)*RAD_IN_DEG;
-		irr::f32 windCorrectionFactor = 2.5*(0.5*(cos(2*relativeWindAngle)+1))*(0.5+sin(relativeWindAngle/2.0)*0.5);
-		randomValueWithTailSea = randomValueWithTailSea * windCorrectionFactor;
-
-		//noise is constant
-		radarNoiseVal = radarNoiseLevel * randomValueWithTail;
-		//clutter falls off with distance^3, and is normalised for weather#=6
-		radarNoiseVal += radarSeaClutter * randomValueWithTailSea * (weather/6.0) * pow((M_IN_NM/radarRange),3);
-		//rain clutter falls off with distance^2, and is normalised for rainIntensity#=10
-		radarNoiseVal += radarRainClutter * randomValueWithTailRain * (rainIntensity/10.0)*(rainIntensity/10.0) * pow((M_IN_NM/radarRange),2);
-	}
-
-	return radarNoiseVal;
+    const irr::u32 cells = rangeResolution - 1;
+    noiseRandom.fillUniform(&noiseUniforms[0], 6*cells);
+    const irr::f32* randomValue = &noiseUniforms[0];
+    const irr::f32* randomValueSea = &noiseUniforms[cells]; //different value for sea clutter
+    const irr::f32* randomValueRain = &noiseUniforms[2*cells]; //4 values per cell for rain clutter, in blocks of cells
+
+    //Apply directional correction to the clutter, so most is upwind, some is downwind. Mean value = 1
+    irr::f32 relativeWindAngle = (windDirectionDeg - radarBrgDeg)*RAD_IN_DEG;
+    irr::f32 windCorrectionFactor = 2.5*(0.5*(cos(2*relativeWindAngle)+1))*(0.5+sin(relativeWindAngle/2.0)*0.5);
+
+    //sea clutter is normalised for weather=6, rain clutter is normalised for rainIntensity=10
+    irr::f32 seaFactor = windCorrectionFactor * weather/6.0;
+    irr::f32 rainFactor = (rainIntensity/10.0)*(rainIntensity/10.0);
+
+    irr::f32* noise = &spokeNoise[1];
+    irr::f32* seaClutter = &spokeSeaClutter[1];
+    const irr::f32* seaRange = &cellSeaClutter[1];
+    const irr::f32* rainRange = &cellRainClutter[1];
+    for (irr::u32 i = 0; i<cells; i++) {
+        //reshape the uniform random distribution into one with an infinite tail up to high values
+        //3rd power is to shape distribution so sufficient high energy returns are generated
+        irr::f32 tail = 1/randomValue[i] - 1;
+        irr::f32 randomValueWithTail = randomValue[i] * tail*tail*tail;
+        irr::f32 tailSea = 1/randomValueSea[i] - 1;
+        irr::f32 randomValueWithTailSea = randomValueSea[i] * tailSea*tailSea*tailSea;
+
+        //less high power returns for rain clutter - roughly gaussian, so get an average of independent random numbers
+        irr::f32 randomValueWithTailRain = (randomValueRain[i] + randomValueRain[cells+i] + randomValueRain[2*cells+i] + randomValueRain[3*cells+i])/4.0;
+
+        //noise is constant, rain clutter falls off with distance^2
+        noise[i] = radarNoiseLevel * randomValueWithTail + rainRange[i] * rainFactor * randomValueWithTailRain;
+        //clutter falls off with distance^3
+        seaClutter[i] = seaRange[i] * seaFactor * randomValueWithTailSea;
+    }
 }
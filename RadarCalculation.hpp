@@ -19,9 +19,18 @@
 
 #include "irrlicht.h"
 
+#include "RadarData.hpp"
+#include "AlignedAllocator.hpp"
+#include "RadarRandom.hpp"
+#include "NumberToImage.hpp"
+
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <stdint.h> //for uint64_t
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <ctime> //To check time elapsed between changing EBL when button held down
 
@@ -29,7 +38,6 @@ class Terrain;
 class OwnShip;
 class Buoys;
 class OtherShips;
-struct RadarData;
 
 enum ARPA_CONTACT_TYPE {
     CONTACT_NORMAL,
@@ -46,6 +54,35 @@ struct ARPAScan {
     irr::f32 bearingDeg; //For reference only
 };
 
+class ARPAScanHistory {
+    //Ring buffer of the most recent scans of a contact, so memory use doesn't grow during a long exercise
+    public:
+        ARPAScanHistory() : newest(0), count(0) {}
+        void push_back(const ARPAScan& scan) {
+            newest = (count == 0) ? 0 : (newest + 1) % ARPA_SCAN_HISTORY;
+            scans[newest] = scan;
+            if (count < ARPA_SCAN_HISTORY) {count++;}
+        }
+        irr::u32 size() const {return count;}
+        const ARPAScan& back() const {return scans[newest];} //Most recent scan, only valid if size() > 0
+        const ARPAScan& stepsBack(irr::u32 steps) const {return scans[(newest + ARPA_SCAN_HISTORY - steps) % ARPA_SCAN_HISTORY];} //Only valid if steps < size()
+    private:
+        static const irr::u32 ARPA_SCAN_HISTORY = 16;
+        ARPAScan scans[ARPA_SCAN_HISTORY];
+        irr::u32 newest;
+        irr::u32 count;
+};
+
+struct ARPAFilterState {
+    //Alpha-beta tracking filter, updated with each new scan
+    irr::f32 x; //Filtered absolute position (m)
+    irr::f32 z;
+    irr::f32 vx; //Filtered velocity (m/s)
+    irr::f32 vz;
+    uint64_t timeStamp; //Time of the last update (s)
+    irr::u32 updates; //Number of scans used so far
+};
+
 struct ARPAEstimatedState {
     irr::u32 displayID; //User displayed ID
     bool stationary; // E.g. if detected as static and a small RCS or a buoy.
@@ -66,8 +103,23 @@ struct ARPAEstimatedState {
     //Time to CPA
 };
 
+struct RadarScanInput {
+    //Snapshot of everything scan() and updateARPA() need from the rest of the simulation, taken in update() on the main thread
+    std::vector<RadarData> radarData; //For other ships and buoys, relative to own ship position
+    irr::core::vector3df position; //Own ship position
+    irr::core::vector3d<int64_t> offsetPosition;
+    irr::f32 heading; //Own ship heading (deg)
+    irr::f32 speed; //Own ship speed (m/s)
+    irr::f32 weather;
+    irr::f32 rain;
+    irr::f32 tideHeight;
+    uint64_t absoluteTime;
+    const Terrain* terrain;
+};
+
 struct ARPAContact {
-    std::vector<ARPAScan> scans;
+    ARPAScanHistory scans;
+    ARPAFilterState filter;
     irr::f32 totalXMovementEst; //Estimates of total movement (sum of absolutes) in X and Z, to help detect stationary contacts
     irr::f32 totalZMovementEst;
     ARPA_CONTACT_TYPE contactType;
@@ -105,6 +157,7 @@ class RadarCalculation
         void setHeadUp();
         bool getHeadUp() const; //Head or course up
         void setArpaOn(bool on);
+        void setNoiseSeed(uint64_t seed); //Restart the noise, clutter and ARPA uncertainty random sequence, so the same inputs give the same radar picture
         void setRadarARPARel();
         void setRadarARPATrue();
         void setRadarARPAVectors(irr::f32 vectorMinutes);
@@ -114,21 +167,44 @@ class RadarCalculation
         irr::f32 getARPATCPA(irr::u32 contactID) const;
 		irr::f32 getARPASpeed(irr::u32 contactID) const;
 		irr::f32 getARPAHeading(irr::u32 contactID) const;
+        void startScanThread(); //Run scan() and updateARPA() on a background thread, update() then just passes in new data and collects the results
+        void stopScanThread();
+        void pauseScanThread(); //Block the background scan while the scene is changed (e.g. terrain moved), until resumeScanThread() is called
+        void resumeScanThread();
+        const std::vector<irr::core::rect<irr::s32> >& getDirtyRegions() const; //Parts of radarImageOverlaid changed by the last update(), for uploading to the screen texture
         void update(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::core::vector3d<int64_t> offsetPosition, const Terrain& terrain, const OwnShip& ownShip, const Buoys& buoys, const OtherShips& otherShips, irr::f32 weather, irr::f32 rain, irr::f32 tideHeight, irr::f32 deltaTime, uint64_t absoluteTime, irr::core::vector2di mouseRelPosition, bool isMouseDown);
 
+        //The parts of update(), to run and time separately (e.g. in radarBenchmark). Only for use while the scan thread is stopped.
+        void setNumberOfSpokes(irr::u32 spokes); //Resize the scan buffers and tables
+        void setRangeNm(irr::f32 rangeNm); //Use just this range, in place of those from the radar config file
+        irr::u32 stepScan(const RadarScanInput& input, irr::f32 deltaTime); //Returns the number of spokes scanned
+        void stepARPA(const RadarScanInput& input); //Also makes the scan ready for stepRender()
+        void stepRender(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::f32 ownShipHeading, irr::f32 ownShipSpeed);
+        irr::u32 getRangeResolution() const; //Range cells per spoke, including cell 0, which isn't scanned
+        irr::u32 getDisplayPixels() const; //Pixels inside the radar display, as of the last render
+
     private:
         irr::IrrlichtDevice* device;
-        std::vector<std::vector<irr::f32> > scanArray;
-        std::vector<std::vector<irr::f32> > scanArrayAmplified;
-        std::vector<std::vector<irr::f32> > scanArrayAmplifiedPrevious;
+        NumberToImage::GlyphAtlas numberGlyphs; //For PI and ARPA contact numbers
+        //Scan buffers, each one contiguous block of numberOfSpokes rows of rangeResolution cells, accessed as [spoke*rangeResolution + step]
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > scanArray;
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > scanArrayAmplified;
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > scanArrayAmplifiedPrevious;
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > scanArrayDisplayed; //Copy of scanArrayAmplified used for rendering, only updated for spokes marked in spokeUpdated
+        std::vector<bool> spokeUpdated; //Spokes scanned since last copied into scanArrayDisplayed
         std::vector<ARPAContact> arpaContacts;
+        std::unordered_map<void*, irr::u32> arpaContactIndex; //Index into arpaContacts for each contact (ship or buoy) being tracked
+        std::vector<ARPAEstimatedState> arpaEstimates; //Copy of the estimates in arpaContacts, used for rendering and the getARPA...() functions
+        irr::u32 arpaEstimatesLargestId; //Copy of largestARPADisplayId, from the same time as arpaEstimates
+        std::vector<std::vector<irr::u32> > contactCellIndex; //Broadphase: For each cell swept in this scan() call, [sweep*rangeResolution + step], the indices into radarData of contacts that may overlap it, in ascending order
         bool arpaOn;
         irr::u32 largestARPADisplayId;
         irr::f32 radarGain;
         irr::f32 radarRainClutterReduction;
         irr::f32 radarSeaClutterReduction;
-        irr::u32 currentScanAngle; //Note that this MUST be an integer, as the angle is used to look up values in radar scan arrays
-        irr::u32 scanAngleStep; //Should also be an integer, as the angle being incremented is an integer
+        irr::u32 numberOfSpokes; //Number of scan lines (azimuth steps) per revolution
+        irr::f32 spokeAngle; //Angle between spokes (deg), 360/numberOfSpokes
+        irr::u32 currentSpoke; //Next spoke to scan, 0 to numberOfSpokes-1. Spoke n is centred on n*spokeAngle
         const irr::u32 rangeResolution;
         irr::f32 rangeSensitivity; //Used for ARPA contacts - in metres
         irr::u32 radarRangeIndex;
@@ -157,12 +233,89 @@ class RadarCalculation
         irr::video::SColor radarForegroundColour;
 
         std::vector<irr::f32> radarRangeNm;
-        void scan(irr::core::vector3d<int64_t> offsetPosition, const Terrain& terrain, const OwnShip& ownShip, const Buoys& buoys, const OtherShips& otherShips, irr::f32 weather, irr::f32 rain, irr::f32 tideHeight, irr::f32 deltaTime, uint64_t absoluteTime);
-        void updateARPA(irr::core::vector3d<int64_t> offsetPosition, const OwnShip& ownShip, uint64_t absoluteTime);
-        irr::f32 radarNoise(irr::f32 radarNoiseLevel, irr::f32 radarSeaClutter, irr::f32 radarRainClutter, irr::f32 weather, irr::f32 radarRange,irr::f32 radarBrgDeg, irr::f32 windDirectionDeg, irr::f32 radarInclinationAngle, irr::f32 rainIntensity);
+
+        //Tables of values that only depend on range cell and the range/gain/clutter settings, used in scan(). Rebuilt in updateRangeTables() when rangeTablesStale is set
+        bool rangeTablesStale;
+        irr::f32 rangeCellLength; //Length of each range cell (m)
+        irr::f32 rainFilter; //Anti rain clutter high pass filter proportion
+        std::vector<irr::f32> cellRange; //Range to centre of each cell (m)
+        std::vector<irr::f32> cellCurvatureDrop; //Drop in height due to earth's curvature (m)
+        std::vector<irr::f32> cellVesselEcho; //Echo strength from a vessel, per unit of radar cross section
+        std::vector<irr::f32> cellLandEcho; //Echo strength from a land surface, per unit of atan(gradient)
+        std::vector<irr::f32> cellAmplification; //Overall gain, including the swept gain (STC)
+        std::vector<irr::f32> cellSeaClutter; //Sea clutter strength, falling off with range^3, before weather and wind corrections
+        std::vector<irr::f32> cellRainClutter; //Rain clutter strength, falling off with range^2, before the rain intensity correction
+        std::vector<irr::f32> sinScanAngle; //Sin and cos of the angle of each spoke
+        std::vector<irr::f32> cosScanAngle;
+        void updateRangeTables();
+
+        //Terrain heights (without tide) sampled along each spoke, [spoke*rangeResolution + step], and the absolute own ship position they
+        //were sampled from. A spoke's heights are re-used until own ship moves more than a fraction of a cell, or the range changes.
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > terrainProfile;
+        std::vector<irr::f64> terrainProfileX;
+        std::vector<irr::f64> terrainProfileZ;
+        std::vector<bool> terrainProfileValid;
+        irr::u32 terrainProfileGeneration; //Terrain::getTileGeneration() when the profiles were sampled, as tiles loaded since change the heights
+        std::vector<irr::f32> terrainSampleX; //Positions along the spoke being sampled
+        std::vector<irr::f32> terrainSampleZ;
+
+        //Lookup tables for drawing the radar picture, mapping each pixel to a bearing and range cell. Rebuilt in updateRenderTables() when the display radius or number of spokes changes
+        irr::u32 renderTablesRadiusPx;
+        irr::u32 renderTablesSpokes;
+        irr::u32 bearingBinShift; //Right shift from 16 bit bearing to bearing bin
+        irr::u32 bearingLookupShift; //Right shift from 16 bit bearing to index in bearingToColourIndex
+        std::vector<irr::u16> pixelBearing; //For each pixel in the bitmapWidth square, bearing from the centre in 1/65536ths of a turn, clockwise from up
+        std::vector<irr::u16> pixelCell; //For each pixel, the range cell it is in
+        std::vector<irr::u32> pixelRowStart; //For each row, the first and one past the last pixel within the radar display
+        std::vector<irr::u32> pixelRowEnd;
+        std::vector<irr::u32> bearingBinStart; //Pixels sorted into bins by bearing, bearingBinPixels[bearingBinStart[bin]] to bearingBinPixels[bearingBinStart[bin+1]-1]
+        std::vector<irr::u32> bearingBinPixels;
+        std::vector<irr::u32> bearingToColourIndex; //For each bearing (top bits), the start of the row in cellColours for the spoke covering it
+        std::vector<irr::u32> cellColours; //Current colour to draw for each [spoke * rangeResolution + range cell]
+        void updateRenderTables();
+        void drawScan(irr::video::IImage * radarImage, irr::u16 bearingOffset, const std::vector<irr::u32>& changedSpokes, bool fullRedraw);
+
+        //Dirty region tracking, in square tiles of 2^DIRTY_TILE_SHIFT pixels covering the radar images. radarImageOverlaid is only
+        //re-composed (copied from radarImage, and overlays drawn on top) for tiles changed by drawScan() or with overlays drawn last time.
+        static const irr::u32 DIRTY_TILE_SHIFT = 5;
+        irr::u32 dirtyTilesX; //Number of tiles across and down the images
+        irr::u32 dirtyTilesY;
+        bool recomposeAll; //Set when the whole of radarImage has changed (e.g. re-filled with the background colour)
+        std::vector<irr::u8> dirtyTiles; //Tiles of radarImageOverlaid changed in this render()
+        std::vector<irr::u8> overlayTiles; //Tiles with overlays (EBL, PI lines, ARPA symbols) drawn on them
+        std::vector<irr::core::rect<irr::s32> > dirtyRegions; //dirtyTiles from the last render(), as rectangles in image pixels
+        void markOverlayPixel(irr::s32 x, irr::s32 y);
+        void markOverlayRect(const irr::core::rect<irr::s32>& area);
+        void copyDirtyTiles(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid);
+
+        //Background scan thread. When running, scanArray, scanArrayAmplified, arpaContacts and the range tables belong to the
+        //thread while it holds scanMutex. Everything else shared with it (scanInput, pendingScanTime, controls) is only changed with scanMutex held.
+        bool scanThreadRunning;
+        bool scanThreadStopRequested;
+        std::thread scanThread;
+        std::mutex scanMutex;
+        std::condition_variable scanCondition;
+        RadarScanInput scanInput; //Latest input passed to the thread
+        bool scanInputValid;
+        irr::f32 pendingScanTime; //Time not yet scanned by the thread (s)
+        irr::f32 unsubmittedScanTime; //Time not yet passed to the thread, as it was busy (s)
+        void scanThreadLoop();
+        void publishScan(); //Copy results from scanArrayAmplified and arpaContacts for display. Call with scanMutex held if the thread is running.
+
+        void scan(const RadarScanInput& input, irr::f32 deltaTime);
+        void updateARPA(const RadarScanInput& input);
+        void updateARPAFilter(ARPAFilterState& filter, const ARPAScan& newScan);
+
+        //Noise and clutter, generated a spoke at a time. noiseRandom is only used from scan(), so belongs to whichever thread is scanning
+        RadarRandom noiseRandom;
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > noiseUniforms; //Random values for one spoke
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > spokeNoise; //Receiver noise and rain clutter for each cell of the spoke being scanned
+        std::vector<irr::f32, AlignedAllocator<irr::f32> > spokeSeaClutter; //Sea clutter for each cell of the spoke being scanned
+        void generateSpokeNoise(irr::f32 radarBrgDeg, irr::f32 windDirectionDeg, irr::f32 weather, irr::f32 rainIntensity);
         void render(irr::video::IImage * radarImage, irr::video::IImage * radarImageOverlaid, irr::f32 ownShipHeading, irr::f32 ownShipSpeed);
+        void buildContactIndex(const std::vector<RadarData>& radarData, irr::u32 scansPerLoop, irr::f32 cellLength);
+        bool contactMayOverlapSector(const RadarData& contact, irr::f32 sectorCentre, irr::f32 sectorHalfWidth) const;
         irr::f32 rangeAtAngle(irr::f32 checkAngle,irr::f32 centreX, irr::f32 centreZ, irr::f32 heading);
-        void drawSector(irr::video::IImage * radarImage,irr::f32 centreX, irr::f32 centreY, irr::f32 innerRadius, irr::f32 outerRadius, irr::f32 startAngle, irr::f32 endAngle, irr::u32 alpha, irr::u32 red, irr::u32 green, irr::u32 blue, irr::f32 ownShipHeading);
         void drawLine(irr::video::IImage * radarImage, irr::f32 startX, irr::f32 startY, irr::f32 endX, irr::f32 endY, irr::u32 alpha, irr::u32 red, irr::u32 green, irr::u32 blue);//Try with f32 as inputs so we can do interpolation based on the theoretical start and end
         void drawCircle(irr::video::IImage * radarImage, irr::f32 centreX, irr::f32 centreY, irr::f32 radius, irr::u32 alpha, irr::u32 red, irr::u32 green, irr::u32 blue);//Try with f32 as inputs so we can do interpolation based on the theoretical start and end
 
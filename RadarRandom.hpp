@@ -0,0 +1,78 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __RADARRANDOM_HPP_INCLUDED__
+#define __RADARRANDOM_HPP_INCLUDED__
+
+#include "irrlicht.h"
+#include <stdint.h>
+
+//Small, fast random number generator (xoshiro128+) for radar noise and clutter. Unlike rand(), each instance has its own
+//state, so it is safe to use from the radar scan thread, and the sequence only depends on the seed.
+class RadarRandom
+{
+    public:
+        RadarRandom(uint64_t seed = 1)
+        {
+            setSeed(seed);
+        }
+
+        void setSeed(uint64_t seed)
+        {
+            //Expand the seed into the state with splitmix64, which never gives an all zero state
+            for (int i = 0; i < 4; i += 2) {
+                seed += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                z = z ^ (z >> 31);
+                state[i] = (uint32_t)z;
+                state[i+1] = (uint32_t)(z >> 32);
+            }
+        }
+
+        uint32_t next()
+        {
+            const uint32_t result = state[0] + state[3];
+            const uint32_t t = state[1] << 9;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = (state[3] << 11) | (state[3] >> 21);
+            return result;
+        }
+
+        //Uniform in (0,1], from the top 24 bits (the low bits of xoshiro128+ are weaker)
+        irr::f32 uniform()
+        {
+            return ((next() >> 8) + 1) * (1.0f/16777216.0f);
+        }
+
+        //Fill values[0] to values[count-1] with uniform values in (0,1]
+        void fillUniform(irr::f32* values, irr::u32 count)
+        {
+            for (irr::u32 i = 0; i < count; i++) {
+                values[i] = uniform();
+            }
+        }
+
+    private:
+        uint32_t state[4];
+};
+
+#endif
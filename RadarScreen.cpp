@@ -16,12 +16,13 @@
 
 #include "RadarScreen.hpp"
 #include <iostream>
+#include <cstring> //For memcpy
 
 //using namespace irr;
 
 RadarScreen::RadarScreen()
 {
-
+    radarTexture = 0;
 }
 
 RadarScreen::~RadarScreen()
@@ -49,7 +50,7 @@ void RadarScreen::setRadarDisplayRadius(irr::u32 radiusPx)
     radarRadiusPx = radiusPx;
 }
 
-void RadarScreen::update(irr::video::IImage* radarImage)
+void RadarScreen::update(irr::video::IImage* radarImage, const std::vector<irr::core::rect<irr::s32> >& dirtyRegions)
 {
      //link camera rotation to shipNode
     // get transformation matrix of node
@@ -65,13 +66,32 @@ void RadarScreen::update(irr::video::IImage* radarImage)
     radarScreen->setPosition(parent->getPosition() + offsetTransformed);
 	radarScreen->setRotation(parent->getRotation()+irr::core::vector3df(-90+tilt,0,0));
 
-    //Get old texture if it exists
-	irr::video::ITexture* oldTexture = 0;
-    if (radarScreen->getMaterialCount()>0) {
-        oldTexture = radarScreen->getMaterial(0).getTexture(0);
+    //Make the texture the first time, or if the image has changed size. Otherwise copy in just the changed parts of the image
+    if (radarTexture == 0 || radarTexture->getSize() != radarImage->getDimension()) {
+        createTexture(radarImage);
+    } else if (!dirtyRegions.empty()) {
+        irr::u8* textureData = 0;
+        if (radarTexture->getColorFormat() == radarImage->getColorFormat()) {
+            textureData = (irr::u8*)radarTexture->lock();
+        }
+        if (textureData) {
+            const irr::u8* imageData = (const irr::u8*)radarImage->getData();
+            irr::u32 texturePitch = radarTexture->getPitch();
+            irr::u32 imagePitch = radarImage->getPitch();
+            irr::u32 bytesPerPixel = radarImage->getBytesPerPixel();
+            for (unsigned int i = 0; i<dirtyRegions.size(); i++) {
+                const irr::core::rect<irr::s32>& region = dirtyRegions.at(i);
+                irr::u32 rowBytes = region.getWidth() * bytesPerPixel;
+                for (irr::s32 y = region.UpperLeftCorner.Y; y<region.LowerRightCorner.Y; y++) {
+                    memcpy(textureData + y*texturePitch + region.UpperLeftCorner.X*bytesPerPixel, imageData + y*imagePitch + region.UpperLeftCorner.X*bytesPerPixel, rowBytes);
+                }
+            }
+            radarTexture->unlock();
+        } else {
+            //Can't write into the texture directly (e.g. it was converted to another format), so fall back to re-making it
+            createTexture(radarImage);
+        }
     }
-    //make texture from image and apply to the screen
-    radarScreen->setMaterialTexture(0,driver->addTexture("RadarImage",radarImage));
 
     //Scale the texture to get 1:1 image to screen pixel mapping
     irr::f32 radarTextureScaling=1;
@@ -80,11 +100,25 @@ void RadarScreen::update(irr::video::IImage* radarImage)
     }
     radarScreen->getMaterial(0).getTextureMatrix(0).setTextureScale(radarTextureScaling,radarTextureScaling); //Use this to scale to the correct size: Ratio between radarImage size and the screen pixel diameter.
 
+}
+
+void RadarScreen::createTexture(irr::video::IImage* radarImage)
+{
+    //Get old texture if it exists
+    irr::video::ITexture* oldTexture = radarTexture;
+
+    //make texture from image and apply to the screen. Ask Irrlicht to keep a copy of the image with the texture, so lock()
+    //doesn't have to read the texture back, and the unchanged parts stay valid between updates
+    bool allowMemoryCopy = driver->getTextureCreationFlag(irr::video::ETCF_ALLOW_MEMORY_COPY);
+    driver->setTextureCreationFlag(irr::video::ETCF_ALLOW_MEMORY_COPY, true);
+    radarTexture = driver->addTexture("RadarImage",radarImage);
+    driver->setTextureCreationFlag(irr::video::ETCF_ALLOW_MEMORY_COPY, allowMemoryCopy);
+    radarScreen->setMaterialTexture(0,radarTexture);
+
     //Remove old texture if it exists
     if (oldTexture!=0) {
             driver->removeTexture(oldTexture);
     }
-
 }
 
 irr::scene::ISceneNode* RadarScreen::getSceneNode() const
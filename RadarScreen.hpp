@@ -18,6 +18,7 @@
 #define __RADARSCREEN_HPP_INCLUDED__
 
 #include "irrlicht.h"
+#include <vector>
 
 class RadarScreen
 {
@@ -27,7 +28,7 @@ class RadarScreen
 
         void load(irr::scene::ISceneManager* smgr, irr::scene::ISceneNode* parent, irr::core::vector3df offset, irr::f32 size, irr::f32 tilt);
         void setRadarDisplayRadius(irr::u32 radiusPx);
-        void update(irr::video::IImage* radarImage);
+        void update(irr::video::IImage* radarImage, const std::vector<irr::core::rect<irr::s32> >& dirtyRegions); //dirtyRegions: Parts of radarImage changed since the last update
         irr::scene::ISceneNode* getSceneNode() const;
 
 
@@ -38,6 +39,8 @@ class RadarScreen
         irr::core::vector3df offset;
         irr::u32 radarRadiusPx;
 		irr::f32 tilt;
+        irr::video::ITexture* radarTexture; //Kept between updates, and only the changed regions copied in
+        void createTexture(irr::video::IImage* radarImage);
 };
 
 #endif
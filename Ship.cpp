@@ -42,13 +42,12 @@ irr::scene::IMeshSceneNode* Ship::getSceneNode() const
 
 irr::core::vector3df Ship::getRotation() const
 {
-    return ship->getRotation();
+    return rotation;
 }
 
 irr::core::vector3df Ship::getPosition() const
 {
-    ship->updateAbsolutePosition();//ToDo: This may be needed, but seems odd that it's required
-    return ship->getAbsolutePosition();
+    return irr::core::vector3df(xPos,yPos,zPos);
 }
 
 irr::f32 Ship::getLength() const
@@ -98,10 +97,37 @@ irr::f32 Ship::getSpeed() const
 
 void Ship::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
 {
+    irr::core::vector3df delta(deltaX,deltaY,deltaZ);
     xPos += deltaX;
     yPos += deltaY;
     zPos += deltaZ;
-    ship->setPosition(irr::core::vector3df(xPos,yPos,zPos));
+    previousPosition += delta;
+    ship->setPosition(ship->getPosition() + delta); //Keep the node where it is between steps, just moved with the origin
+}
+
+void Ship::savePose()
+{
+    previousPosition = irr::core::vector3df(xPos,yPos,zPos);
+    previousRotation = rotation;
+}
+
+void Ship::interpolateNode(irr::f32 alpha)
+{
+    irr::core::vector3df position(xPos,yPos,zPos);
+    ship->setPosition(previousPosition.getInterpolated(position,1.0-alpha)); //getInterpolated returns the first vector at 1, the second at 0
+
+    if (previousRotation == rotation) {
+        ship->setRotation(rotation);
+    } else {
+        //Interpolate the rotation as quaternions, so it turns the short way through 0/360 degrees
+        irr::core::quaternion previousQuaternion(previousRotation*irr::core::DEGTORAD);
+        irr::core::quaternion quaternion(rotation*irr::core::DEGTORAD);
+        irr::core::quaternion interpolated;
+        interpolated.slerp(previousQuaternion,quaternion,alpha);
+        irr::core::vector3df interpolatedRotation;
+        interpolated.toEuler(interpolatedRotation);
+        ship->setRotation(interpolatedRotation*irr::core::RADTODEG);
+    }
 }
 
 
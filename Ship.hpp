@@ -32,8 +32,8 @@ class Ship
         virtual ~Ship();
 
         irr::scene::IMeshSceneNode* getSceneNode() const;
-        irr::core::vector3df getRotation() const;
-        irr::core::vector3df getPosition() const;
+        irr::core::vector3df getRotation() const; //From the last simulation step, the scene node may be between steps
+        irr::core::vector3df getPosition() const; //From the last simulation step, the scene node may be between steps
         irr::f32 getLength() const;
         irr::f32 getWidth() const;
         irr::f32 getHeightCorrection() const;
@@ -43,6 +43,8 @@ class Ship
         irr::f32 getSpeed() const; //m/s
         void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
         void setPosition(irr::f32 xPos, irr::f32 yPos);
+        void savePose(); //Keep the position and rotation from the last simulation step, before running the next one
+        void interpolateNode(irr::f32 alpha); //Put the scene node between the last two simulation steps, alpha from 0 (previous) to 1 (latest)
 
     protected:
 
@@ -51,6 +53,9 @@ class Ship
         irr::f32 xPos;
         irr::f32 yPos;
         irr::f32 zPos;
+        irr::core::vector3df rotation; //Scene node rotation for the current simulation step (deg)
+        irr::core::vector3df previousPosition; //Pose at the previous simulation step
+        irr::core::vector3df previousRotation;
         irr::f32 spd;
         irr::f32 length;
         irr::f32 width;
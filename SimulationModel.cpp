@@ -21,12 +21,14 @@
 #include "Terrain.hpp"
 #include "Sky.hpp"
 #include "Buoys.hpp"
+#include "ContactImpostors.hpp"
 #include "Sound.hpp"
 
 #include "IniFile.hpp"
 #include "Constants.hpp"
 #include "Utilities.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -34,7 +36,7 @@
 
 //using namespace irr;
 
-SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneManager* scene, GUIMain* gui, Sound* sound, ScenarioData scenarioData, OperatingMode::Mode mode, irr::f32 viewAngle, irr::f32 lookAngle, irr::f32 cameraMinDistance, irr::f32 cameraMaxDistance, irr::u32 disableShaders):
+SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneManager* scene, GUIMain* gui, Sound* sound, ScenarioData scenarioData, OperatingMode::Mode mode, irr::f32 viewAngle, irr::f32 lookAngle, irr::f32 cameraMinDistance, irr::f32 cameraMaxDistance, irr::u32 disableShaders, irr::u32 radarThread, irr::f32 simulationRate, irr::u32 impostorSize):
     manOverboard(irr::core::vector3df(0,0,0),scene,dev,this,&terrain) //Initialise MOB
     {
         //get reference to scene manager
@@ -85,6 +87,14 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
         //set internal scenario time to start
         scenarioTime = startTime * SECONDS_IN_HOUR;
 
+        //Fixed step for the ship dynamics, so these don't depend on the frame rate
+        if (simulationRate <= 0) {
+            simulationRate = DEFAULT_SIMULATION_RATE;
+        }
+        simulationStep = 1.0/simulationRate;
+        stepAccumulator = 0;
+        collided = false;
+
         //Start paused initially
         device->getTimer()->setSpeed(0.0);
 
@@ -107,8 +117,18 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
             worldPath = userFolder + worldPath;
         }
 
+        //Times for the load time report
+        irr::u32 loadStartTime = device->getTimer()->getRealTime();
+
+        //Use the compiled world pack if it is there and up to date, otherwise the world's ini files
+        bool worldPackUsed = worldPack.load(worldPath);
+        if (!worldPackUsed) {
+            worldPack.readIni(worldPath);
+        }
+
         //Add terrain: Needs to happen first, so the terrain parameters are available
-        terrain.load(worldPath, smgr);
+        terrain.load(worldPath, smgr, worldPack);
+        irr::u32 terrainLoadedTime = device->getTimer()->getRealTime();
 
         //add water
         water.load(smgr,weather,disableShaders);
@@ -118,6 +138,7 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
 
         //Load own ship model.
         ownShip.load(scenarioData.ownShipData, smgr, this, &terrain, device);
+        terrain.update(ownShip.getPosition(),true); //Load any terrain tiles around own ship before starting
         if(mode == OperatingMode::Secondary) {
             ownShip.setSpeed(0); //Don't start moving if in secondary mode
         }
@@ -140,6 +161,9 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
 
         //Load the radar with config parameters
         radarCalculation.load(ownShip.getRadarConfigFile(),device);
+        if (radarThread == 1) {
+            radarCalculation.startScanThread(); //Run the radar scan in the background
+        }
 
         //set camera zoom to 1
         zoom = 1.0;
@@ -158,17 +182,35 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
         //Load other ships
         otherShips.load(scenarioData.otherShipsData,scenarioTime,mode,smgr,this,device);
 
+        //Objects fixed in the world are positioned relative to this, so they don't need moving one by one when the origin moves
+        worldNode = smgr->addEmptySceneNode();
+
         //Load buoys
-        buoys.load(worldPath, smgr, this,device);
+        buoys.load(worldPack, smgr, worldNode, this,device);
 
         //Load land objects
-        landObjects.load(worldPath, smgr, this, terrain, device);
+        landObjects.load(worldPack, smgr, worldNode, this, terrain, device);
 
         //Load land lights
-        landLights.load(worldPath, smgr, this, terrain);
+        landLights.load(worldPack, smgr, worldNode, this, terrain);
 
         //Load tidal information
-        tide.load(worldPath);
+        tide.load(worldPack.tide);
+
+        //Draw other ships and buoys as impostors when far away, batched together
+        impostors = new ContactImpostors(smgr->getRootSceneNode(), smgr, impostorSize);
+        impostors->drop(); //Held by the scene manager from here
+        for (irr::u32 i = 0; i < otherShips.getNumber(); i++) {
+            impostors->addContact(otherShips.getSceneNode(i));
+        }
+        for (irr::u32 i = 0; i < buoys.getNumber(); i++) {
+            impostors->addContact(buoys.getSceneNode(i));
+        }
+
+        //Report how long the world took to load
+        irr::u32 worldLoadedTime = device->getTimer()->getRealTime();
+        std::cout << "World " << worldName << (worldPackUsed ? " (compiled pack)" : "") << " loaded in " << worldLoadedTime - loadStartTime << " ms (terrain "
+                  << terrainLoadedTime - loadStartTime << " ms, water, ships and objects " << worldLoadedTime - terrainLoadedTime << " ms)" << std::endl;
 
         //Load rain
         rain.load(smgr, camera.getSceneNode(), device);
@@ -204,6 +246,13 @@ SimulationModel::SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneMan
         //initialise offset
         offsetPosition = irr::core::vector3d<int64_t>(0,0,0);
 
+        //Set up the initial ship poses and tide with a zero length step, and show the ships there
+        stepSimulation(0);
+        ownShip.savePose();
+        otherShips.savePoses();
+        ownShip.interpolateNode(1);
+        otherShips.interpolateNodes(1);
+
         //store time
         previousTime = device->getTimer()->getTime();
 
@@ -270,6 +319,10 @@ SimulationModel::~SimulationModel()
         return water.getLocalNormals(relPosX,relPosZ);
     }
 
+    void SimulationModel::getWaveHeightsAndNormals(const irr::f32* posX, const irr::f32* posZ, irr::f32* heights, irr::core::vector2df* normals, irr::u32 n) const {
+        water.getWaveHeightsAndNormals(posX,posZ,heights,normals,n);
+    }
+
     irr::core::vector2df SimulationModel::getTidalStream(irr::f32 longitude, irr::f32 latitude, uint64_t absoluteTime) const {
         return tide.getTidalStream(longitude,latitude,absoluteTime);
     }
@@ -838,6 +891,36 @@ SimulationModel::~SimulationModel()
         return loopNumber;
     }
 
+    bool SimulationModel::hasCollided() const
+    {
+        return collided;
+    }
+
+    irr::u32 SimulationModel::getNumberOfARPAContacts() const
+    {
+        return radarCalculation.getARPAContacts();
+    }
+
+    irr::f32 SimulationModel::getARPACPA(irr::u32 contact) const
+    {
+        return radarCalculation.getARPACPA(contact);
+    }
+
+    irr::f32 SimulationModel::getARPATCPA(irr::u32 contact) const
+    {
+        return radarCalculation.getARPATCPA(contact);
+    }
+
+    irr::f32 SimulationModel::getARPAHeading(irr::u32 contact) const
+    {
+        return radarCalculation.getARPAHeading(contact);
+    }
+
+    irr::f32 SimulationModel::getARPASpeed(irr::u32 contact) const
+    {
+        return radarCalculation.getARPASpeed(contact);
+    }
+
     std::string SimulationModel::getSerialisedScenario() const
     {
         return serialisedScenarioData;
@@ -967,9 +1050,29 @@ SimulationModel::~SimulationModel()
         //deltaTime = (currentTime - previousTime)/1000.f;
         previousTime = currentTime;
 
-        //add this to the scenario time
-        scenarioTime += deltaTime;
-        absoluteTime = Utilities::round(scenarioTime) + scenarioOffsetTime;
+        advance(deltaTime);
+    }
+
+    void SimulationModel::advance(irr::f32 deltaTime)
+    {
+        //Step the simulation through the time passed at a fixed step, so the ship handling is the same whatever the frame rate.
+        //At high accelerator settings the step is lengthened, so the steps per real second stay bounded.
+        irr::f32 stepTime = simulationStep*std::max(1.0f,device->getTimer()->getSpeed()/MAX_FULL_RATE_ACCELERATOR);
+        stepAccumulator += deltaTime;
+        if (stepAccumulator > MAX_SIMULATION_STEPS_PER_FRAME*stepTime) {
+            stepAccumulator = MAX_SIMULATION_STEPS_PER_FRAME*stepTime; //Drop time if far behind, rather than taking ever longer to catch up
+        }
+        irr::f32 steppedTime = 0;
+        while (stepAccumulator >= stepTime) {
+            stepSimulation(stepTime);
+            stepAccumulator -= stepTime;
+            steppedTime += stepTime;
+        }
+
+        //Show the ships between the last two steps, so they move smoothly when the steps and frames don't line up
+        irr::f32 stepFraction = stepAccumulator/stepTime;
+        ownShip.interpolateNode(stepFraction);
+        otherShips.interpolateNodes(stepFraction);
 
         //increment loop number
         loopNumber++;
@@ -981,10 +1084,6 @@ SimulationModel::~SimulationModel()
         //Ensure we have the right radar screen resolution
         setRadarDisplayRadius(guiMain->getRadarPixelRadius());
 
-        //Update tide height and tidal stream here.
-        tide.update(absoluteTime);
-        tideHeight = tide.getTideHeight();
-
         //update ambient lighting
         light.update(scenarioTime);
         //Note that linear fog is hardcoded into the water shader, so should be changed there if we use other fog types
@@ -995,24 +1094,18 @@ SimulationModel::~SimulationModel()
         rain.setIntensity(rainIntensity);
         rain.update(scenarioTime);
 
-        //update other ship positions etc
-        otherShips.update(deltaTime,scenarioTime,tideHeight,lightLevel); //Update other ship motion (based on leg information), and light visibility.
-
-        //update buoys (for lights)
+        //update other ship and buoy lights
+        otherShips.updateLights(scenarioTime,lightLevel);
         buoys.update(deltaTime,scenarioTime,tideHeight,lightLevel);
 
         //Update land lights
         landLights.update(deltaTime,scenarioTime,lightLevel);
 
-        //update own ship
-        ownShip.update(deltaTime, scenarioTime, tideHeight, weather);
-
-
-        //update man overboard
-        manOverboard.update(deltaTime, tideHeight);
+        //Load and unload terrain tiles as own ship moves
+        terrain.update(ownShip.getPosition());
 
         //Check for collisions
-        bool collided = checkOwnShipCollision();
+        collided = checkOwnShipCollision();
 
 
         //update water position
@@ -1028,19 +1121,21 @@ SimulationModel::~SimulationModel()
             deltaX = 500.0*Utilities::round(deltaX/500.0);
             deltaZ = 500.0*Utilities::round(deltaZ/500.0);
 
-            //Move all objects
-            ownShip.moveNode(deltaX,0,deltaZ);
-            terrain.moveNode(deltaX,0,deltaZ); //SLOW!
-            otherShips.moveNode(deltaX,0,deltaZ);
-            buoys.moveNode(deltaX,0,deltaZ);
-            landObjects.moveNode(deltaX,0,deltaZ);
-            landLights.moveNode(deltaX,0,deltaZ);
-            manOverboard.moveNode(deltaX,0,deltaZ);
-
             //Change stored offset
             offsetPosition.X -= deltaX;
             offsetPosition.Z -= deltaZ;
 
+            //Move to the new origin. Buoys, land objects and land lights only need their parent world node moving, and the ships
+            //keep their own positions, so are moved individually. Radar scan must not be running while the terrain moves
+            radarCalculation.pauseScanThread();
+            worldNode->setPosition(irr::core::vector3df(-1.0*offsetPosition.X,0,-1.0*offsetPosition.Z));
+            worldNode->updateAbsolutePosition(); //So children's absolute positions are right before the next scene update
+            ownShip.moveNode(deltaX,0,deltaZ);
+            terrain.moveNode(deltaX,0,deltaZ); //SLOW! Irrlicht's terrain node moves each of its vertices
+            otherShips.moveNode(deltaX,0,deltaZ);
+            manOverboard.moveNode(deltaX,0,deltaZ);
+            radarCalculation.resumeScanThread();
+
             std::string normalisedLogMessage = "Normalised, offset X: ";
             normalisedLogMessage.append(Utilities::lexical_cast<std::string>(offsetPosition.X));
             normalisedLogMessage.append(" Z: ");
@@ -1058,8 +1153,8 @@ SimulationModel::~SimulationModel()
 
         //set radar screen position, and update it with a radar image from the radar calculation
         irr::core::vector2di cursorPositionRadar = guiMain->getCursorPositionRadar();
-        radarCalculation.update(radarImage,radarImageOverlaid,offsetPosition,terrain,ownShip,buoys,otherShips,weather,rainIntensity,tideHeight,deltaTime,absoluteTime,cursorPositionRadar,isMouseDown);
-        radarScreen.update(radarImageOverlaid);
+        radarCalculation.update(radarImage,radarImageOverlaid,offsetPosition,terrain,ownShip,buoys,otherShips,weather,rainIntensity,tideHeight,steppedTime,absoluteTime,cursorPositionRadar,isMouseDown);
+        radarScreen.update(radarImageOverlaid, radarCalculation.getDirtyRegions());
         radarCamera.update();
 
         //check if paused
@@ -1123,6 +1218,30 @@ SimulationModel::~SimulationModel()
         guiMain->updateGuiData(guiData); //Set GUI heading in degrees and speed (in m/s)
     }
 
+    void SimulationModel::stepSimulation(irr::f32 stepTime)
+    {
+        //Keep the poses the ships are moving from, for interpolateNode()
+        ownShip.savePose();
+        otherShips.savePoses();
+
+        //add this to the scenario time
+        scenarioTime += stepTime;
+        absoluteTime = Utilities::round(scenarioTime) + scenarioOffsetTime;
+
+        //Update tide height and tidal stream here.
+        tide.update(absoluteTime);
+        tideHeight = tide.getTideHeight();
+
+        //update other ship positions etc
+        otherShips.update(stepTime,scenarioTime,tideHeight); //Update other ship motion (based on leg information)
+
+        //update own ship
+        ownShip.update(stepTime, scenarioTime, tideHeight, weather);
+
+        //update man overboard
+        manOverboard.update(stepTime, tideHeight);
+    }
+
     bool SimulationModel::checkOwnShipCollision()
     {
 
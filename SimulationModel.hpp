@@ -28,8 +28,10 @@
 class ScenarioData;
 class GUIMain;
 class GUIData;
+class ContactImpostors;
 class Sound;
 
+#include "WorldPack.hpp"
 #include "Terrain.hpp"
 #include "Light.hpp"
 #include "Water.hpp"
@@ -51,7 +53,7 @@ class SimulationModel //Start of the 'Model' part of MVC
 
 public:
 
-    SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneManager* scene, GUIMain* gui, Sound* sound, ScenarioData scenarioData, OperatingMode::Mode mode, irr::f32 viewAngle, irr::f32 lookAngle, irr::f32 cameraMinDistance, irr::f32 cameraMaxDistance, irr::u32 disableShaders);
+    SimulationModel(irr::IrrlichtDevice* dev, irr::scene::ISceneManager* scene, GUIMain* gui, Sound* sound, ScenarioData scenarioData, OperatingMode::Mode mode, irr::f32 viewAngle, irr::f32 lookAngle, irr::f32 cameraMinDistance, irr::f32 cameraMaxDistance, irr::u32 disableShaders, irr::u32 radarThread, irr::f32 simulationRate, irr::u32 impostorSize);
     ~SimulationModel();
     irr::f32 longToX(irr::f32 longitude) const;
     irr::f32 latToZ(irr::f32 latitude) const;
@@ -91,6 +93,7 @@ public:
 
     irr::f32 getWaveHeight(irr::f32 posX, irr::f32 posZ) const; //Return wave height (not tide) at the world position specified
     irr::core::vector2df getLocalNormals(irr::f32 relPosX, irr::f32 relPosZ) const;
+    void getWaveHeightsAndNormals(const irr::f32* posX, const irr::f32* posZ, irr::f32* heights, irr::core::vector2df* normals, irr::u32 n) const; //For n world positions at once, normals can be 0 if not needed
 
     irr::core::vector2df getTidalStream(irr::f32 longitude, irr::f32 latitude, uint64_t absoluteTime) const; //Tidal stream in m/s for the specified absolute position
 
@@ -168,6 +171,12 @@ public:
     void setMouseDown(bool isMouseDown);
     void setZoom(bool zoomOn);
     irr::u32 getLoopNumber() const;
+    bool hasCollided() const; //Own ship was in collision at the last update
+    irr::u32 getNumberOfARPAContacts() const;
+    irr::f32 getARPACPA(irr::u32 contact) const; //Contacts are numbered from 1, as for the user. CPA in Nm
+    irr::f32 getARPATCPA(irr::u32 contact) const; //Minutes
+    irr::f32 getARPAHeading(irr::u32 contact) const;
+    irr::f32 getARPASpeed(irr::u32 contact) const; //Kts
     std::string getSerialisedScenario() const;
     std::string getScenarioName() const;
     std::string getWorldName() const;
@@ -189,7 +198,8 @@ public:
 	void startHorn();
 	void endHorn();
 
-    void update();
+    void update(); //Advance by the time since the last update, from the device timer
+    void advance(irr::f32 deltaTime); //Advance by deltaTime (s) of simulated time, without reading the timer, e.g. when running headless
 
 private:
     irr::IrrlichtDevice* device;
@@ -206,6 +216,7 @@ private:
     irr::f32 visibilityRange; //Nm
     irr::u32 loopNumber; //u32 should be up to 4,294,967,295, so over 2 years at 60 fps
     irr::f32 zoom;
+    WorldPack worldPack; //Before terrain, as the terrain can use the pack's memory
     Terrain terrain;
     Light light;
     OwnShip ownShip;
@@ -229,15 +240,24 @@ private:
     irr::u32 currentTime; //Computer clock time
     irr::u32 previousTime; //Computer clock time
     irr::f32 deltaTime;
-    irr::f32 scenarioTime; //Simulation internal time, starting at zero at 0000h on start day of simulation
+    irr::f64 scenarioTime; //Simulation internal time, starting at zero at 0000h on start day of simulation. Double, so adding many short steps doesn't lose time
+    irr::f32 simulationStep; //Fixed simulation time step (s), at accelerator settings up to MAX_FULL_RATE_ACCELERATOR
+    irr::f32 stepAccumulator; //Simulated time (s) passed but not yet stepped through
+    bool collided; //Own ship in collision at the last update
+
+    //advance the ships, tide and man overboard by one fixed time step
+    void stepSimulation(irr::f32 stepTime);
     uint64_t scenarioOffsetTime; //Simulation day's start time from unix epoch (1 Jan 1970)
     uint64_t absoluteTime; //Unix timestamp for current time, including start day. Calculated from scenarioTime and scenarioOffsetTime
 
     //utility function to check for collision
     bool checkOwnShipCollision();
 
-    //Offset position handling
+    //Offset position handling: Scene nodes are positioned relative to offsetPosition, which moves to keep own ship near the origin
     irr::core::vector3d<int64_t> offsetPosition;
+    irr::scene::ISceneNode* worldNode; //Parent of buoys, land objects and land lights, at -offsetPosition, so these all move with it
+
+    ContactImpostors* impostors; //Draws distant other ships and buoys, held by the scene manager
 
     //store useful information
     std::string scenarioName;
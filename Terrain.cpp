@@ -19,11 +19,16 @@
 
 #include "Terrain.hpp"
 
-#include "IniFile.hpp"
 #include "Constants.hpp"
 #include "Utilities.hpp"
+#include "MappedFile.hpp"
+#include "TerrainTileManager.hpp"
+#include "WorldPack.hpp"
 
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cfloat> //For FLT_MAX
 
 //using namespace irr;
 
@@ -34,19 +39,28 @@ Terrain::Terrain()
 
 Terrain::~Terrain()
 {
-    //dtor
+    for (unsigned int i = 0; i<heightMapFiles.size(); i++) {
+        delete heightMapFiles.at(i);
+    }
+    for (unsigned int i = 0; i<heightfields.size(); i++) {
+        delete heightfields.at(i).tiles;
+    }
 }
 
 void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr)
+{
+    //Get terrain information from terrain.ini
+    WorldPack worldData;
+    worldData.readTerrainIni(worldPath);
+    load(worldPath, smgr, worldData);
+}
+
+void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr, const WorldPack& worldData)
 {
 
     irr::video::IVideoDriver* driver = smgr->getVideoDriver();
 
-    //Get full path to the main Terrain.ini file
-    std::string worldTerrainFile = worldPath;
-    worldTerrainFile.append("/terrain.ini");
-
-    irr::u32 numberOfTerrains = IniFile::iniFileTou32(worldTerrainFile, "Number");
+    irr::u32 numberOfTerrains = worldData.terrains.size();
     if (numberOfTerrains <= 0) {
         std::cerr << "Could not load terrain." << std::endl;
         exit(EXIT_FAILURE);
@@ -54,23 +68,38 @@ void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr
 
     for (unsigned int i = 1; i<=numberOfTerrains; i++) {
 
+        const WorldPackTerrain& terrainData = worldData.terrains.at(i-1);
 
-        irr::f32 terrainLong = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLong",i));
-        irr::f32 terrainLat = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLat",i));
-        irr::f32 terrainLongExtent = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLongExtent",i));
-        irr::f32 terrainLatExtent = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLatExtent",i));
+        irr::f32 terrainLong = terrainData.longitude;
+        irr::f32 terrainLat = terrainData.latitude;
+        irr::f32 terrainLongExtent = terrainData.longExtent;
+        irr::f32 terrainLatExtent = terrainData.latExtent;
 
-        irr::f32 terrainMaxHeight=IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainMaxHeight",i));
-        irr::f32 seaMaxDepth=IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("SeaMaxDepth",i));
-        irr::f32 terrainHeightMapSize=IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainHeightMapSize",i));
+        irr::f32 terrainMaxHeight=terrainData.maxHeight;
+        irr::f32 seaMaxDepth=terrainData.seaMaxDepth;
+        irr::f32 terrainHeightMapSize=terrainData.heightMapSize;
 
-        std::string heightMapName = IniFile::iniFileToString(worldTerrainFile, IniFile::enumerate1("HeightMap",i));
-        std::string textureMapName = IniFile::iniFileToString(worldTerrainFile, IniFile::enumerate1("Texture",i));
+        std::string heightMapName = terrainData.heightMapName;
+        std::string textureMapName = terrainData.textureName;
 
         //Terrain dimensions in metres
         irr::f32 terrainXWidth = terrainLongExtent * 2.0 * PI * EARTH_RAD_M * cos( irr::core::degToRad(terrainLat + terrainLatExtent/2.0)) / 360.0;
         irr::f32 terrainZWidth = terrainLatExtent  * 2.0 * PI * EARTH_RAD_M / 360;
 
+        if (i==1) {
+            //Private member variables used in further calculations
+            primeTerrainLong = terrainLong;
+            primeTerrainXWidth = terrainXWidth;
+            primeTerrainLongExtent = terrainLongExtent;
+            primeTerrainLat = terrainLat;
+            primeTerrainZWidth = terrainZWidth;
+            primeTerrainLatExtent = terrainLatExtent;
+        }
+
+        //Non-primary terrains need to be moved to account for their position (primary terrain starts at 0,0)
+        irr::f32 terrainOffsetX = (terrainLong - primeTerrainLong) * primeTerrainXWidth / primeTerrainLongExtent;
+        irr::f32 terrainOffsetZ = (terrainLat - primeTerrainLat) * primeTerrainZWidth / primeTerrainLatExtent;
+
         //calculations just needed for terrain loading
         irr::f32 scaleX = terrainXWidth / (terrainHeightMapSize);
         irr::f32 scaleY = (terrainMaxHeight + seaMaxDepth)/ (255.0);
@@ -85,11 +114,68 @@ void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr
         textureMapPath.append("/");
         textureMapPath.append(textureMapName);
 
+        //Tiled terrain, where the tiles around own ship are loaded as needed by a TerrainTileManager
+        std::string tileDirectoryName = terrainData.tileDirectory;
+        if (!tileDirectoryName.empty()) {
+            irr::u32 tilesX = terrainData.tilesX;
+            irr::u32 tilesZ = terrainData.tilesZ;
+            irr::u32 tileHeightMapSize = terrainData.tileHeightMapSize;
+            irr::f32 tileLoadRadius = terrainData.tileLoadRadius;
+
+            std::string tileDirectoryPath = worldPath;
+            tileDirectoryPath.append("/");
+            tileDirectoryPath.append(tileDirectoryName);
+
+            TerrainTileManager* tiles = new TerrainTileManager();
+            if (tilesX == 0 || tilesZ == 0 || !tiles->load(tileDirectoryPath, textureMapName.empty() ? "" : textureMapPath, tilesX, tilesZ, tileHeightMapSize,
+                                                           terrainXWidth/tilesX, terrainZWidth/tilesZ, tileLoadRadius, irr::core::vector3df(terrainOffsetX,0.f,terrainOffsetZ), smgr)) {
+                //Could not load terrain
+                std::cerr << "Could not load terrain." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            TerrainHeightfield heightfield;
+            heightfield.mappedHeights = 0;
+            heightfield.tiles = tiles;
+            heightfield.size = 0;
+            terrains.push_back(0);
+            heightfields.push_back(heightfield);
+
+            std::cout << "Terrain " << i << " (" << tileDirectoryName << ", " << tilesX << "x" << tilesZ << " tiles of " << tileHeightMapSize << "x" << tileHeightMapSize
+                      << ") will be loaded within " << tileLoadRadius << " m of own ship" << std::endl;
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point terrainStartTime = std::chrono::steady_clock::now();
+
+        //Check if extension is .f32 for binary floating point file
+        std::string extension = "";
+        if (heightMapName.length() > 3) {
+            extension = heightMapName.substr(heightMapName.length() - 4,4);
+            Utilities::to_lower(extension);
+        }
+        bool binaryHeightMap = (extension.compare(".f32") == 0);
+
         //Fixme: Could also check that the terrain is now 2^n + 1 square (was 2^n in B3d version)
         //Add an empty terrain
         irr::scene::ITerrainSceneNode* terrain = smgr->addTerrainSceneNode("",0,-1,irr::core::vector3df(0.f, terrainY, 0.f),irr::core::vector3df(0.f, 0.f, 0.f),irr::core::vector3df(scaleX,scaleY,scaleZ),irr::video::SColor(255,255,255,255),5,irr::scene::ETPS_17,0,true);
-        //Load the map
-        irr::io::IReadFile* heightMapFile = smgr->getFileSystem()->createAndOpenFile(heightMapPath.c_str());
+        //Open the map
+        irr::io::IReadFile* heightMapFile = 0;
+        MappedFile* heightMapData = 0;
+        bool packedHeightMap = (terrainData.heights != 0);
+        if (packedHeightMap) {
+            //Already decoded in the world pack, as the heights of the mesh, so load them the same way as a binary file
+            heightMapFile = smgr->getFileSystem()->createMemoryReadFile(terrainData.heights,terrainData.heightsSize*terrainData.heightsSize*sizeof(irr::f32),heightMapPath.c_str(),false);
+        } else if (binaryHeightMap) {
+            //Map the file into memory, so the scene node is built straight from it, and the same memory is then used for height
+            //sampling instead of a copy
+            heightMapData = new MappedFile();
+            if (heightMapData->open(heightMapPath) && heightMapData->getSize() <= 0x7FFFFFFF) {
+                heightMapFile = smgr->getFileSystem()->createMemoryReadFile(heightMapData->getData(),(irr::s32)heightMapData->getSize(),heightMapPath.c_str(),false);
+            }
+        } else {
+            heightMapFile = smgr->getFileSystem()->createAndOpenFile(heightMapPath.c_str());
+        }
         //Check the height map file has loaded and the terrain exists
         if (terrain==0 || heightMapFile == 0) {
             //Could not load terrain
@@ -99,20 +185,16 @@ void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr
 
         //Load the terrain and check success
         bool loaded = false;
-        //Check if extension is .irr::f32 for binary floating point file
-        std::string extension = "";
-        if (heightMapName.length() > 3) {
-            extension = heightMapName.substr(heightMapName.length() - 4,4);
-            Utilities::to_lower(extension);
-        }
-        if (extension.compare(".irr::f32") == 0 ) {
+        if (packedHeightMap || binaryHeightMap) {
             //Binary file
             loaded = terrain->loadHeightMapRAW(heightMapFile,32,true,true);
+        } else {
+            loaded = terrain->loadHeightMap(heightMapFile);
+        }
+        if (binaryHeightMap) {
             //Set scales etc to be 1.0, so heights are used directly
             terrain->setScale(irr::core::vector3df(scaleX,1.0f,scaleZ));
             terrain->setPosition(irr::core::vector3df(0.f, 0.f, 0.f));
-        } else {
-            loaded = terrain->loadHeightMap(heightMapFile);
         }
 
         if (!loaded) {
@@ -124,45 +206,132 @@ void Terrain::load(const std::string& worldPath, irr::scene::ISceneManager* smgr
         heightMapFile->drop();
         //TODO: Do we need to drop terrain?
 
+        std::chrono::steady_clock::time_point heightMapLoadedTime = std::chrono::steady_clock::now();
+
         terrain->setMaterialFlag(irr::video::EMF_FOG_ENABLE, true);
         terrain->setMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, true); //Normalise normals on scaled meshes, for correct lighting
         //Todo: Anti-aliasing flag?
-        terrain->setMaterialTexture(0, driver->getTexture(textureMapPath.c_str()));
-
-        if (i==1) {
-            //Private member variables used in further calculations
-            primeTerrainLong = terrainLong;
-            primeTerrainXWidth = terrainXWidth;
-            primeTerrainLongExtent = terrainLongExtent;
-            primeTerrainLat = terrainLat;
-            primeTerrainZWidth = terrainZWidth;
-            primeTerrainLatExtent = terrainLatExtent;
-
-
+        if (terrainData.texturePixels) {
+            //Decoded in the world pack
+            irr::video::IImage* textureImage = driver->createImageFromData(irr::video::ECF_A8R8G8B8,irr::core::dimension2d<irr::u32>(terrainData.textureWidth,terrainData.textureHeight),(void*)terrainData.texturePixels,true,false);
+            terrain->setMaterialTexture(0, driver->addTexture(textureMapPath.c_str(),textureImage));
+            textureImage->drop();
         } else {
-            //Non-primary terrains need to be moved to account for their position (primary terrain starts at 0,0)
+            terrain->setMaterialTexture(0, driver->getTexture(textureMapPath.c_str()));
+        }
 
+        if (i>1) {
             irr::core::vector3df currentPos = terrain->getPosition();
-            irr::f32 deltaX = (terrainLong - primeTerrainLong) * primeTerrainXWidth / primeTerrainLongExtent;
-            irr::f32 deltaZ = (terrainLat - primeTerrainLat) * primeTerrainZWidth / primeTerrainLatExtent;
-            irr::f32 newPosX = currentPos.X + deltaX;
+            irr::f32 newPosX = currentPos.X + terrainOffsetX;
             irr::f32 newPosY = currentPos.Y;
-            irr::f32 newPosZ = currentPos.Z + deltaZ;
+            irr::f32 newPosZ = currentPos.Z + terrainOffsetZ;
             terrain->setPosition(irr::core::vector3df(newPosX,newPosY,newPosZ));
         }
 
         terrains.push_back(terrain);
+        if (packedHeightMap) {
+            addHeightfield(terrain,terrainData.heights,terrainData.heightsSize*terrainData.heightsSize);
+        } else if (heightMapData) {
+            addHeightfield(terrain,(const irr::f32*)heightMapData->getData(),heightMapData->getSize()/sizeof(irr::f32));
+        } else {
+            addHeightfield(terrain,0,0);
+        }
+        if (heightMapData) {
+            heightMapFiles.push_back(heightMapData);
+        }
+
+        //Load time report
+        std::chrono::steady_clock::time_point terrainLoadedTime = std::chrono::steady_clock::now();
+        irr::s32 loadedSize = heightfields.back().size;
+        std::cout << "Terrain " << i << " (" << heightMapName << ", " << loadedSize << "x" << loadedSize;
+        if (packedHeightMap) {
+            std::cout << ", from world pack";
+        } else if (heightMapData) {
+            std::cout << (heightMapData->isMapped() ? ", memory mapped" : ", read into memory");
+        }
+        std::cout << ") loaded in " << std::chrono::duration_cast<std::chrono::milliseconds>(terrainLoadedTime - terrainStartTime).count() << " ms"
+                  << " (heightmap " << std::chrono::duration_cast<std::chrono::milliseconds>(heightMapLoadedTime - terrainStartTime).count() << " ms)" << std::endl;
 
     }
 
 
 }
 
+void Terrain::addHeightfield(irr::scene::ITerrainSceneNode* terrain, const irr::f32* sourceHeights, irr::u32 sourceHeightCount)
+{
+    //Copy the heights from the terrain's mesh, which is what the scene node's own getHeight() uses. For a binary heightmap or a
+    //world pack, the mesh heights are the source values in the same order, so these are used directly instead.
+    TerrainHeightfield heightfield;
+    heightfield.mappedHeights = 0;
+    heightfield.tiles = 0;
+    heightfield.size = 0;
+    heightfield.position = terrain->getPosition();
+    heightfield.scale = terrain->getScale();
+
+    irr::scene::IMesh* mesh = terrain->getMesh();
+    if (mesh && mesh->getMeshBufferCount() > 0 && mesh->getMeshBuffer(0)->getVertexType() == irr::video::EVT_2TCOORDS) {
+        irr::scene::IMeshBuffer* meshBuffer = mesh->getMeshBuffer(0);
+        const irr::video::S3DVertex2TCoords* vertices = (const irr::video::S3DVertex2TCoords*)meshBuffer->getVertices();
+        irr::u32 vertexCount = meshBuffer->getVertexCount();
+        heightfield.size = irr::core::floor32(std::sqrt((irr::f32)vertexCount) + 0.5f);
+        if ((irr::u32)(heightfield.size*heightfield.size) != vertexCount) {
+            heightfield.size = 0; //Not square, so leave empty
+        } else if (sourceHeights && sourceHeightCount >= vertexCount) {
+            heightfield.mappedHeights = sourceHeights;
+        } else {
+            heightfield.heights.resize(vertexCount);
+            for (irr::u32 i = 0; i<vertexCount; i++) {
+                heightfield.heights[i] = vertices[i].Pos.Y;
+            }
+        }
+    }
+
+    heightfields.push_back(heightfield);
+}
+
+namespace
+{
+    //Height of one terrain at a point, or -FLT_MAX if outside it. Same calculation as CTerrainSceneNode::getHeight(), on the
+    //two triangles of each grid square (terrains are never rotated)
+    inline irr::f32 heightfieldHeight(const TerrainHeightfield& heightfield, irr::f32 x, irr::f32 z)
+    {
+        irr::f32 posX = (x - heightfield.position.X) / heightfield.scale.X;
+        irr::f32 posZ = (z - heightfield.position.Z) / heightfield.scale.Z;
+
+        irr::s32 X = irr::core::floor32(posX);
+        irr::s32 Z = irr::core::floor32(posZ);
+
+        if (X < 0 || X >= heightfield.size-1 || Z < 0 || Z >= heightfield.size-1) {
+            return -FLT_MAX;
+        }
+
+        const irr::f32* heights = heightfield.mappedHeights ? heightfield.mappedHeights : &heightfield.heights[0];
+        irr::f32 a = heights[X * heightfield.size + Z];
+        irr::f32 b = heights[(X + 1) * heightfield.size + Z];
+        irr::f32 c = heights[X * heightfield.size + (Z + 1)];
+        irr::f32 d = heights[(X + 1) * heightfield.size + (Z + 1)];
+
+        //offset from integer position
+        irr::f32 dx = posX - X;
+        irr::f32 dz = posZ - Z;
+
+        irr::f32 height;
+        if (dx > dz) {
+            height = a + (d - b)*dz + (b - a)*dx;
+        } else {
+            height = a + (d - c)*dx + (c - a)*dz;
+        }
+
+        return height * heightfield.scale.Y + heightfield.position.Y;
+    }
+}
+
 irr::f32 Terrain::getHeight(irr::f32 x, irr::f32 z) const //Get height from global coordinates
 {
     //Check down list, find highest number that does not return -FLT_MAX (or return -FLT_MAX if none)
-    for (int i=(int)terrains.size()-1; i>=0; i--) {
-        irr::f32 thisHeight = terrains.at(i)->getHeight(x,z);
+    for (int i=(int)heightfields.size()-1; i>=0; i--) {
+        const TerrainHeightfield& heightfield = heightfields[i];
+        irr::f32 thisHeight = heightfield.tiles ? heightfield.tiles->getHeight(x,z) : heightfieldHeight(heightfield,x,z);
         if (thisHeight > -FLT_MAX) {
             return thisHeight;
         }
@@ -172,6 +341,38 @@ irr::f32 Terrain::getHeight(irr::f32 x, irr::f32 z) const //Get height from glob
     return -FLT_MAX;
 }
 
+void Terrain::getHeights(const irr::f32* x, const irr::f32* z, irr::f32* heights, irr::u32 n) const
+{
+    for (irr::u32 j = 0; j<n; j++) {
+        heights[j] = -FLT_MAX;
+    }
+
+    //Same priority as getHeight(): the last terrain that covers a point sets its height. Go through one terrain at a time, so
+    //the inner loop stays on one heightfield.
+    for (int i=(int)heightfields.size()-1; i>=0; i--) {
+        const TerrainHeightfield& heightfield = heightfields[i];
+        if (heightfield.tiles) {
+            heightfield.tiles->getHeights(x,z,heights,n);
+        } else {
+            for (irr::u32 j = 0; j<n; j++) {
+                if (heights[j] == -FLT_MAX) {
+                    heights[j] = heightfieldHeight(heightfield,x[j],z[j]);
+                }
+            }
+        }
+        bool allFound = true;
+        for (irr::u32 j = 0; j<n; j++) {
+            if (heights[j] == -FLT_MAX) {
+                allFound = false;
+                break;
+            }
+        }
+        if (allFound) {
+            return;
+        }
+    }
+}
+
 irr::f32 Terrain::longToX(irr::f32 longitude) const
 {
     return ((longitude - primeTerrainLong ) * (primeTerrainXWidth)) / primeTerrainLongExtent;
@@ -190,13 +391,38 @@ irr::f32 Terrain::zToLat(irr::f32 z) const{
     return primeTerrainLat + z*primeTerrainLatExtent/primeTerrainZWidth;
 }
 
+void Terrain::update(irr::core::vector3df ownShipPosition, bool waitForTiles)
+{
+    for (unsigned int i=0; i<heightfields.size(); i++) {
+        if (heightfields.at(i).tiles) {
+            heightfields.at(i).tiles->update(ownShipPosition,waitForTiles);
+        }
+    }
+}
+
+irr::u32 Terrain::getTileGeneration() const
+{
+    irr::u32 tileGeneration = 0;
+    for (unsigned int i=0; i<heightfields.size(); i++) {
+        if (heightfields.at(i).tiles) {
+            tileGeneration += heightfields.at(i).tiles->getTileGeneration();
+        }
+    }
+    return tileGeneration;
+}
+
 void Terrain::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
 {
     for (unsigned int i=0; i<terrains.size(); i++) {
+        if (heightfields.at(i).tiles) {
+            heightfields.at(i).tiles->moveNode(deltaX,deltaY,deltaZ);
+            continue;
+        }
         irr::core::vector3df currentPos = terrains.at(i)->getPosition();
         irr::f32 newPosX = currentPos.X + deltaX;
         irr::f32 newPosY = currentPos.Y + deltaY;
         irr::f32 newPosZ = currentPos.Z + deltaZ;
         terrains.at(i)->setPosition(irr::core::vector3df(newPosX,newPosY,newPosZ));
+        heightfields.at(i).position = terrains.at(i)->getPosition();
     }
 }
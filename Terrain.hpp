@@ -22,21 +22,42 @@
 #include <string>
 #include <vector>
 
+class MappedFile;
+class TerrainTileManager;
+class WorldPack;
+
+//One terrain's heights, so they can be sampled without going through the scene node
+struct TerrainHeightfield {
+    std::vector<irr::f32> heights; //Unscaled heightmap values, as in the terrain scene node's mesh, [x*size + z]
+    const irr::f32* mappedHeights; //If not 0, the same values read directly from a memory mapped .f32 heightmap or world pack, and heights is empty
+    TerrainTileManager* tiles; //If not 0, this is a tiled terrain, and heights come from the tiles currently loaded instead
+    irr::s32 size; //Number of points along each side
+    irr::core::vector3df position; //Placement of the terrain, as in the scene node
+    irr::core::vector3df scale;
+};
+
 class Terrain
 {
     public:
         Terrain();
         virtual ~Terrain();
         void load(const std::string& worldPath, irr::scene::ISceneManager* smgr);
+        void load(const std::string& worldPath, irr::scene::ISceneManager* smgr, const WorldPack& worldData); //worldData must last as long as the Terrain if it is a compiled pack
         irr::f32 longToX(irr::f32 longitude) const;
         irr::f32 latToZ(irr::f32 latitude) const;
         irr::f32 xToLong(irr::f32 x) const;
         irr::f32 zToLat(irr::f32 z) const;
         irr::f32 getHeight(irr::f32 x, irr::f32 z) const;
+        void getHeights(const irr::f32* x, const irr::f32* z, irr::f32* heights, irr::u32 n) const; //Heights at n points, the same as calling getHeight() for each, except that tiled terrains only use their loaded tiles
+        void update(irr::core::vector3df ownShipPosition, bool waitForTiles=false); //Load and unload tiles of tiled terrains around own ship
+        irr::u32 getTileGeneration() const; //Changes when tiled terrains load or unload tiles, so heights found before may no longer match
         void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
 
     private:
-        std::vector<irr::scene::ITerrainSceneNode*> terrains;
+        std::vector<irr::scene::ITerrainSceneNode*> terrains; //0 for tiled terrains
+        std::vector<TerrainHeightfield> heightfields; //Same order as terrains
+        std::vector<MappedFile*> heightMapFiles; //Binary heightmaps, kept mapped for the heightfields that use them
+        void addHeightfield(irr::scene::ITerrainSceneNode* terrain, const irr::f32* sourceHeights, irr::u32 sourceHeightCount);
         irr::f32 primeTerrainLong;
         irr::f32 primeTerrainXWidth;
         irr::f32 primeTerrainLongExtent;
@@ -0,0 +1,442 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "TerrainTileManager.hpp"
+
+#include "MappedFile.hpp"
+#include "Utilities.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cfloat> //For FLT_MAX
+
+//using namespace irr;
+
+namespace
+{
+    //Interpolate on the two triangles of a grid square, the same way as CTerrainSceneNode::getHeight(). a is the height at
+    //(X,Z), b at (X+1,Z), c at (X,Z+1) and d at (X+1,Z+1), and dx, dz are the offsets from (X,Z)
+    inline irr::f32 triangleHeight(irr::f32 a, irr::f32 b, irr::f32 c, irr::f32 d, irr::f32 dx, irr::f32 dz)
+    {
+        if (dx > dz) {
+            return a + (d - b)*dz + (b - a)*dx;
+        } else {
+            return a + (d - c)*dx + (c - a)*dz;
+        }
+    }
+
+    //Shortest horizontal distance from a point to a rectangle (0 if inside)
+    irr::f32 distanceToRectangle(irr::core::vector3df point, irr::f32 minX, irr::f32 minZ, irr::f32 maxX, irr::f32 maxZ)
+    {
+        irr::f32 dx = std::max(std::max(minX - point.X, point.X - maxX), 0.0f);
+        irr::f32 dz = std::max(std::max(minZ - point.Z, point.Z - maxZ), 0.0f);
+        return std::sqrt(dx*dx + dz*dz);
+    }
+}
+
+TerrainTileManager::TerrainTileManager()
+{
+    smgr = 0;
+    tilesX = 0;
+    tilesZ = 0;
+    tileSize = 0;
+    tileXWidth = 0;
+    tileZWidth = 0;
+    loadRadius = 0;
+    unloadRadius = 0;
+    tileGeneration = 0;
+    loaderStopRequested = false;
+}
+
+TerrainTileManager::~TerrainTileManager()
+{
+    if (loaderThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(tileMutex);
+            loaderStopRequested = true;
+        }
+        requestCondition.notify_one();
+        loaderThread.join();
+    }
+
+    //Scene nodes and textures belong to the scene manager, so only the height maps need freeing here
+    for (unsigned int i = 0; i<tiles.size(); i++) {
+        delete tiles.at(i).heightMap;
+    }
+}
+
+bool TerrainTileManager::load(const std::string& tileDirectory, const std::string& defaultTexturePath, irr::u32 tilesX, irr::u32 tilesZ, irr::u32 tileHeightMapSize,
+                              irr::f32 tileXWidth, irr::f32 tileZWidth, irr::f32 loadRadius, irr::core::vector3df position, irr::scene::ISceneManager* smgr)
+{
+    if (tilesX == 0 || tilesZ == 0 || tileHeightMapSize < 2 || tileXWidth <= 0 || tileZWidth <= 0 || loaderThread.joinable()) {
+        return false;
+    }
+
+    this->smgr = smgr;
+    this->tileDirectory = tileDirectory;
+    this->defaultTexturePath = defaultTexturePath;
+    this->tilesX = tilesX;
+    this->tilesZ = tilesZ;
+    this->tileSize = tileHeightMapSize;
+    this->tileXWidth = tileXWidth;
+    this->tileZWidth = tileZWidth;
+    this->loadRadius = loadRadius;
+    this->unloadRadius = 1.2*loadRadius + 0.5*std::max(tileXWidth,tileZWidth); //Margin, so tiles aren't reloaded when own ship moves back and forward near the limit
+    this->position = position;
+
+    TerrainTile emptyTile;
+    emptyTile.state = TILE_UNLOADED;
+    emptyTile.heightMap = 0;
+    emptyTile.node = 0;
+    emptyTile.texture = 0;
+    tiles.assign(tilesX*tilesZ, emptyTile);
+
+    loaderStopRequested = false;
+    loaderThread = std::thread(&TerrainTileManager::loaderThreadLoop, this);
+
+    return true;
+}
+
+void TerrainTileManager::update(irr::core::vector3df centre, bool waitForTiles)
+{
+    std::vector<std::pair<irr::f32, irr::u32> > newRequests; //Distance and tile index
+    std::vector<irr::u32> tilesInRange;
+    std::vector<irr::u32> tilesToUnload;
+
+    {
+        std::lock_guard<std::mutex> lock(tileMutex);
+        for (irr::u32 tileX = 0; tileX<tilesX; tileX++) {
+            for (irr::u32 tileZ = 0; tileZ<tilesZ; tileZ++) {
+                irr::u32 tileIndex = tileX*tilesZ + tileZ;
+                TerrainTile& tile = tiles[tileIndex];
+                irr::core::vector3df tilePosition = getTilePosition(tileX,tileZ);
+                irr::f32 distance = distanceToRectangle(centre,tilePosition.X,tilePosition.Z,tilePosition.X+tileXWidth,tilePosition.Z+tileZWidth);
+
+                if (distance < loadRadius) {
+                    tilesInRange.push_back(tileIndex);
+                    if (tile.state == TILE_UNLOADED) {
+                        tile.state = TILE_REQUESTED;
+                        newRequests.push_back(std::make_pair(distance,tileIndex));
+                    }
+                } else if (distance > unloadRadius && tile.state != TILE_UNLOADED) {
+                    tilesToUnload.push_back(tileIndex);
+                }
+            }
+        }
+
+        //Load the nearest tiles first
+        std::sort(newRequests.begin(),newRequests.end());
+        for (unsigned int i = 0; i<newRequests.size(); i++) {
+            requestedTiles.push_back(newRequests.at(i).second);
+        }
+    }
+    if (!newRequests.empty()) {
+        requestCondition.notify_one();
+    }
+
+    for (unsigned int i = 0; i<tilesToUnload.size(); i++) {
+        unloadTile(tilesToUnload.at(i));
+    }
+
+    if (waitForTiles) {
+        std::unique_lock<std::mutex> lock(tileMutex);
+        loadedCondition.wait(lock, [this, &tilesInRange]{
+            for (unsigned int i = 0; i<tilesInRange.size(); i++) {
+                if (tiles[tilesInRange.at(i)].state == TILE_REQUESTED) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+    //Make scene nodes for loaded tiles. Building a node takes a noticeable time, so only make one each update unless waiting.
+    //The node is only used on this thread, so the state just needs checking with the lock held.
+    for (unsigned int i = 0; i<tilesInRange.size(); i++) {
+        irr::u32 tileIndex = tilesInRange.at(i);
+        bool loaded;
+        {
+            std::lock_guard<std::mutex> lock(tileMutex);
+            loaded = (tiles[tileIndex].state == TILE_LOADED);
+        }
+        if (loaded && tiles[tileIndex].node == 0) {
+            makeNode(tileIndex);
+            if (!waitForTiles) {
+                break;
+            }
+        }
+    }
+}
+
+irr::f32 TerrainTileManager::getHeight(irr::f32 x, irr::f32 z) const
+{
+    irr::u32 tileX;
+    irr::u32 tileZ;
+    irr::core::vector3df tilePosition;
+    {
+        std::lock_guard<std::mutex> lock(tileMutex);
+        if (!findTile(x,z,tileX,tileZ)) {
+            return -FLT_MAX;
+        }
+        tilePosition = getTilePosition(tileX,tileZ);
+        const TerrainTile& tile = tiles[tileX*tilesZ + tileZ];
+        if (tile.state == TILE_LOADED) {
+            return getTileHeight((const irr::f32*)tile.heightMap->getData(),tilePosition,x,z);
+        }
+    }
+
+    //Not loaded, for example a land object away from own ship, so read from the file without loading the whole tile
+    return readTileHeight(tileX,tileZ,tilePosition,x,z);
+}
+
+void TerrainTileManager::getHeights(const irr::f32* x, const irr::f32* z, irr::f32* heights, irr::u32 n) const
+{
+    std::lock_guard<std::mutex> lock(tileMutex);
+    for (irr::u32 i = 0; i<n; i++) {
+        irr::u32 tileX;
+        irr::u32 tileZ;
+        if (heights[i] == -FLT_MAX && findTile(x[i],z[i],tileX,tileZ)) {
+            const TerrainTile& tile = tiles[tileX*tilesZ + tileZ];
+            if (tile.state == TILE_LOADED) {
+                heights[i] = getTileHeight((const irr::f32*)tile.heightMap->getData(),getTilePosition(tileX,tileZ),x[i],z[i]);
+            }
+        }
+    }
+}
+
+void TerrainTileManager::moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ)
+{
+    {
+        std::lock_guard<std::mutex> lock(tileMutex);
+        position += irr::core::vector3df(deltaX,deltaY,deltaZ);
+    }
+
+    for (irr::u32 tileX = 0; tileX<tilesX; tileX++) {
+        for (irr::u32 tileZ = 0; tileZ<tilesZ; tileZ++) {
+            irr::scene::ITerrainSceneNode* node = tiles[tileX*tilesZ + tileZ].node;
+            if (node) {
+                node->setPosition(getTilePosition(tileX,tileZ));
+            }
+        }
+    }
+}
+
+irr::u32 TerrainTileManager::getLoadedTileCount() const
+{
+    std::lock_guard<std::mutex> lock(tileMutex);
+    irr::u32 loadedTiles = 0;
+    for (unsigned int i = 0; i<tiles.size(); i++) {
+        if (tiles.at(i).state == TILE_LOADED) {
+            loadedTiles++;
+        }
+    }
+    return loadedTiles;
+}
+
+irr::u32 TerrainTileManager::getTileGeneration() const
+{
+    std::lock_guard<std::mutex> lock(tileMutex);
+    return tileGeneration;
+}
+
+std::string TerrainTileManager::getTilePath(irr::u32 tileX, irr::u32 tileZ, const std::string& extension) const
+{
+    std::string tilePath = tileDirectory;
+    tilePath.append("/tile_");
+    tilePath.append(Utilities::lexical_cast<std::string>(tileX));
+    tilePath.append("_");
+    tilePath.append(Utilities::lexical_cast<std::string>(tileZ));
+    tilePath.append(extension);
+    return tilePath;
+}
+
+irr::core::vector3df TerrainTileManager::getTilePosition(irr::u32 tileX, irr::u32 tileZ) const
+{
+    return position + irr::core::vector3df(tileX*tileXWidth, 0, tileZ*tileZWidth);
+}
+
+bool TerrainTileManager::findTile(irr::f32 x, irr::f32 z, irr::u32& tileX, irr::u32& tileZ) const
+{
+    irr::s32 foundX = irr::core::floor32((x - position.X) / tileXWidth);
+    irr::s32 foundZ = irr::core::floor32((z - position.Z) / tileZWidth);
+    if (foundX < 0 || foundZ < 0 || foundX >= (irr::s32)tilesX || foundZ >= (irr::s32)tilesZ) {
+        return false;
+    }
+    tileX = foundX;
+    tileZ = foundZ;
+    return true;
+}
+
+irr::f32 TerrainTileManager::getTileHeight(const irr::f32* heights, irr::core::vector3df tilePosition, irr::f32 x, irr::f32 z) const
+{
+    irr::f32 posX = (x - tilePosition.X) / (tileXWidth/(tileSize-1));
+    irr::f32 posZ = (z - tilePosition.Z) / (tileZWidth/(tileSize-1));
+
+    //findTile() chose this tile, so only rounding can put the point outside it
+    irr::s32 X = irr::core::clamp(irr::core::floor32(posX),0,tileSize-2);
+    irr::s32 Z = irr::core::clamp(irr::core::floor32(posZ),0,tileSize-2);
+
+    irr::f32 a = heights[X * tileSize + Z];
+    irr::f32 b = heights[(X + 1) * tileSize + Z];
+    irr::f32 c = heights[X * tileSize + (Z + 1)];
+    irr::f32 d = heights[(X + 1) * tileSize + (Z + 1)];
+
+    return triangleHeight(a,b,c,d,posX - X,posZ - Z) + tilePosition.Y;
+}
+
+irr::f32 TerrainTileManager::readTileHeight(irr::u32 tileX, irr::u32 tileZ, irr::core::vector3df tilePosition, irr::f32 x, irr::f32 z) const
+{
+    irr::f32 posX = (x - tilePosition.X) / (tileXWidth/(tileSize-1));
+    irr::f32 posZ = (z - tilePosition.Z) / (tileZWidth/(tileSize-1));
+    irr::s32 X = irr::core::clamp(irr::core::floor32(posX),0,tileSize-2);
+    irr::s32 Z = irr::core::clamp(irr::core::floor32(posZ),0,tileSize-2);
+
+    std::ifstream tileFile(getTilePath(tileX,tileZ,".f32").c_str(), std::ios::in | std::ios::binary);
+    irr::f32 ac[2]; //Heights at (X,Z) and (X,Z+1), next to each other in the file
+    irr::f32 bd[2]; //(X+1,Z) and (X+1,Z+1)
+    tileFile.seekg((X * tileSize + Z) * sizeof(irr::f32));
+    tileFile.read((char*)ac, sizeof(ac));
+    tileFile.seekg(((X + 1) * tileSize + Z) * sizeof(irr::f32));
+    tileFile.read((char*)bd, sizeof(bd));
+    if (!tileFile) {
+        return -FLT_MAX;
+    }
+
+    return triangleHeight(ac[0],bd[0],ac[1],bd[1],posX - X,posZ - Z) + tilePosition.Y;
+}
+
+void TerrainTileManager::makeNode(irr::u32 tileIndex)
+{
+    irr::u32 tileX = tileIndex / tilesZ;
+    irr::u32 tileZ = tileIndex % tilesZ;
+    TerrainTile& tile = tiles[tileIndex];
+    irr::video::IVideoDriver* driver = smgr->getVideoDriver();
+
+    //Build the node straight from the mapped file, with heights in metres, as for a single .f32 heightmap
+    irr::core::vector3df tileScale(tileXWidth/(tileSize-1),1.0f,tileZWidth/(tileSize-1));
+    tile.node = smgr->addTerrainSceneNode("",0,-1,getTilePosition(tileX,tileZ),irr::core::vector3df(0.f, 0.f, 0.f),tileScale,irr::video::SColor(255,255,255,255),5,irr::scene::ETPS_17,0,true);
+    irr::io::IReadFile* heightMapFile = smgr->getFileSystem()->createMemoryReadFile(tile.heightMap->getData(),tileSize*tileSize*sizeof(irr::f32),getTilePath(tileX,tileZ,".f32").c_str(),false);
+
+    bool loaded = false;
+    if (tile.node && heightMapFile) {
+        loaded = tile.node->loadHeightMapRAW(heightMapFile,32,true,true);
+    }
+    if (heightMapFile) {
+        heightMapFile->drop();
+    }
+
+    if (!loaded) {
+        std::cerr << "Could not load terrain tile " << getTilePath(tileX,tileZ,".f32") << std::endl;
+        unloadTile(tileIndex);
+        std::lock_guard<std::mutex> lock(tileMutex);
+        tile.state = TILE_FAILED; //Don't keep trying while it is in range
+        return;
+    }
+
+    tile.node->setMaterialFlag(irr::video::EMF_FOG_ENABLE, true);
+    tile.node->setMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, true); //Normalise normals on scaled meshes, for correct lighting
+
+    //Use the tile's own texture if it has one, otherwise the terrain's texture
+    const char* textureExtensions[] = {".png", ".jpg", ".bmp"};
+    for (unsigned int i = 0; i<3 && tile.texture==0; i++) {
+        std::string texturePath = getTilePath(tileX,tileZ,textureExtensions[i]);
+        if (Utilities::pathExists(texturePath)) {
+            tile.texture = driver->getTexture(texturePath.c_str());
+        }
+    }
+    if (tile.texture) {
+        tile.node->setMaterialTexture(0, tile.texture);
+    } else if (!defaultTexturePath.empty()) {
+        tile.node->setMaterialTexture(0, driver->getTexture(defaultTexturePath.c_str()));
+    }
+}
+
+void TerrainTileManager::unloadTile(irr::u32 tileIndex)
+{
+    TerrainTile& tile = tiles[tileIndex];
+
+    MappedFile* heightMap = 0;
+    {
+        std::lock_guard<std::mutex> lock(tileMutex);
+        if (tile.state == TILE_LOADED) {
+            tileGeneration++;
+        }
+        heightMap = tile.heightMap;
+        tile.heightMap = 0;
+        tile.state = TILE_UNLOADED;
+        requestedTiles.erase(std::remove(requestedTiles.begin(),requestedTiles.end(),tileIndex),requestedTiles.end());
+    }
+    delete heightMap;
+
+    if (tile.node) {
+        tile.node->remove();
+        tile.node = 0;
+    }
+    if (tile.texture) {
+        smgr->getVideoDriver()->removeTexture(tile.texture);
+        tile.texture = 0;
+    }
+}
+
+void TerrainTileManager::loaderThreadLoop()
+{
+    while (true) {
+        irr::u32 tileIndex;
+        {
+            std::unique_lock<std::mutex> lock(tileMutex);
+            requestCondition.wait(lock, [this]{return loaderStopRequested || !requestedTiles.empty();});
+            if (loaderStopRequested) {
+                return;
+            }
+            tileIndex = requestedTiles.front();
+            requestedTiles.pop_front();
+            if (tiles[tileIndex].state != TILE_REQUESTED) {
+                continue; //Unloaded again before it was loaded
+            }
+        }
+
+        std::string tilePath = getTilePath(tileIndex / tilesZ, tileIndex % tilesZ, ".f32");
+        MappedFile* heightMap = new MappedFile();
+        bool loaded = heightMap->open(tilePath) && heightMap->getSize() >= tileSize*tileSize*sizeof(irr::f32);
+        if (loaded) {
+            //Read every page now, so the main thread and radar don't wait for the disk when they first use the tile
+            const volatile char* data = (const volatile char*)heightMap->getData();
+            for (std::size_t i = 0; i<heightMap->getSize(); i += 4096) {
+                data[i];
+            }
+        } else {
+            std::cerr << "Could not load terrain tile " << tilePath << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(tileMutex);
+            TerrainTile& tile = tiles[tileIndex];
+            if (tile.state == TILE_REQUESTED) {
+                tile.state = loaded ? TILE_LOADED : TILE_FAILED;
+                if (loaded) {
+                    tile.heightMap = heightMap;
+                    heightMap = 0;
+                    tileGeneration++;
+                }
+            }
+        }
+        delete heightMap; //Only if not used
+        loadedCondition.notify_all();
+    }
+}
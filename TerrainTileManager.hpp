@@ -0,0 +1,94 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __TERRAINTILEMANAGER_HPP_INCLUDED__
+#define __TERRAINTILEMANAGER_HPP_INCLUDED__
+
+#include "irrlicht.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class MappedFile;
+
+//A terrain area split into a grid of tiles, each a binary heightmap tile_<x>_<z>.f32 in the tile directory (heights in metres,
+//[x*size + z], as for a single .f32 heightmap). Tile 0_0 is at the south west corner, x increases to the east and z to the north,
+//and neighbouring tiles share their edge points. Only tiles near own ship are kept in memory: a background thread maps the files
+//of tiles that come within range, and update() turns them into terrain scene nodes, and removes tiles that are out of range again.
+class TerrainTileManager
+{
+    public:
+        TerrainTileManager();
+        ~TerrainTileManager();
+        bool load(const std::string& tileDirectory, const std::string& defaultTexturePath, irr::u32 tilesX, irr::u32 tilesZ, irr::u32 tileHeightMapSize,
+                  irr::f32 tileXWidth, irr::f32 tileZWidth, irr::f32 loadRadius, irr::core::vector3df position, irr::scene::ISceneManager* smgr);
+        void update(irr::core::vector3df centre, bool waitForTiles=false); //Call from the main thread. If waitForTiles is true, blocks until all tiles in range are loaded.
+        irr::f32 getHeight(irr::f32 x, irr::f32 z) const; //-FLT_MAX if outside the tiled area. Reads from the tile's file if it isn't loaded.
+        void getHeights(const irr::f32* x, const irr::f32* z, irr::f32* heights, irr::u32 n) const; //Fills in heights[i] that are -FLT_MAX from the loaded tiles only
+        void moveNode(irr::f32 deltaX, irr::f32 deltaY, irr::f32 deltaZ);
+        irr::u32 getLoadedTileCount() const;
+        irr::u32 getTileGeneration() const; //Changes whenever a tile's heights become available or are removed
+
+    private:
+        enum TileState {TILE_UNLOADED, TILE_REQUESTED, TILE_LOADED, TILE_FAILED};
+
+        struct TerrainTile {
+            TileState state;
+            MappedFile* heightMap; //Set by the loader thread, valid when state is TILE_LOADED
+            irr::scene::ITerrainSceneNode* node; //Made on the main thread after loading
+            irr::video::ITexture* texture; //Tile's own texture, if it has one
+        };
+
+        TerrainTileManager(const TerrainTileManager&); //Not copyable
+        TerrainTileManager& operator=(const TerrainTileManager&);
+
+        std::string getTilePath(irr::u32 tileX, irr::u32 tileZ, const std::string& extension) const;
+        irr::core::vector3df getTilePosition(irr::u32 tileX, irr::u32 tileZ) const; //Call with tileMutex held, or from the main thread
+        bool findTile(irr::f32 x, irr::f32 z, irr::u32& tileX, irr::u32& tileZ) const; //Call with tileMutex held, or from the main thread
+        irr::f32 getTileHeight(const irr::f32* heights, irr::core::vector3df tilePosition, irr::f32 x, irr::f32 z) const;
+        irr::f32 readTileHeight(irr::u32 tileX, irr::u32 tileZ, irr::core::vector3df tilePosition, irr::f32 x, irr::f32 z) const; //Reads just the points needed from the file
+        void makeNode(irr::u32 tileIndex);
+        void unloadTile(irr::u32 tileIndex);
+        void loaderThreadLoop();
+
+        irr::scene::ISceneManager* smgr;
+        std::string tileDirectory;
+        std::string defaultTexturePath;
+        irr::u32 tilesX;
+        irr::u32 tilesZ;
+        irr::s32 tileSize; //Points along each side of a tile
+        irr::f32 tileXWidth; //m
+        irr::f32 tileZWidth; //m
+        irr::f32 loadRadius; //Tiles closer than this to own ship are loaded (m)
+        irr::f32 unloadRadius; //Tiles further than this are unloaded (m)
+
+        //Shared with the loader thread and any thread calling getHeight()/getHeights(): only changed with tileMutex held
+        mutable std::mutex tileMutex;
+        std::condition_variable requestCondition; //Signalled when a tile is requested, or the loader should stop
+        std::condition_variable loadedCondition; //Signalled when a tile has finished loading
+        std::vector<TerrainTile> tiles; //[tileX*tilesZ + tileZ]
+        std::deque<irr::u32> requestedTiles; //Nearest first
+        irr::core::vector3df position; //Position of the south west corner of tile 0_0
+        irr::u32 tileGeneration; //Counts tiles loaded and unloaded
+        bool loaderStopRequested;
+        std::thread loaderThread;
+};
+
+#endif
@@ -15,7 +15,7 @@
      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
 
 #include "Tide.hpp"
-#include "IniFile.hpp"
+#include "WorldPack.hpp"
 #include "Utilities.hpp"
 #include "Constants.hpp"
 
@@ -35,58 +35,45 @@ Tide::~Tide()
 }
 
 void Tide::load(const std::string& worldName) {
+    //load tide.ini and tidalstream.ini information
+    WorldPack worldData;
+    worldData.readTideIni(worldName);
+    load(worldData.tide);
+}
+
+void Tide::load(const WorldPackTide& tideData) {
 
     //Initialise
     tideHeight = 0;
 
-    //load tide.ini information
-    std::string tideFilename = worldName;
-    tideFilename.append("/tide.ini");
-
-    irr::u32 numberOfHarmonics = IniFile::iniFileTou32(tideFilename,"Harmonics");
-
-    //If numberOfHarmonics = 0, we either have no tide file, or just a constant component. In either case, load
-    //the constant component. Amplitude will be zero if no tide file
-    //No tidal information, so load a dummy record
-    tidalHarmonic constantHarmonic;
-    constantHarmonic.amplitude = IniFile::iniFileTof32(tideFilename,"Amplitude(0)");
-    constantHarmonic.offset = 0;
-    constantHarmonic.speed = 0;
-    tidalHarmonics.push_back(constantHarmonic);
-
-    //Load other components
+    //The constant component is always the first, with amplitude zero if no tide file
     tidalHarmonic loadingHarmonic;
-    for(irr::u32 i=1;i<=numberOfHarmonics; i++) {
-        loadingHarmonic.amplitude = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Amplitude",i));
-        loadingHarmonic.offset = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Offset",i));
-        loadingHarmonic.speed = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Speed",i));
+    for(irr::u32 i=0;i<tideData.harmonics.size(); i++) {
+        loadingHarmonic.amplitude = tideData.harmonics.at(i).amplitude;
+        loadingHarmonic.offset = tideData.harmonics.at(i).offset;
+        loadingHarmonic.speed = tideData.harmonics.at(i).speed;
         tidalHarmonics.push_back(loadingHarmonic);
     }
 
-    std::string tidalStreamFilename = worldName;
-    tidalStreamFilename.append("/tidalstream.ini");
-    meanRangeSprings = IniFile::iniFileTof32(tidalStreamFilename,"MeanRangeSprings");
-    meanRangeNeaps = IniFile::iniFileTof32(tidalStreamFilename,"MeanRangeNeaps");
-    irr::u32 numberOfDiamonds = IniFile::iniFileTou32(tidalStreamFilename,"Number");
+    meanRangeSprings = tideData.meanRangeSprings;
+    meanRangeNeaps = tideData.meanRangeNeaps;
 
-    //Load other components
+    //Load tidal diamonds
     tidalDiamond loadingDiamond;
-    for(irr::u32 i=1;i<=numberOfDiamonds; i++) {
-        loadingDiamond.longitude =  IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate1("Long",i));
-        loadingDiamond.latitude =  IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate1("Lat",i));
+    for(irr::u32 i=0;i<tideData.diamonds.size(); i++) {
+        const WorldPackTidalDiamond& diamondData = tideData.diamonds.at(i);
+        loadingDiamond.longitude = diamondData.longitude;
+        loadingDiamond.latitude = diamondData.latitude;
 
-        //Load and convert SpeedN, SpeedS and Direction into speedXNeaps, speedXSprings etc in m/s for each hour between 6 before to 6 after high tide
+        //Convert SpeedN, SpeedS and Direction into speedXNeaps, speedXSprings etc in m/s for each hour between 6 before to 6 after high tide
         for(int j = 0; j<13; j++) {
-            int hour = j-6;
-            irr::f32 speedNeaps = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("SpeedN",i,hour));
-            irr::f32 speedSprings = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("SpeedS",i,hour));
-            irr::f32 streamDirection = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("Direction",i,hour));
-            loadingDiamond.speedXSprings[i] = sin(streamDirection*irr::core::DEGTORAD)*speedSprings*KTS_TO_MPS;
-            loadingDiamond.speedZSprings[i] = cos(streamDirection*irr::core::DEGTORAD)*speedSprings*KTS_TO_MPS;
-            loadingDiamond.speedXNeaps[i] = sin(streamDirection*irr::core::DEGTORAD)*speedNeaps*KTS_TO_MPS;
-            loadingDiamond.speedZNeaps[i] = cos(streamDirection*irr::core::DEGTORAD)*speedNeaps*KTS_TO_MPS;
-            //std::cout << "Loading hour " << hour << " where direction is " << streamDirection << std::endl;
-            //std::cout << "Loading from: " << IniFile::enumerate2("Direction",i,hour) << std::endl;
+            irr::f32 speedNeaps = diamondData.speedNeaps[j];
+            irr::f32 speedSprings = diamondData.speedSprings[j];
+            irr::f32 streamDirection = diamondData.direction[j];
+            loadingDiamond.speedXSprings[j] = sin(streamDirection*irr::core::DEGTORAD)*speedSprings*KTS_TO_MPS;
+            loadingDiamond.speedZSprings[j] = cos(streamDirection*irr::core::DEGTORAD)*speedSprings*KTS_TO_MPS;
+            loadingDiamond.speedXNeaps[j] = sin(streamDirection*irr::core::DEGTORAD)*speedNeaps*KTS_TO_MPS;
+            loadingDiamond.speedZNeaps[j] = cos(streamDirection*irr::core::DEGTORAD)*speedNeaps*KTS_TO_MPS;
         }
 
         tidalDiamonds.push_back(loadingDiamond);
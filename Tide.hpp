@@ -23,6 +23,8 @@
 #include <string>
 #include <stdint.h> //for uint64_t
 
+struct WorldPackTide;
+
 class Tide {
 
 struct tidalHarmonic {
@@ -57,6 +59,7 @@ public:
     Tide();
     virtual ~Tide();
     void load(const std::string& worldName);
+    void load(const WorldPackTide& tideData);
     void update(uint64_t absoluteTime);
     irr::f32 getTideHeight() const; //To be called after update(time)
     irr::core::vector2df getTidalStream(irr::f32 longitude, irr::f32 latitude, uint64_t absoluteTime) const; //Does not need update() to be called before this
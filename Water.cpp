@@ -80,6 +80,11 @@ irr::core::vector2df Water::getLocalNormals(irr::f32 relPosX, irr::f32 relPosZ)
     return waterNode->getLocalNormals(relPosX,relPosZ);
 }
 
+void Water::getWaveHeightsAndNormals(const irr::f32* relPosX, const irr::f32* relPosZ, irr::f32* heights, irr::core::vector2df* normals, irr::u32 n) const
+{
+    waterNode->getWaveHeightsAndNormals(relPosX,relPosZ,heights,normals,n);
+}
+
 
 irr::core::vector3df Water::getPosition() const
 {
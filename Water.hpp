@@ -29,6 +29,7 @@ class Water
         void update(irr::f32 tideHeight, irr::core::vector3df viewPosition, irr::u32 lightLevel, irr::f32 weather);
         irr::f32 getWaveHeight(irr::f32 relPosX, irr::f32 relPosZ) const;
         irr::core::vector2df getLocalNormals(irr::f32 relPosX, irr::f32 relPosZ) const;
+        void getWaveHeightsAndNormals(const irr::f32* relPosX, const irr::f32* relPosZ, irr::f32* heights, irr::core::vector2df* normals, irr::u32 n) const; //For n points at once, normals can be 0 if not needed
         irr::core::vector3df getPosition() const;
         void setVisible(bool visible);
 
@@ -0,0 +1,726 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "WorldPack.hpp"
+
+#include "IniFile.hpp"
+#include "Constants.hpp"
+#include "Utilities.hpp"
+#include "MappedFile.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio> //For std::rename and std::remove
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <sys/stat.h>
+
+//using namespace irr;
+
+namespace
+{
+    //Pack layout: header (magic, version, byte order mark), source file list, then terrains, buoys, lights, land objects and
+    //tide. All values are 4 bytes, in the byte order of the machine that compiled the pack, and strings are a length followed by
+    //the characters, padded to 4 bytes, so everything stays aligned for use straight from the mapped file.
+    const char packMagic[8] = {'B','C','W','P','A','C','K','\0'};
+    const irr::u32 packVersion = 1; //Increase whenever the layout changes
+    const irr::u32 packByteOrderMark = 0x01020304;
+
+    bool getModificationTime(const std::string& path, time_t& modificationTime)
+    {
+        struct stat fileStatus;
+        if (stat(path.c_str(), &fileStatus) != 0) {
+            return false;
+        }
+        modificationTime = fileStatus.st_mtime;
+        return true;
+    }
+
+    bool isBinaryHeightMap(const std::string& heightMapName)
+    {
+        std::string extension = "";
+        if (heightMapName.length() > 3) {
+            extension = heightMapName.substr(heightMapName.length() - 4,4);
+            Utilities::to_lower(extension);
+        }
+        return extension.compare(".f32") == 0;
+    }
+
+    class PackWriter
+    {
+        public:
+            PackWriter(std::ofstream& file) : file(file) {}
+
+            template <typename T> void write(T value)
+            {
+                file.write((const char*)&value, sizeof(T));
+            }
+
+            template <typename T> void writeArray(const T* values, irr::u32 count)
+            {
+                if (count > 0) {
+                    file.write((const char*)values, count*sizeof(T));
+                }
+            }
+
+            void writeString(const std::string& value)
+            {
+                write<irr::u32>(value.length());
+                file.write(value.c_str(), value.length());
+                const char padding[4] = {0,0,0,0};
+                file.write(padding, (4 - value.length()%4)%4);
+            }
+
+        private:
+            std::ofstream& file;
+    };
+
+    //Reads from the mapped pack. After anything is read past the end, ok() returns false and all values read are zero.
+    class PackReader
+    {
+        public:
+            PackReader(const void* data, std::size_t size) : data((const char*)data), size(size), position(0), valid(true) {}
+
+            template <typename T> T read()
+            {
+                T value;
+                const void* source = take(sizeof(T));
+                if (source) {
+                    std::memcpy(&value, source, sizeof(T));
+                } else {
+                    std::memset(&value, 0, sizeof(T));
+                }
+                return value;
+            }
+
+            //Pointer to count values in the pack, or 0 if count is 0 or they go past the end
+            template <typename T> const T* readArray(irr::u32 count)
+            {
+                if (count == 0 || count > (size - position)/sizeof(T)) {
+                    if (count > 0) {
+                        valid = false;
+                    }
+                    return 0;
+                }
+                return (const T*)take(count*sizeof(T));
+            }
+
+            std::string readString()
+            {
+                irr::u32 length = read<irr::u32>();
+                const char* characters = (const char*)take(length);
+                take((4 - length%4)%4);
+                return characters ? std::string(characters, length) : std::string();
+            }
+
+            bool ok() const
+            {
+                return valid;
+            }
+
+        private:
+            const void* take(std::size_t bytes)
+            {
+                if (!valid || bytes > size - position) {
+                    valid = false;
+                    return 0;
+                }
+                const char* taken = data + position;
+                position += bytes;
+                return taken;
+            }
+
+            const char* data;
+            std::size_t size;
+            std::size_t position;
+            bool valid;
+    };
+}
+
+WorldPack::WorldPack()
+{
+    packFile = 0;
+    compiled = false;
+    tide.meanRangeSprings = 0;
+    tide.meanRangeNeaps = 0;
+}
+
+WorldPack::~WorldPack()
+{
+    delete packFile;
+}
+
+std::string WorldPack::getPackPath(const std::string& worldPath)
+{
+    std::string packPath = worldPath;
+    packPath.append("/world.bcpack");
+    return packPath;
+}
+
+void WorldPack::clear()
+{
+    terrains.clear();
+    buoys.clear();
+    lights.clear();
+    landObjects.clear();
+    tide.harmonics.clear();
+    tide.diamonds.clear();
+    tide.meanRangeSprings = 0;
+    tide.meanRangeNeaps = 0;
+    decodedHeights.clear();
+    decodedTextures.clear();
+    delete packFile;
+    packFile = 0;
+    compiled = false;
+}
+
+bool WorldPack::readIni(const std::string& worldPath)
+{
+    clear();
+    bool terrainFound = readTerrainIni(worldPath);
+    readBuoyIni(worldPath);
+    readLightIni(worldPath);
+    readLandObjectIni(worldPath);
+    readTideIni(worldPath);
+    return terrainFound;
+}
+
+bool WorldPack::readTerrainIni(const std::string& worldPath)
+{
+    std::string worldTerrainFile = worldPath;
+    worldTerrainFile.append("/terrain.ini");
+
+    terrains.clear();
+    irr::u32 numberOfTerrains = IniFile::iniFileTou32(worldTerrainFile, "Number");
+    for (irr::u32 i = 1; i<=numberOfTerrains; i++) {
+        WorldPackTerrain terrain;
+        terrain.longitude = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLong",i));
+        terrain.latitude = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLat",i));
+        terrain.longExtent = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLongExtent",i));
+        terrain.latExtent = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainLatExtent",i));
+        terrain.maxHeight = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainMaxHeight",i));
+        terrain.seaMaxDepth = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("SeaMaxDepth",i));
+        terrain.heightMapSize = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TerrainHeightMapSize",i));
+        terrain.heightMapName = IniFile::iniFileToString(worldTerrainFile, IniFile::enumerate1("HeightMap",i));
+        terrain.textureName = IniFile::iniFileToString(worldTerrainFile, IniFile::enumerate1("Texture",i));
+
+        terrain.tileDirectory = IniFile::iniFileToString(worldTerrainFile, IniFile::enumerate1("TileDirectory",i));
+        terrain.tilesX = IniFile::iniFileTou32(worldTerrainFile, IniFile::enumerate1("TilesX",i));
+        terrain.tilesZ = IniFile::iniFileTou32(worldTerrainFile, IniFile::enumerate1("TilesZ",i));
+        terrain.tileHeightMapSize = IniFile::iniFileTou32(worldTerrainFile, IniFile::enumerate1("TileHeightMapSize",i));
+        terrain.tileLoadRadius = IniFile::iniFileTof32(worldTerrainFile, IniFile::enumerate1("TileLoadRadius",i), 12*M_IN_NM);
+
+        terrain.heights = 0;
+        terrain.heightsSize = 0;
+        terrain.texturePixels = 0;
+        terrain.textureWidth = 0;
+        terrain.textureHeight = 0;
+
+        terrains.push_back(terrain);
+    }
+
+    return !terrains.empty();
+}
+
+void WorldPack::readBuoyIni(const std::string& worldPath)
+{
+    std::string buoyFilename = worldPath;
+    buoyFilename.append("/buoy.ini");
+
+    buoys.clear();
+    irr::u32 numberOfBuoys = IniFile::iniFileTou32(buoyFilename,"Number");
+    for (irr::u32 i = 1; i<=numberOfBuoys; i++) {
+        WorldPackBuoy buoy;
+        buoy.type = IniFile::iniFileToString(buoyFilename,IniFile::enumerate1("Type",i));
+        buoy.longitude = IniFile::iniFileTof32(buoyFilename,IniFile::enumerate1("Long",i));
+        buoy.latitude = IniFile::iniFileTof32(buoyFilename,IniFile::enumerate1("Lat",i));
+        buoy.rcs = IniFile::iniFileTof32(buoyFilename,IniFile::enumerate1("RCS",i));
+        buoys.push_back(buoy);
+    }
+}
+
+void WorldPack::readLightIni(const std::string& worldPath)
+{
+    std::string lightFilename = worldPath;
+    lightFilename.append("/light.ini");
+
+    lights.clear();
+    irr::u32 numberOfLights = IniFile::iniFileTou32(lightFilename,"Number");
+    for (irr::u32 i = 1; i<=numberOfLights; i++) {
+        WorldPackLight light;
+        light.buoy = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("Buoy",i));
+        light.longitude = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("Long",i));
+        light.latitude = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("Lat",i));
+        light.height = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("Height",i));
+        light.absolute = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("Absolute",i));
+        light.red = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("Red",i));
+        light.green = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("Green",i));
+        light.blue = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("Blue",i));
+        light.range = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("Range",i));
+        light.sequence = IniFile::iniFileToString(lightFilename,IniFile::enumerate1("Sequence",i));
+        light.phaseStart = IniFile::iniFileTou32(lightFilename,IniFile::enumerate1("PhaseStart",i));
+        light.startAngle = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("StartAngle",i));
+        light.endAngle = IniFile::iniFileTof32(lightFilename,IniFile::enumerate1("EndAngle",i));
+        lights.push_back(light);
+    }
+}
+
+void WorldPack::readLandObjectIni(const std::string& worldPath)
+{
+    std::string landObjectFilename = worldPath;
+    landObjectFilename.append("/landobject.ini");
+
+    landObjects.clear();
+    irr::u32 numberOfObjects = IniFile::iniFileTou32(landObjectFilename,"Number");
+    for (irr::u32 i = 1; i<=numberOfObjects; i++) {
+        WorldPackLandObject landObject;
+        landObject.type = IniFile::iniFileToString(landObjectFilename,IniFile::enumerate1("Type",i));
+        landObject.longitude = IniFile::iniFileTof32(landObjectFilename,IniFile::enumerate1("Long",i));
+        landObject.latitude = IniFile::iniFileTof32(landObjectFilename,IniFile::enumerate1("Lat",i));
+        landObject.heightCorrection = IniFile::iniFileTof32(landObjectFilename,IniFile::enumerate1("HeightCorrection",i));
+        landObject.absolute = IniFile::iniFileTou32(landObjectFilename,IniFile::enumerate1("Absolute",i));
+        landObject.rotation = IniFile::iniFileTof32(landObjectFilename,IniFile::enumerate1("Rotation",i));
+        landObjects.push_back(landObject);
+    }
+}
+
+void WorldPack::readTideIni(const std::string& worldPath)
+{
+    std::string tideFilename = worldPath;
+    tideFilename.append("/tide.ini");
+
+    tide.harmonics.clear();
+
+    //The constant component is always loaded, with amplitude zero if there is no tide file
+    WorldPackTidalHarmonic harmonic;
+    harmonic.amplitude = IniFile::iniFileTof32(tideFilename,"Amplitude(0)");
+    harmonic.offset = 0;
+    harmonic.speed = 0;
+    tide.harmonics.push_back(harmonic);
+
+    irr::u32 numberOfHarmonics = IniFile::iniFileTou32(tideFilename,"Harmonics");
+    for (irr::u32 i = 1; i<=numberOfHarmonics; i++) {
+        harmonic.amplitude = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Amplitude",i));
+        harmonic.offset = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Offset",i));
+        harmonic.speed = IniFile::iniFileTof32(tideFilename,IniFile::enumerate1("Speed",i));
+        tide.harmonics.push_back(harmonic);
+    }
+
+    std::string tidalStreamFilename = worldPath;
+    tidalStreamFilename.append("/tidalstream.ini");
+    tide.meanRangeSprings = IniFile::iniFileTof32(tidalStreamFilename,"MeanRangeSprings");
+    tide.meanRangeNeaps = IniFile::iniFileTof32(tidalStreamFilename,"MeanRangeNeaps");
+
+    tide.diamonds.clear();
+    irr::u32 numberOfDiamonds = IniFile::iniFileTou32(tidalStreamFilename,"Number");
+    for (irr::u32 i = 1; i<=numberOfDiamonds; i++) {
+        WorldPackTidalDiamond diamond;
+        diamond.longitude = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate1("Long",i));
+        diamond.latitude = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate1("Lat",i));
+        for (int j = 0; j<13; j++) {
+            int hour = j-6;
+            diamond.speedNeaps[j] = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("SpeedN",i,hour));
+            diamond.speedSprings[j] = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("SpeedS",i,hour));
+            diamond.direction[j] = IniFile::iniFileTof32(tidalStreamFilename,IniFile::enumerate2("Direction",i,hour));
+        }
+        tide.diamonds.push_back(diamond);
+    }
+}
+
+bool WorldPack::decode(const std::string& worldPath, irr::scene::ISceneManager* smgr)
+{
+    irr::video::IVideoDriver* driver = smgr->getVideoDriver();
+
+    decodedHeights.assign(terrains.size(), std::vector<irr::f32>());
+    decodedTextures.assign(terrains.size(), std::vector<irr::u32>());
+
+    for (unsigned int i = 0; i<terrains.size(); i++) {
+        WorldPackTerrain& terrain = terrains.at(i);
+        if (!terrain.tileDirectory.empty()) {
+            continue; //Tiles are already binary, and are loaded as needed
+        }
+
+        //Load the height map the same way as Terrain::load(), and keep the heights from the mesh
+        std::string heightMapPath = worldPath;
+        heightMapPath.append("/");
+        heightMapPath.append(terrain.heightMapName);
+        bool binaryHeightMap = isBinaryHeightMap(terrain.heightMapName);
+
+        irr::scene::ITerrainSceneNode* terrainNode = smgr->addTerrainSceneNode("",0,-1,irr::core::vector3df(0.f, 0.f, 0.f),irr::core::vector3df(0.f, 0.f, 0.f),irr::core::vector3df(1.f, 1.f, 1.f),irr::video::SColor(255,255,255,255),5,irr::scene::ETPS_17,0,true);
+        irr::io::IReadFile* heightMapFile = smgr->getFileSystem()->createAndOpenFile(heightMapPath.c_str());
+        bool loaded = false;
+        if (terrainNode && heightMapFile) {
+            if (binaryHeightMap) {
+                loaded = terrainNode->loadHeightMapRAW(heightMapFile,32,true,true);
+            } else {
+                loaded = terrainNode->loadHeightMap(heightMapFile);
+            }
+        }
+        if (heightMapFile) {
+            heightMapFile->drop();
+        }
+
+        irr::scene::IMesh* mesh = loaded ? terrainNode->getMesh() : 0;
+        if (mesh == 0 || mesh->getMeshBufferCount() == 0 || mesh->getMeshBuffer(0)->getVertexType() != irr::video::EVT_2TCOORDS) {
+            std::cerr << "Could not load height map " << heightMapPath << std::endl;
+            if (terrainNode) {
+                terrainNode->remove();
+            }
+            return false;
+        }
+
+        irr::scene::IMeshBuffer* meshBuffer = mesh->getMeshBuffer(0);
+        const irr::video::S3DVertex2TCoords* vertices = (const irr::video::S3DVertex2TCoords*)meshBuffer->getVertices();
+        irr::u32 vertexCount = meshBuffer->getVertexCount();
+        std::vector<irr::f32>& heights = decodedHeights.at(i);
+        heights.resize(vertexCount);
+        for (irr::u32 j = 0; j<vertexCount; j++) {
+            heights[j] = vertices[j].Pos.Y;
+        }
+        terrainNode->remove();
+
+        terrain.heightsSize = irr::core::floor32(std::sqrt((irr::f32)vertexCount) + 0.5f);
+        terrain.heights = &heights[0];
+
+        //Decode the texture. Image height maps are loaded rotated 180 degrees compared to loadHeightMapRAW(), which is used for
+        //packed heights, so turn the texture to match.
+        std::string texturePath = worldPath;
+        texturePath.append("/");
+        texturePath.append(terrain.textureName);
+        irr::video::IImage* textureImage = 0;
+        if (!terrain.textureName.empty()) {
+            textureImage = driver->createImageFromFile(texturePath.c_str());
+        }
+        if (textureImage) {
+            irr::core::dimension2d<irr::u32> textureSize = textureImage->getDimension();
+            irr::video::IImage* convertedImage = driver->createImage(irr::video::ECF_A8R8G8B8, textureSize);
+            textureImage->copyTo(convertedImage);
+            textureImage->drop();
+
+            std::vector<irr::u32>& pixels = decodedTextures.at(i);
+            pixels.resize(textureSize.Width*textureSize.Height);
+            const irr::u8* imageData = (const irr::u8*)convertedImage->getData();
+            for (irr::u32 y = 0; y<textureSize.Height; y++) {
+                const irr::u32* row = (const irr::u32*)(imageData + y*convertedImage->getPitch());
+                for (irr::u32 x = 0; x<textureSize.Width; x++) {
+                    if (binaryHeightMap) {
+                        pixels[y*textureSize.Width + x] = row[x];
+                    } else {
+                        pixels[(textureSize.Height-1-y)*textureSize.Width + (textureSize.Width-1-x)] = row[x];
+                    }
+                }
+            }
+            convertedImage->drop();
+
+            terrain.texturePixels = &pixels[0];
+            terrain.textureWidth = textureSize.Width;
+            terrain.textureHeight = textureSize.Height;
+        } else if (!terrain.textureName.empty()) {
+            std::cerr << "Could not load texture " << texturePath << ", so it will be loaded when the world is used" << std::endl;
+        }
+    }
+
+    compiled = true;
+    return true;
+}
+
+std::vector<std::string> WorldPack::getSourceFiles() const
+{
+    std::vector<std::string> sourceFiles;
+    sourceFiles.push_back("terrain.ini");
+    sourceFiles.push_back("buoy.ini");
+    sourceFiles.push_back("light.ini");
+    sourceFiles.push_back("landobject.ini");
+    sourceFiles.push_back("tide.ini");
+    sourceFiles.push_back("tidalstream.ini");
+    for (unsigned int i = 0; i<terrains.size(); i++) {
+        if (terrains.at(i).heights) {
+            sourceFiles.push_back(terrains.at(i).heightMapName);
+        }
+        if (terrains.at(i).texturePixels) {
+            sourceFiles.push_back(terrains.at(i).textureName);
+        }
+    }
+    return sourceFiles;
+}
+
+bool WorldPack::save(const std::string& worldPath) const
+{
+    //Write to a temporary file, so a partly written pack is never left in place
+    std::string packPath = getPackPath(worldPath);
+    std::string temporaryPath = packPath;
+    temporaryPath.append(".tmp");
+
+    {
+        std::ofstream file(temporaryPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        PackWriter writer(file);
+
+        file.write(packMagic, sizeof(packMagic));
+        writer.write<irr::u32>(packVersion);
+        writer.write<irr::u32>(packByteOrderMark);
+
+        std::vector<std::string> sourceFiles = getSourceFiles();
+        writer.write<irr::u32>(sourceFiles.size());
+        for (unsigned int i = 0; i<sourceFiles.size(); i++) {
+            writer.writeString(sourceFiles.at(i));
+        }
+
+        writer.write<irr::u32>(terrains.size());
+        for (unsigned int i = 0; i<terrains.size(); i++) {
+            const WorldPackTerrain& terrain = terrains.at(i);
+            writer.write<irr::f32>(terrain.longitude);
+            writer.write<irr::f32>(terrain.latitude);
+            writer.write<irr::f32>(terrain.longExtent);
+            writer.write<irr::f32>(terrain.latExtent);
+            writer.write<irr::f32>(terrain.maxHeight);
+            writer.write<irr::f32>(terrain.seaMaxDepth);
+            writer.write<irr::f32>(terrain.heightMapSize);
+            writer.writeString(terrain.heightMapName);
+            writer.writeString(terrain.textureName);
+            writer.writeString(terrain.tileDirectory);
+            writer.write<irr::u32>(terrain.tilesX);
+            writer.write<irr::u32>(terrain.tilesZ);
+            writer.write<irr::u32>(terrain.tileHeightMapSize);
+            writer.write<irr::f32>(terrain.tileLoadRadius);
+            irr::u32 heightsSize = terrain.heights ? terrain.heightsSize : 0;
+            writer.write<irr::u32>(heightsSize);
+            writer.writeArray(terrain.heights, heightsSize*heightsSize);
+            irr::u32 textureWidth = terrain.texturePixels ? terrain.textureWidth : 0;
+            irr::u32 textureHeight = terrain.texturePixels ? terrain.textureHeight : 0;
+            writer.write<irr::u32>(textureWidth);
+            writer.write<irr::u32>(textureHeight);
+            writer.writeArray(terrain.texturePixels, textureWidth*textureHeight);
+        }
+
+        writer.write<irr::u32>(buoys.size());
+        for (unsigned int i = 0; i<buoys.size(); i++) {
+            const WorldPackBuoy& buoy = buoys.at(i);
+            writer.writeString(buoy.type);
+            writer.write<irr::f32>(buoy.longitude);
+            writer.write<irr::f32>(buoy.latitude);
+            writer.write<irr::f32>(buoy.rcs);
+        }
+
+        writer.write<irr::u32>(lights.size());
+        for (unsigned int i = 0; i<lights.size(); i++) {
+            const WorldPackLight& light = lights.at(i);
+            writer.write<irr::u32>(light.buoy);
+            writer.write<irr::f32>(light.longitude);
+            writer.write<irr::f32>(light.latitude);
+            writer.write<irr::f32>(light.height);
+            writer.write<irr::u32>(light.absolute);
+            writer.write<irr::u32>(light.red);
+            writer.write<irr::u32>(light.green);
+            writer.write<irr::u32>(light.blue);
+            writer.write<irr::f32>(light.range);
+            writer.writeString(light.sequence);
+            writer.write<irr::u32>(light.phaseStart);
+            writer.write<irr::f32>(light.startAngle);
+            writer.write<irr::f32>(light.endAngle);
+        }
+
+        writer.write<irr::u32>(landObjects.size());
+        for (unsigned int i = 0; i<landObjects.size(); i++) {
+            const WorldPackLandObject& landObject = landObjects.at(i);
+            writer.writeString(landObject.type);
+            writer.write<irr::f32>(landObject.longitude);
+            writer.write<irr::f32>(landObject.latitude);
+            writer.write<irr::f32>(landObject.heightCorrection);
+            writer.write<irr::u32>(landObject.absolute);
+            writer.write<irr::f32>(landObject.rotation);
+        }
+
+        writer.write<irr::u32>(tide.harmonics.size());
+        for (unsigned int i = 0; i<tide.harmonics.size(); i++) {
+            writer.write<irr::f32>(tide.harmonics.at(i).amplitude);
+            writer.write<irr::f32>(tide.harmonics.at(i).offset);
+            writer.write<irr::f32>(tide.harmonics.at(i).speed);
+        }
+        writer.write<irr::f32>(tide.meanRangeSprings);
+        writer.write<irr::f32>(tide.meanRangeNeaps);
+        writer.write<irr::u32>(tide.diamonds.size());
+        for (unsigned int i = 0; i<tide.diamonds.size(); i++) {
+            const WorldPackTidalDiamond& diamond = tide.diamonds.at(i);
+            writer.write<irr::f32>(diamond.longitude);
+            writer.write<irr::f32>(diamond.latitude);
+            writer.writeArray(diamond.speedNeaps, 13);
+            writer.writeArray(diamond.speedSprings, 13);
+            writer.writeArray(diamond.direction, 13);
+        }
+
+        if (!file.good()) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(packPath.c_str()); //rename() won't replace an existing file on Windows
+    return std::rename(temporaryPath.c_str(), packPath.c_str()) == 0;
+}
+
+bool WorldPack::load(const std::string& worldPath)
+{
+    clear();
+
+    std::string packPath = getPackPath(worldPath);
+    time_t packTime;
+    if (!getModificationTime(packPath, packTime)) {
+        return false; //No pack
+    }
+
+    packFile = new MappedFile();
+    if (!packFile->open(packPath)) {
+        clear();
+        return false;
+    }
+    PackReader reader(packFile->getData(), packFile->getSize());
+
+    char magic[sizeof(packMagic)];
+    for (unsigned int i = 0; i<sizeof(packMagic); i++) {
+        magic[i] = reader.read<char>();
+    }
+    if (std::memcmp(magic, packMagic, sizeof(packMagic)) != 0 || reader.read<irr::u32>() != packVersion || reader.read<irr::u32>() != packByteOrderMark) {
+        std::cerr << "World pack " << packPath << " is from a different version of Bridge Command, so is not used" << std::endl;
+        clear();
+        return false;
+    }
+
+    //Only use the pack if nothing it was made from has changed since
+    irr::u32 numberOfSourceFiles = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfSourceFiles && reader.ok(); i++) {
+        std::string sourcePath = worldPath;
+        sourcePath.append("/");
+        sourcePath.append(reader.readString());
+        time_t sourceTime;
+        if (getModificationTime(sourcePath, sourceTime) && sourceTime > packTime) {
+            std::cerr << "World pack " << packPath << " is older than " << sourcePath << ", so is not used" << std::endl;
+            clear();
+            return false;
+        }
+    }
+
+    irr::u32 numberOfTerrains = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfTerrains && reader.ok(); i++) {
+        WorldPackTerrain terrain;
+        terrain.longitude = reader.read<irr::f32>();
+        terrain.latitude = reader.read<irr::f32>();
+        terrain.longExtent = reader.read<irr::f32>();
+        terrain.latExtent = reader.read<irr::f32>();
+        terrain.maxHeight = reader.read<irr::f32>();
+        terrain.seaMaxDepth = reader.read<irr::f32>();
+        terrain.heightMapSize = reader.read<irr::f32>();
+        terrain.heightMapName = reader.readString();
+        terrain.textureName = reader.readString();
+        terrain.tileDirectory = reader.readString();
+        terrain.tilesX = reader.read<irr::u32>();
+        terrain.tilesZ = reader.read<irr::u32>();
+        terrain.tileHeightMapSize = reader.read<irr::u32>();
+        terrain.tileLoadRadius = reader.read<irr::f32>();
+        terrain.heightsSize = reader.read<irr::u32>();
+        terrain.heights = reader.readArray<irr::f32>(terrain.heightsSize*terrain.heightsSize);
+        terrain.textureWidth = reader.read<irr::u32>();
+        terrain.textureHeight = reader.read<irr::u32>();
+        terrain.texturePixels = reader.readArray<irr::u32>(terrain.textureWidth*terrain.textureHeight);
+        terrains.push_back(terrain);
+    }
+
+    irr::u32 numberOfBuoys = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfBuoys && reader.ok(); i++) {
+        WorldPackBuoy buoy;
+        buoy.type = reader.readString();
+        buoy.longitude = reader.read<irr::f32>();
+        buoy.latitude = reader.read<irr::f32>();
+        buoy.rcs = reader.read<irr::f32>();
+        buoys.push_back(buoy);
+    }
+
+    irr::u32 numberOfLights = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfLights && reader.ok(); i++) {
+        WorldPackLight light;
+        light.buoy = reader.read<irr::u32>();
+        light.longitude = reader.read<irr::f32>();
+        light.latitude = reader.read<irr::f32>();
+        light.height = reader.read<irr::f32>();
+        light.absolute = reader.read<irr::u32>();
+        light.red = reader.read<irr::u32>();
+        light.green = reader.read<irr::u32>();
+        light.blue = reader.read<irr::u32>();
+        light.range = reader.read<irr::f32>();
+        light.sequence = reader.readString();
+        light.phaseStart = reader.read<irr::u32>();
+        light.startAngle = reader.read<irr::f32>();
+        light.endAngle = reader.read<irr::f32>();
+        lights.push_back(light);
+    }
+
+    irr::u32 numberOfLandObjects = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfLandObjects && reader.ok(); i++) {
+        WorldPackLandObject landObject;
+        landObject.type = reader.readString();
+        landObject.longitude = reader.read<irr::f32>();
+        landObject.latitude = reader.read<irr::f32>();
+        landObject.heightCorrection = reader.read<irr::f32>();
+        landObject.absolute = reader.read<irr::u32>();
+        landObject.rotation = reader.read<irr::f32>();
+        landObjects.push_back(landObject);
+    }
+
+    irr::u32 numberOfHarmonics = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfHarmonics && reader.ok(); i++) {
+        WorldPackTidalHarmonic harmonic;
+        harmonic.amplitude = reader.read<irr::f32>();
+        harmonic.offset = reader.read<irr::f32>();
+        harmonic.speed = reader.read<irr::f32>();
+        tide.harmonics.push_back(harmonic);
+    }
+    tide.meanRangeSprings = reader.read<irr::f32>();
+    tide.meanRangeNeaps = reader.read<irr::f32>();
+    irr::u32 numberOfDiamonds = reader.read<irr::u32>();
+    for (irr::u32 i = 0; i<numberOfDiamonds && reader.ok(); i++) {
+        WorldPackTidalDiamond diamond;
+        diamond.longitude = reader.read<irr::f32>();
+        diamond.latitude = reader.read<irr::f32>();
+        for (int j = 0; j<13; j++) {
+            diamond.speedNeaps[j] = reader.read<irr::f32>();
+        }
+        for (int j = 0; j<13; j++) {
+            diamond.speedSprings[j] = reader.read<irr::f32>();
+        }
+        for (int j = 0; j<13; j++) {
+            diamond.direction[j] = reader.read<irr::f32>();
+        }
+        tide.diamonds.push_back(diamond);
+    }
+
+    if (!reader.ok() || terrains.empty()) {
+        std::cerr << "World pack " << packPath << " is damaged, so is not used" << std::endl;
+        clear();
+        return false;
+    }
+
+    compiled = true;
+    return true;
+}
+
+bool WorldPack::isCompiled() const
+{
+    return compiled;
+}
@@ -0,0 +1,157 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __WORLDPACK_HPP_INCLUDED__
+#define __WORLDPACK_HPP_INCLUDED__
+
+#include "irrlicht.h"
+
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+//One terrain from terrain.ini, with its height map and texture already decoded if from a compiled world pack
+struct WorldPackTerrain {
+    irr::f32 longitude;
+    irr::f32 latitude;
+    irr::f32 longExtent;
+    irr::f32 latExtent;
+    irr::f32 maxHeight;
+    irr::f32 seaMaxDepth;
+    irr::f32 heightMapSize;
+    std::string heightMapName;
+    std::string textureName;
+
+    //Tiled terrain, if tileDirectory is set
+    std::string tileDirectory;
+    irr::u32 tilesX;
+    irr::u32 tilesZ;
+    irr::u32 tileHeightMapSize;
+    irr::f32 tileLoadRadius; //m
+
+    //Decoded data, 0 if not compiled
+    const irr::f32* heights; //As in the terrain scene node's mesh, [x*heightsSize + z]
+    irr::u32 heightsSize; //Points along each side
+    const irr::u32* texturePixels; //A8R8G8B8, turned to match a mesh loaded from heights with loadHeightMapRAW()
+    irr::u32 textureWidth;
+    irr::u32 textureHeight;
+};
+
+//One buoy from buoy.ini
+struct WorldPackBuoy {
+    std::string type;
+    irr::f32 longitude;
+    irr::f32 latitude;
+    irr::f32 rcs;
+};
+
+//One light from light.ini
+struct WorldPackLight {
+    irr::u32 buoy; //Buoy number (from 1) the light is on, or 0 for a land light
+    irr::f32 longitude;
+    irr::f32 latitude;
+    irr::f32 height;
+    irr::u32 absolute; //1 if height is above chart datum, otherwise above the terrain
+    irr::u32 red;
+    irr::u32 green;
+    irr::u32 blue;
+    irr::f32 range; //Nm
+    std::string sequence;
+    irr::u32 phaseStart;
+    irr::f32 startAngle;
+    irr::f32 endAngle;
+};
+
+//One land object from landobject.ini
+struct WorldPackLandObject {
+    std::string type;
+    irr::f32 longitude;
+    irr::f32 latitude;
+    irr::f32 heightCorrection;
+    irr::u32 absolute; //1 if heightCorrection is above chart datum, otherwise above the terrain
+    irr::f32 rotation;
+};
+
+//Tidal harmonics from tide.ini and tidal diamonds from tidalstream.ini
+struct WorldPackTidalHarmonic {
+    irr::f32 amplitude; //Metres
+    irr::f32 offset; //Degrees
+    irr::f32 speed; //Degrees per hour
+};
+
+struct WorldPackTidalDiamond {
+    irr::f32 longitude;
+    irr::f32 latitude;
+    irr::f32 speedNeaps[13]; //Kts, for each hour from 6 hours before to 6 hours after high tide
+    irr::f32 speedSprings[13];
+    irr::f32 direction[13]; //Deg
+};
+
+struct WorldPackTide {
+    std::vector<WorldPackTidalHarmonic> harmonics; //The first is the constant component (speed and offset 0)
+    irr::f32 meanRangeSprings;
+    irr::f32 meanRangeNeaps;
+    std::vector<WorldPackTidalDiamond> diamonds;
+};
+
+//Everything loaded from a world model's ini files, either read from the ini files, or from a compiled world pack (world.bcpack
+//in the world model folder, made by bridgecommand-wc). A compiled pack also has the height maps and textures decoded, and is
+//memory mapped, so these are used directly from the file. Anything loaded from a compiled pack must be finished with before the
+//WorldPack is destroyed.
+class WorldPack
+{
+    public:
+        WorldPack();
+        ~WorldPack();
+
+        static std::string getPackPath(const std::string& worldPath);
+
+        //Read from the ini files
+        bool readIni(const std::string& worldPath); //All of the below. Returns false if terrain.ini has no terrains.
+        bool readTerrainIni(const std::string& worldPath);
+        void readBuoyIni(const std::string& worldPath);
+        void readLightIni(const std::string& worldPath);
+        void readLandObjectIni(const std::string& worldPath);
+        void readTideIni(const std::string& worldPath);
+
+        //Compiled pack. load() returns false, and leaves the WorldPack empty, if there is no pack, it is from a different version,
+        //or any of the world files have been changed since it was compiled.
+        bool load(const std::string& worldPath);
+        bool decode(const std::string& worldPath, irr::scene::ISceneManager* smgr); //After readIni(), decode the height maps and textures
+        bool save(const std::string& worldPath) const; //Writes the pack for the world
+        bool isCompiled() const; //True if loaded from a pack, or decoded
+
+        std::vector<WorldPackTerrain> terrains;
+        std::vector<WorldPackBuoy> buoys;
+        std::vector<WorldPackLight> lights;
+        std::vector<WorldPackLandObject> landObjects;
+        WorldPackTide tide;
+
+    private:
+        WorldPack(const WorldPack&); //Not copyable, as terrains can point into packFile or decodedHeights
+        WorldPack& operator=(const WorldPack&);
+
+        void clear();
+        std::vector<std::string> getSourceFiles() const; //Files in the world folder the pack is made from
+
+        MappedFile* packFile;
+        std::vector<std::vector<irr::f32> > decodedHeights; //Used when decoded rather than loaded, same order as terrains
+        std::vector<std::vector<irr::u32> > decodedTextures;
+        bool compiled;
+};
+
+#endif
@@ -162,6 +162,9 @@ int main()
 	if (directX == 1) {
 		disableShaders = 1; //FIXME: Hardcoded for no directX shaders
 	}
+	irr::u32 radarThread = IniFile::iniFileTou32(iniFilename, "radar_thread"); // 0 for normal, 1 to calculate the radar picture on a background thread
+	irr::f32 simulationRate = IniFile::iniFileTof32(iniFilename, "simulation_rate"); // Ship dynamics steps per second, 0 for the default
+	irr::u32 impostorSize = IniFile::iniFileTou32(iniFilename, "impostor_size", DEFAULT_IMPOSTOR_SIZE); // Ships and buoys smaller than this on screen (pixels) are drawn as impostors, 0 to always draw them in full
     //Initial view configuration
     irr::f32 viewAngle = IniFile::iniFileTof32(iniFilename, "view_angle"); //Horizontal field of view
     irr::f32 lookAngle = IniFile::iniFileTof32(iniFilename, "look_angle"); //Initial look angle
@@ -525,7 +528,7 @@ int main()
 
 
     //Create simulation model
-    SimulationModel model(device, smgr, &guiMain, &sound, scenarioData, mode, viewAngle, lookAngle, cameraMinDistance, cameraMaxDistance, disableShaders);
+    SimulationModel model(device, smgr, &guiMain, &sound, scenarioData, mode, viewAngle, lookAngle, cameraMinDistance, cameraMaxDistance, disableShaders, radarThread, simulationRate, impostorSize);
 
     //Load the gui
     bool hideEngineAndRudder=false;
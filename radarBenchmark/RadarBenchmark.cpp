@@ -0,0 +1,161 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "RadarBenchmark.hpp"
+#include "SyntheticWorld.hpp"
+
+#include "../RadarCalculation.hpp"
+#include "../Terrain.hpp"
+#include "../OtherShips.hpp"
+#include "../Buoys.hpp"
+#include "../Constants.hpp"
+
+#include <chrono>
+#include <vector>
+
+//using namespace irr;
+
+namespace
+{
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    irr::f64 secondsSince(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<irr::f64>(BenchmarkClock::now() - start).count();
+    }
+}
+
+RadarBenchmark::RadarBenchmark(irr::IrrlichtDevice* dev)
+{
+    device = dev;
+}
+
+RadarBenchmarkResult RadarBenchmark::run(const RadarBenchmarkSettings& settings)
+{
+    const irr::f32 FRAME_TIME = 1.0/60.0; //Simulated time step per update (s)
+
+    //World covering the radar range, with all contacts inside it
+    irr::f32 rangeMetres = settings.rangeNm * M_IN_NM;
+    SyntheticWorld::generate(settings.ships, settings.buoys, rangeMetres, settings.terrain, settings.seed);
+
+    Terrain terrain;
+    OtherShips otherShips;
+    Buoys buoys;
+
+    //Load noise and colour settings, then use the single range and number of spokes being benchmarked
+    RadarCalculation radar;
+    radar.load(settings.radarConfigFile, device);
+    radar.setRangeNm(settings.rangeNm);
+    radar.setNumberOfSpokes(settings.spokes);
+    radar.setNoiseSeed(settings.seed);
+    radar.setArpaOn(settings.arpa);
+    radar.setRadarDisplayRadius(settings.radiusPx);
+    if (settings.displayMode == 1) {
+        radar.setCourseUp();
+    } else if (settings.displayMode == 2) {
+        radar.setHeadUp();
+    } else {
+        radar.setNorthUp();
+    }
+
+    irr::video::IVideoDriver* driver = device->getVideoDriver();
+    irr::core::dimension2d<irr::u32> imageSize(2*settings.radiusPx, 2*settings.radiusPx);
+    irr::video::IImage* radarImage = driver->createImage(irr::video::ECF_A8R8G8B8, imageSize);
+    irr::video::IImage* radarImageOverlaid = driver->createImage(irr::video::ECF_A8R8G8B8, imageSize);
+
+    irr::f64 simulationTime = 1000; //Start away from zero, so ARPA time differences are all positive
+    irr::f64 scanTime = 0;
+    irr::f64 arpaTime = 0;
+    irr::f64 renderTime = 0;
+    irr::f64 frameTime = 0;
+    irr::u64 spokesScanned = 0;
+    irr::u64 frames = 0;
+    irr::u64 terrainQueriesAtStart = 0;
+
+    //One untimed revolution first, to fill the terrain profiles, ARPA tracks and render tables, then the timed revolutions
+    irr::u64 warmupSpokes = settings.spokes;
+    irr::u64 totalSpokes = warmupSpokes + (irr::u64)settings.sweeps * settings.spokes;
+    irr::u64 spokesDone = 0;
+    bool timing = false;
+
+    while (spokesDone < totalSpokes) {
+        if (!timing && spokesDone >= warmupSpokes) {
+            timing = true;
+            terrainQueriesAtStart = SyntheticWorld::getTerrainQueries();
+        }
+
+        BenchmarkClock::time_point frameStart = BenchmarkClock::now();
+
+        SyntheticWorld::advance(FRAME_TIME);
+        simulationTime += FRAME_TIME;
+
+        //Same input as RadarCalculation::update() builds
+        RadarScanInput input;
+        input.position = SyntheticWorld::getOwnShipPosition();
+        input.offsetPosition = irr::core::vector3d<int64_t>(0,0,0);
+        input.heading = SyntheticWorld::getOwnShipHeading();
+        input.speed = SyntheticWorld::getOwnShipSpeed();
+        input.weather = 3;
+        input.rain = 2;
+        input.tideHeight = 0;
+        input.absoluteTime = (uint64_t)simulationTime;
+        input.terrain = &terrain;
+        for (irr::u32 contactID=1; contactID<=otherShips.getNumber(); contactID++) {
+            input.radarData.push_back(otherShips.getRadarData(contactID,input.position));
+        }
+        for (irr::u32 contactID=1; contactID<=buoys.getNumber(); contactID++) {
+            input.radarData.push_back(buoys.getRadarData(contactID,input.position));
+        }
+
+        BenchmarkClock::time_point scanStart = BenchmarkClock::now();
+        irr::u32 spokesThisFrame = radar.stepScan(input, FRAME_TIME);
+        irr::f64 thisScanTime = secondsSince(scanStart);
+
+        BenchmarkClock::time_point arpaStart = BenchmarkClock::now();
+        radar.stepARPA(input);
+        irr::f64 thisArpaTime = secondsSince(arpaStart);
+
+        BenchmarkClock::time_point renderStart = BenchmarkClock::now();
+        radar.stepRender(radarImage, radarImageOverlaid, input.heading, input.speed);
+        irr::f64 thisRenderTime = secondsSince(renderStart);
+
+        spokesDone += spokesThisFrame;
+        if (timing) {
+            scanTime += thisScanTime;
+            arpaTime += thisArpaTime;
+            renderTime += thisRenderTime;
+            frameTime += secondsSince(frameStart);
+            spokesScanned += spokesThisFrame;
+            frames++;
+        }
+    }
+
+    irr::u64 displayPixels = radar.getDisplayPixels();
+
+    radarImage->drop();
+    radarImageOverlaid->drop();
+
+    RadarBenchmarkResult result;
+    irr::f64 sweeps = (irr::f64)spokesScanned / settings.spokes;
+    irr::u64 cells = spokesScanned * (radar.getRangeResolution() - 1); //Cell 0 is not scanned
+    result.sweepsPerSecond = scanTime > 0 ? sweeps / scanTime : 0;
+    result.nsPerCell = cells > 0 ? 1e9 * scanTime / cells : 0;
+    result.arpaMicrosecondsPerFrame = frames > 0 ? 1e6 * arpaTime / frames : 0;
+    result.nsPerPixel = (frames > 0 && displayPixels > 0) ? 1e9 * renderTime / (frames * displayPixels) : 0;
+    result.frameMicroseconds = frames > 0 ? 1e6 * frameTime / frames : 0;
+    result.terrainQueriesPerSweep = sweeps > 0 ? (SyntheticWorld::getTerrainQueries() - terrainQueriesAtStart) / sweeps : 0;
+    return result;
+}
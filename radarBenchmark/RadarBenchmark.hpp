@@ -0,0 +1,58 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __RADARBENCHMARK_HPP_INCLUDED__
+#define __RADARBENCHMARK_HPP_INCLUDED__
+
+#include "irrlicht.h"
+#include <string>
+
+struct RadarBenchmarkSettings {
+    std::string radarConfigFile; //radar.ini to take noise and colour settings from, or empty for the defaults
+    irr::u32 ships;
+    irr::u32 buoys;
+    bool terrain;
+    bool arpa;
+    irr::u32 displayMode; //0: North up, 1: Course up, 2: Head up
+    irr::f32 rangeNm;
+    irr::u32 spokes;
+    irr::u32 radiusPx;
+    irr::u32 sweeps; //Number of full antenna revolutions to time
+    irr::u32 seed;
+};
+
+struct RadarBenchmarkResult {
+    irr::f64 sweepsPerSecond; //Complete revolutions scanned per second, scan() only
+    irr::f64 nsPerCell; //scan() time per range cell
+    irr::f64 arpaMicrosecondsPerFrame; //updateARPA() time per update
+    irr::f64 nsPerPixel; //render() time per pixel inside the radar display
+    irr::f64 frameMicroseconds; //Total time per update (scan, ARPA and render)
+    irr::f64 terrainQueriesPerSweep;
+};
+
+//Times the radar's scan(), updateARPA() and render() steps separately, as RadarCalculation::update() would call them,
+//against the synthetic world, drawing into in-memory images. Friend of RadarCalculation.
+class RadarBenchmark
+{
+    public:
+        RadarBenchmark(irr::IrrlichtDevice* dev);
+        RadarBenchmarkResult run(const RadarBenchmarkSettings& settings);
+
+    private:
+        irr::IrrlichtDevice* device;
+};
+
+#endif
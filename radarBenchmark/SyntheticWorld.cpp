@@ -0,0 +1,339 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "SyntheticWorld.hpp"
+
+#include "../Terrain.hpp"
+#include "../Ship.hpp"
+#include "../OtherShips.hpp"
+#include "../Buoys.hpp"
+#include "../Buoy.hpp"
+#include "../OtherShip.hpp"
+#include "../RadarData.hpp"
+#include "../Angles.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cfloat> //For FLT_MAX
+#include <algorithm>
+
+//using namespace irr;
+
+namespace
+{
+    struct SyntheticContact {
+        irr::f32 x;
+        irr::f32 z;
+        irr::f32 heading; //deg
+        irr::f32 speed; //m/s
+        irr::f32 length;
+        irr::f32 height;
+        irr::f32 solidHeight;
+        irr::f32 rcs;
+    };
+
+    //Heightfield, stored like an Irrlicht terrain: vertex (x,z) is at [x*heightfieldSize + z]
+    const irr::u32 heightfieldSize = 513;
+    const irr::f32 seaFloorHeight = -20;
+
+    std::vector<SyntheticContact> syntheticShips;
+    std::vector<SyntheticContact> syntheticBuoys;
+    std::vector<irr::f32> heightfield;
+    irr::f32 heightfieldOrigin = 0; //x and z of vertex 0
+    irr::f32 heightfieldSpacing = 1;
+    bool terrainPresent = false;
+    irr::u64 terrainQueries = 0;
+
+    irr::f32 ownShipX = 0;
+    irr::f32 ownShipZ = 0;
+    const irr::f32 ownShipHeading = 45;
+    const irr::f32 ownShipSpeed = 6;
+
+    irr::u32 randomState = 1;
+
+    //Own small generator, so that the same seed gives the same world on every platform
+    irr::f32 randomUniform(irr::f32 low, irr::f32 high)
+    {
+        randomState = randomState * 1664525 + 1013904223;
+        return low + (high - low) * ((randomState >> 8) / 16777216.0f);
+    }
+
+    RadarData contactRadarData(const SyntheticContact& contact, irr::core::vector3df scannerPosition)
+    {
+        //Same calculation as OtherShip::getRadarData and Buoy::getRadarData
+        RadarData radarData;
+
+        irr::core::vector3df contactPosition(contact.x, 0, contact.z);
+        irr::core::vector3df relativePosition = contactPosition - scannerPosition;
+
+        radarData.relX = relativePosition.X;
+        radarData.relZ = relativePosition.Z;
+
+        radarData.angle = relativePosition.getHorizontalAngle().Y;
+        radarData.range = relativePosition.getLength();
+
+        radarData.heading = contact.heading;
+        radarData.height = contact.height;
+        radarData.solidHeight = contact.solidHeight;
+        radarData.length = contact.length;
+        radarData.rcs = contact.rcs;
+        radarData.contact = (void*)&contact;
+
+        //Angles and ranges of the ends of the contact
+        irr::f32 sinHeading = std::sin(irr::core::DEGTORAD*radarData.heading);
+        irr::f32 cosHeading = std::cos(irr::core::DEGTORAD*radarData.heading);
+        irr::f32 end1X = radarData.relX + 0.5*radarData.length*sinHeading;
+        irr::f32 end1Z = radarData.relZ + 0.5*radarData.length*cosHeading;
+        irr::f32 end2X = radarData.relX - 0.5*radarData.length*sinHeading;
+        irr::f32 end2Z = radarData.relZ - 0.5*radarData.length*cosHeading;
+
+        irr::f32 relAngle1 = Angles::normaliseAngle(irr::core::RADTODEG*std::atan2(end1X, end1Z));
+        irr::f32 relAngle2 = Angles::normaliseAngle(irr::core::RADTODEG*std::atan2(end2X, end2Z));
+        irr::f32 range1 = std::sqrt(end1X*end1X + end1Z*end1Z);
+        irr::f32 range2 = std::sqrt(end2X*end2X + end2Z*end2Z);
+
+        radarData.minRange = std::min(range1,range2);
+        radarData.maxRange = std::max(range1,range2);
+        radarData.minAngle = std::min(relAngle1,relAngle2);
+        radarData.maxAngle = std::max(relAngle1,relAngle2);
+
+        //Initial defaults: Will need changing with full implementation
+        radarData.hidden = false;
+        radarData.racon = "";
+        radarData.raconOffsetTime = 0;
+        radarData.SART = false;
+
+        return radarData;
+    }
+}
+
+namespace SyntheticWorld
+{
+    void generate(irr::u32 numberOfShips, irr::u32 numberOfBuoys, irr::f32 areaRadius, bool withTerrain, irr::u32 seed)
+    {
+        randomState = seed;
+        ownShipX = 0;
+        ownShipZ = 0;
+
+        syntheticShips.clear();
+        for (irr::u32 i = 0; i < numberOfShips; i++) {
+            SyntheticContact ship;
+            irr::f32 angle = randomUniform(0, 2*irr::core::PI);
+            irr::f32 range = areaRadius * std::sqrt(randomUniform(0.0025, 1)); //Even spread over the area, but not on top of own ship
+            ship.x = ownShipX + range * std::sin(angle);
+            ship.z = ownShipZ + range * std::cos(angle);
+            ship.heading = randomUniform(0, 360);
+            ship.speed = randomUniform(0, 10);
+            ship.length = randomUniform(20, 300);
+            ship.height = ship.length * randomUniform(0.1, 0.2);
+            ship.solidHeight = 0.5 * ship.height;
+            ship.rcs = 0.005*std::pow(ship.length,3);
+            syntheticShips.push_back(ship);
+        }
+
+        syntheticBuoys.clear();
+        for (irr::u32 i = 0; i < numberOfBuoys; i++) {
+            SyntheticContact buoy;
+            irr::f32 angle = randomUniform(0, 2*irr::core::PI);
+            irr::f32 range = areaRadius * std::sqrt(randomUniform(0.0025, 1));
+            buoy.x = ownShipX + range * std::sin(angle);
+            buoy.z = ownShipZ + range * std::cos(angle);
+            buoy.heading = 0;
+            buoy.speed = 0;
+            buoy.length = randomUniform(1, 3);
+            buoy.height = randomUniform(2, 5);
+            buoy.solidHeight = 0;
+            buoy.rcs = 0.005*std::pow(buoy.length,3);
+            syntheticBuoys.push_back(buoy);
+        }
+
+        //Terrain: random islands on a flat sea floor, covering a little more than the area
+        terrainPresent = withTerrain;
+        terrainQueries = 0;
+        heightfield.clear();
+        if (withTerrain) {
+            heightfieldOrigin = -1.25 * areaRadius;
+            heightfieldSpacing = 2.5 * areaRadius / (heightfieldSize - 1);
+            heightfield.assign(heightfieldSize * heightfieldSize, seaFloorHeight);
+
+            irr::u32 numberOfIslands = 40;
+            for (irr::u32 i = 0; i < numberOfIslands; i++) {
+                irr::f32 angle = randomUniform(0, 2*irr::core::PI);
+                irr::f32 range = areaRadius * randomUniform(0.15, 1.1);
+                irr::f32 islandX = ownShipX + range * std::sin(angle);
+                irr::f32 islandZ = ownShipZ + range * std::cos(angle);
+                irr::f32 islandRadius = areaRadius * randomUniform(0.01, 0.06);
+                irr::f32 islandHeight = randomUniform(20, 150) - seaFloorHeight;
+
+                for (irr::u32 x = 0; x < heightfieldSize; x++) {
+                    irr::f32 dx = heightfieldOrigin + x * heightfieldSpacing - islandX;
+                    for (irr::u32 z = 0; z < heightfieldSize; z++) {
+                        irr::f32 dz = heightfieldOrigin + z * heightfieldSpacing - islandZ;
+                        irr::f32 distanceSq = (dx*dx + dz*dz) / (islandRadius*islandRadius);
+                        if (distanceSq < 9) {
+                            heightfield[x*heightfieldSize + z] += islandHeight * std::exp(-distanceSq);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void advance(irr::f32 deltaTime)
+    {
+        ownShipX += deltaTime * ownShipSpeed * std::sin(irr::core::DEGTORAD*ownShipHeading);
+        ownShipZ += deltaTime * ownShipSpeed * std::cos(irr::core::DEGTORAD*ownShipHeading);
+
+        for (std::vector<SyntheticContact>::iterator it = syntheticShips.begin(); it != syntheticShips.end(); ++it) {
+            it->x += deltaTime * it->speed * std::sin(irr::core::DEGTORAD*it->heading);
+            it->z += deltaTime * it->speed * std::cos(irr::core::DEGTORAD*it->heading);
+        }
+    }
+
+    irr::core::vector3df getOwnShipPosition()
+    {
+        return irr::core::vector3df(ownShipX, 0, ownShipZ);
+    }
+
+    irr::f32 getOwnShipHeading()
+    {
+        return ownShipHeading;
+    }
+
+    irr::f32 getOwnShipSpeed()
+    {
+        return ownShipSpeed;
+    }
+
+    irr::u64 getTerrainQueries()
+    {
+        return terrainQueries;
+    }
+}
+
+//Stand-ins for the simulation objects RadarCalculation uses. These replace Terrain.cpp, Ship.cpp, OtherShips.cpp and Buoys.cpp
+//in the benchmark build.
+
+Terrain::Terrain()
+{
+}
+
+Terrain::~Terrain()
+{
+}
+
+irr::f32 Terrain::getHeight(irr::f32 x, irr::f32 z) const
+{
+    terrainQueries++;
+
+    if (!terrainPresent) {
+        return -FLT_MAX;
+    }
+
+    //Interpolate on the heightfield triangles, the same way as Irrlicht's terrain scene node
+    irr::f32 gridX = (x - heightfieldOrigin) / heightfieldSpacing;
+    irr::f32 gridZ = (z - heightfieldOrigin) / heightfieldSpacing;
+    irr::s32 cellX = irr::core::floor32(gridX);
+    irr::s32 cellZ = irr::core::floor32(gridZ);
+
+    if (cellX < 0 || cellZ < 0 || cellX >= (irr::s32)heightfieldSize - 1 || cellZ >= (irr::s32)heightfieldSize - 1) {
+        return -FLT_MAX;
+    }
+
+    irr::f32 dx = gridX - cellX;
+    irr::f32 dz = gridZ - cellZ;
+    irr::f32 a = heightfield[cellX*heightfieldSize + cellZ];
+    irr::f32 b = heightfield[(cellX + 1)*heightfieldSize + cellZ];
+    irr::f32 c = heightfield[cellX*heightfieldSize + cellZ + 1];
+    irr::f32 d = heightfield[(cellX + 1)*heightfieldSize + cellZ + 1];
+
+    if (dx > dz) {
+        return a + (d - b)*dz + (b - a)*dx;
+    } else {
+        return a + (d - c)*dx + (c - a)*dz;
+    }
+}
+
+void Terrain::getHeights(const irr::f32* x, const irr::f32* z, irr::f32* heights, irr::u32 n) const
+{
+    for (irr::u32 i = 0; i < n; i++) {
+        heights[i] = getHeight(x[i], z[i]);
+    }
+}
+
+irr::u32 Terrain::getTileGeneration() const
+{
+    return 0; //Not tiled
+}
+
+Ship::Ship()
+{
+}
+
+Ship::~Ship()
+{
+}
+
+irr::core::vector3df Ship::getPosition() const
+{
+    return SyntheticWorld::getOwnShipPosition();
+}
+
+irr::f32 Ship::getHeading() const
+{
+    return SyntheticWorld::getOwnShipHeading();
+}
+
+irr::f32 Ship::getSpeed() const
+{
+    return SyntheticWorld::getOwnShipSpeed();
+}
+
+OtherShips::OtherShips()
+{
+}
+
+OtherShips::~OtherShips()
+{
+}
+
+irr::u32 OtherShips::getNumber() const
+{
+    return syntheticShips.size();
+}
+
+RadarData OtherShips::getRadarData(irr::u32 number, irr::core::vector3df scannerPosition) const
+{
+    return contactRadarData(syntheticShips.at(number-1), scannerPosition);
+}
+
+Buoys::Buoys()
+{
+}
+
+Buoys::~Buoys()
+{
+}
+
+irr::u32 Buoys::getNumber() const
+{
+    return syntheticBuoys.size();
+}
+
+RadarData Buoys::getRadarData(irr::u32 number, irr::core::vector3df scannerPosition) const
+{
+    return contactRadarData(syntheticBuoys.at(number-1), scannerPosition);
+}
@@ -0,0 +1,36 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef __SYNTHETICWORLD_HPP_INCLUDED__
+#define __SYNTHETICWORLD_HPP_INCLUDED__
+
+#include "irrlicht.h"
+
+//Synthetic world for the radar benchmark. SyntheticWorld.cpp also provides stand-in versions of the Terrain, Ship, OtherShips
+//and Buoys functions used by RadarCalculation, which return data from here instead of from loaded scene nodes.
+namespace SyntheticWorld
+{
+    //Make a world of randomly placed ships and buoys within areaRadius (m) of own ship, and a terrain of random hills and
+    //islands covering the same area. The same seed always gives the same world.
+    void generate(irr::u32 numberOfShips, irr::u32 numberOfBuoys, irr::f32 areaRadius, bool withTerrain, irr::u32 seed);
+    void advance(irr::f32 deltaTime); //Move own ship and the other ships on their courses
+    irr::core::vector3df getOwnShipPosition();
+    irr::f32 getOwnShipHeading(); //deg
+    irr::f32 getOwnShipSpeed(); //m/s
+    irr::u64 getTerrainQueries(); //Number of calls to Terrain::getHeight() so far
+}
+
+#endif
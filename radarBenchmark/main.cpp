@@ -0,0 +1,170 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+//Headless benchmark of the radar scan, ARPA and picture drawing, against a synthetic world.
+//Usage: bridgecommand-radarbench [-ships n] [-buoys n] [-ranges 1.5,6,24] [-spokes 180,720,2048] [-radii 256]
+//                                [-sweeps n] [-mode north|course|head] [-noterrain] [-noarpa] [-config radar.ini] [-seed n]
+
+#include "irrlicht.h"
+#include "RadarBenchmark.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+// Irrlicht Namespaces
+//using namespace irr;
+
+//Set up global for ini reader to have access to irrlicht logger if needed.
+namespace IniFile {
+    irr::ILogger* irrlichtLogger = 0;
+}
+
+namespace
+{
+    //Split a comma separated list, e.g. "180,720,2048"
+    template <typename T> std::vector<T> parseList(const std::string& list)
+    {
+        std::vector<T> values;
+        std::stringstream listStream(list);
+        std::string item;
+        while (std::getline(listStream, item, ',')) {
+            std::stringstream itemStream(item);
+            T value;
+            if (itemStream >> value) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: bridgecommand-radarbench [-ships n] [-buoys n] [-ranges 1.5,6,24] [-spokes 180,720,2048] [-radii 256]" << std::endl;
+        std::cout << "                                [-sweeps n] [-mode north|course|head] [-noterrain] [-noarpa] [-config radar.ini] [-seed n]" << std::endl;
+    }
+}
+
+int main (int argc, char ** argv)
+{
+    RadarBenchmarkSettings settings;
+    settings.radarConfigFile = "";
+    settings.ships = 50;
+    settings.buoys = 200;
+    settings.terrain = true;
+    settings.arpa = true;
+    settings.displayMode = 0;
+    settings.sweeps = 5;
+    settings.seed = 1;
+
+    std::vector<irr::f32> ranges = parseList<irr::f32>("1.5,6,24");
+    std::vector<irr::u32> spokeCounts = parseList<irr::u32>("180,720,2048");
+    std::vector<irr::u32> radii = parseList<irr::u32>("256");
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (option == "-ships" && hasValue) {
+            settings.ships = std::atoi(argv[++i]);
+        } else if (option == "-buoys" && hasValue) {
+            settings.buoys = std::atoi(argv[++i]);
+        } else if (option == "-ranges" && hasValue) {
+            ranges = parseList<irr::f32>(argv[++i]);
+        } else if (option == "-spokes" && hasValue) {
+            spokeCounts = parseList<irr::u32>(argv[++i]);
+        } else if (option == "-radii" && hasValue) {
+            radii = parseList<irr::u32>(argv[++i]);
+        } else if (option == "-sweeps" && hasValue) {
+            settings.sweeps = std::atoi(argv[++i]);
+        } else if (option == "-mode" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "course") {
+                settings.displayMode = 1;
+            } else if (mode == "head") {
+                settings.displayMode = 2;
+            } else {
+                settings.displayMode = 0;
+            }
+        } else if (option == "-noterrain") {
+            settings.terrain = false;
+        } else if (option == "-noarpa") {
+            settings.arpa = false;
+        } else if (option == "-config" && hasValue) {
+            settings.radarConfigFile = argv[++i];
+        } else if (option == "-seed" && hasValue) {
+            settings.seed = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (ranges.empty() || spokeCounts.empty() || radii.empty() || settings.sweeps < 1) {
+        printUsage();
+        return 1;
+    }
+
+    //Null driver: No window, but can still create the images the radar draws into
+    irr::IrrlichtDevice* device = irr::createDevice(irr::video::EDT_NULL);
+    if (device == 0) {
+        std::cerr << "Could not create Irrlicht device" << std::endl;
+        return 1;
+    }
+    device->getLogger()->setLogLevel(irr::ELL_ERROR);
+    IniFile::irrlichtLogger = device->getLogger();
+
+    std::cout << "Radar benchmark: " << settings.ships << " ships, " << settings.buoys << " buoys, terrain " << (settings.terrain ? "on" : "off")
+              << ", ARPA " << (settings.arpa ? "on" : "off") << ", " << settings.sweeps << " sweeps per case" << std::endl;
+    std::cout << std::setw(9) << "Range(Nm)" << std::setw(8) << "Spokes" << std::setw(8) << "Radius"
+              << std::setw(10) << "Sweeps/s" << std::setw(10) << "ns/cell" << std::setw(12) << "ARPA us/upd"
+              << std::setw(10) << "ns/pixel" << std::setw(12) << "us/update" << std::setw(14) << "Terrain/sweep" << std::endl;
+
+    RadarBenchmark benchmark(device);
+    for (unsigned int r = 0; r < ranges.size(); r++) {
+        for (unsigned int s = 0; s < spokeCounts.size(); s++) {
+            for (unsigned int p = 0; p < radii.size(); p++) {
+                settings.rangeNm = ranges.at(r);
+                settings.spokes = spokeCounts.at(s);
+                settings.radiusPx = radii.at(p);
+
+                //Same limits as RadarCalculation::load(), but at least 36 spokes so each update scans less than a full revolution
+                if (settings.spokes < 36) {settings.spokes = 36;}
+                if (settings.spokes > 4096) {settings.spokes = 4096;}
+                if (settings.rangeNm <= 0) {settings.rangeNm = 1;}
+                if (settings.radiusPx < 1) {settings.radiusPx = 1;}
+
+                RadarBenchmarkResult result = benchmark.run(settings);
+
+                std::cout << std::fixed
+                          << std::setw(9) << std::setprecision(2) << settings.rangeNm
+                          << std::setw(8) << settings.spokes
+                          << std::setw(8) << settings.radiusPx
+                          << std::setw(10) << std::setprecision(1) << result.sweepsPerSecond
+                          << std::setw(10) << std::setprecision(2) << result.nsPerCell
+                          << std::setw(12) << std::setprecision(1) << result.arpaMicrosecondsPerFrame
+                          << std::setw(10) << std::setprecision(2) << result.nsPerPixel
+                          << std::setw(12) << std::setprecision(1) << result.frameMicroseconds
+                          << std::setw(14) << std::setprecision(0) << result.terrainQueriesPerSweep << std::endl;
+            }
+        }
+    }
+
+    device->drop();
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+//Headless scenario runner: loads a scenario and its world on a null Irrlicht device, then advances the SimulationModel as fast as
+//the CPU allows, with nothing rendered and no GUI or sound. The own ship, other ships, ARPA contacts and collisions are written to
+//a CSV file every report interval of simulated time. Run from the Bridge Command folder, so the worlds and models are found.
+//The sea surface is not animated (its waves are made on a background thread, as the display needs them), so stays as at the start.
+//Usage: bridgecommand-sr <scenario folder or scenario name> <output file> [duration (s), default 3600] [report interval (s), default 10]
+
+#include "irrlicht.h"
+#include "../SimulationModel.hpp"
+#include "../ScenarioDataStructure.hpp"
+#include "../GUIMain.hpp"
+#include "../Lang.hpp"
+#include "../Sound.hpp"
+#include "../IniFile.hpp"
+#include "../Constants.hpp"
+#include "../Utilities.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+// Irrlicht Namespaces
+//using namespace irr;
+
+//Set up global for ini reader to have access to irrlicht logger if needed.
+namespace IniFile {
+    irr::ILogger* irrlichtLogger = 0;
+}
+
+namespace
+{
+    const irr::f32 FRAME_TIME = 0.1; //Simulated time per model update (s), as for a display at 10 fps. The ship dynamics step at their own fixed rate.
+
+    //A scenario folder path can be given directly, or just the scenario's name, as in the scenario list
+    std::string findScenarioPath(const std::string& scenarioArgument)
+    {
+        if (Utilities::pathExists(scenarioArgument)) {
+            return scenarioArgument;
+        }
+        std::string scenarioPath = "Scenarios/";
+        scenarioPath.append(scenarioArgument);
+        std::string userFolder = Utilities::getUserDir();
+        if (Utilities::pathExists(userFolder + scenarioPath)) {
+            return userFolder + scenarioPath;
+        }
+        return scenarioPath;
+    }
+
+    std::string findScenarioName(const std::string& scenarioPath)
+    {
+        std::string name = scenarioPath;
+        while (!name.empty() && (name[name.size()-1] == '/' || name[name.size()-1] == '\\')) {
+            name.erase(name.size()-1);
+        }
+        size_t pos = name.find_last_of("\\/");
+        if (pos != std::string::npos) {
+            name = name.substr(pos+1);
+        }
+        return name;
+    }
+
+    void writeState(std::ofstream& output, irr::f32 time, const SimulationModel& model)
+    {
+        output << "OWN," << time << "," << model.getLat() << "," << model.getLong() << "," << model.getPosX() << "," << model.getPosZ() << ","
+               << model.getHeading() << "," << model.getSpeed()*MPS_TO_KTS << "," << model.getCOG() << "," << model.getSOG()*MPS_TO_KTS << ","
+               << model.getRudder() << "," << model.getPortEngine() << "," << model.getStbdEngine() << "," << (model.hasCollided() ? 1 : 0) << "\n";
+
+        for (irr::u32 i = 0; i < model.getNumberOfOtherShips(); i++) {
+            output << "SHIP," << time << "," << i+1 << "," << model.getOtherShipName(i) << "," << model.getOtherShipPosX(i) << ","
+                   << model.getOtherShipPosZ(i) << "," << model.getOtherShipHeading(i) << "," << model.getOtherShipSpeed(i)*MPS_TO_KTS << "\n";
+        }
+
+        for (irr::u32 i = 1; i <= model.getNumberOfARPAContacts(); i++) {
+            output << "ARPA," << time << "," << i << "," << model.getARPACPA(i) << "," << model.getARPATCPA(i) << ","
+                   << model.getARPAHeading(i) << "," << model.getARPASpeed(i) << "\n";
+        }
+    }
+}
+
+int main (int argc, char ** argv)
+{
+    if (argc < 3) {
+        std::cout << "Usage: bridgecommand-sr <scenario folder or scenario name> <output file> [duration (s), default 3600] [report interval (s), default 10]" << std::endl;
+        return 1;
+    }
+    std::string scenarioPath = findScenarioPath(argv[1]);
+    std::string scenarioName = findScenarioName(scenarioPath);
+    std::string outputFilename = argv[2];
+    irr::f32 duration = 3600;
+    if (argc > 3) {
+        duration = Utilities::lexical_cast<irr::f32>(std::string(argv[3]));
+    }
+    irr::f32 reportInterval = 10;
+    if (argc > 4) {
+        reportInterval = Utilities::lexical_cast<irr::f32>(std::string(argv[4]));
+    }
+    if (!(duration > 0) || !(reportInterval > 0)) {
+        std::cerr << "Duration and report interval must be greater than zero" << std::endl;
+        return 1;
+    }
+
+    //Null device: Nothing is drawn, but the scene, GUI and textures are all still made, as the simulation expects them
+    irr::IrrlichtDevice* device = irr::createDevice(irr::video::EDT_NULL);
+    if (device == 0) {
+        std::cerr << "Could not start Irrlicht" << std::endl;
+        return 1;
+    }
+    device->getLogger()->setLogLevel(irr::ELL_ERROR);
+    IniFile::irrlichtLogger = device->getLogger();
+    irr::scene::ISceneManager* smgr = device->getSceneManager();
+
+    //Simulation settings from the ini file, as for bridgecommand-bc
+    std::string userFolder = Utilities::getUserDir();
+    std::string iniFilename = "bc5.ini";
+    if (Utilities::pathExists(userFolder + iniFilename)) {
+        iniFilename = userFolder + iniFilename;
+    }
+    irr::f32 simulationRate = IniFile::iniFileTof32(iniFilename, "simulation_rate");
+
+    ScenarioData scenarioData = Utilities::getScenarioDataFromFile(scenarioPath, scenarioName);
+    if (scenarioData.worldName.empty()) {
+        std::cerr << scenarioPath << ": No world set in environment.ini, or scenario not found" << std::endl;
+        device->drop();
+        return 1;
+    }
+
+    std::ofstream output(outputFilename.c_str());
+    if (!output.is_open()) {
+        std::cerr << "Could not open " << outputFilename << " to write" << std::endl;
+        device->drop();
+        return 1;
+    }
+
+    //Same random sequence each run, so runs of the same scenario can be compared
+    std::srand(1);
+
+    Lang language("language-en.txt");
+    std::vector<std::string> logMessages;
+    Sound sound; //Not loaded, so silent
+    GUIMain guiMain;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    irr::u32 updates = 0;
+    irr::f32 time = 0;
+    {
+        //Shaders disabled, radar calculated on this thread and no impostors, as for the simplest display
+        SimulationModel model(device, smgr, &guiMain, &sound, scenarioData, OperatingMode::Normal, 90, 0, 1, 6*M_IN_NM, 1, 0, simulationRate, 0);
+        guiMain.load(device, &language, &logMessages, model.isSingleEngine(), false, model.hasDepthSounder(), model.getMaxSounderDepth(), model.hasGPS(), model.hasBowThruster(), model.hasSternThruster(), model.hasTurnIndicator());
+        model.setArpaOn(true);
+        model.setAccelerator(1.0);
+
+        output << std::setprecision(8);
+        output << "#Scenario " << scenarioName << ", world " << scenarioData.worldName << "\n";
+        output << "#OWN,time (s),lat,long,x (m),z (m),heading,speed (kts),COG,SOG (kts),rudder,port engine,stbd engine,collided\n";
+        output << "#SHIP,time (s),number,name,x (m),z (m),heading,speed (kts)\n";
+        output << "#ARPA,time (s),contact,CPA (Nm),TCPA (min),heading,speed (kts)\n";
+        output << "#COLLISION,time (s)\n";
+        writeState(output, time, model);
+
+        //Count updates rather than adding up FRAME_TIME, so the report times don't drift
+        irr::u32 totalUpdates = std::ceil(duration/FRAME_TIME);
+        irr::u32 nextReport = 1;
+        bool wasCollided = model.hasCollided();
+        for (updates = 1; updates <= totalUpdates; updates++) {
+            model.advance(FRAME_TIME);
+            time = updates*FRAME_TIME;
+
+            //Report collisions as they start, even if between reports
+            bool isCollided = model.hasCollided();
+            if (isCollided && !wasCollided) {
+                output << "COLLISION," << time << "\n";
+            }
+            wasCollided = isCollided;
+
+            if (time >= nextReport*reportInterval - 0.5*FRAME_TIME) {
+                writeState(output, time, model);
+                nextReport++;
+            }
+        }
+        updates = totalUpdates;
+    }
+    std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    output.close();
+
+    irr::f32 elapsedSeconds = std::chrono::duration<irr::f32>(endTime - startTime).count();
+    std::cout << scenarioName << ": " << time << " s simulated in " << elapsedSeconds << " s (" << time/elapsedSeconds << "x real time, "
+              << 1000*elapsedSeconds/updates << " ms per update, including loading)" << std::endl;
+
+    device->drop();
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*   Bridge Command 5.0 Ship Simulator
+     Copyright (C) 2014 James Packer
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License version 2 as
+     published by the Free Software Foundation
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY Or FITNESS For A PARTICULAR PURPOSE.  See the
+     GNU General Public License For more details.
+
+     You should have received a copy of the GNU General Public License along
+     with this program; if not, write to the Free Software Foundation, Inc.,
+     51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+//Offline world compiler: reads a world model's ini files, decodes its height maps and textures, and writes them all to
+//world.bcpack in the world model folder, which bridgecommand-bc then loads instead while it is newer than the world's files.
+//Usage: bridgecommand-wc <world folder or world name> [...]
+
+#include "irrlicht.h"
+#include "../WorldPack.hpp"
+#include "../Utilities.hpp"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <sys/stat.h>
+
+// Irrlicht Namespaces
+//using namespace irr;
+
+//Set up global for ini reader to have access to irrlicht logger if needed.
+namespace IniFile {
+    irr::ILogger* irrlichtLogger = 0;
+}
+
+namespace
+{
+    //A world folder path can be given directly, or just the world's name, as used in scenarios
+    std::string findWorldPath(const std::string& worldArgument)
+    {
+        if (Utilities::pathExists(worldArgument)) {
+            return worldArgument;
+        }
+        std::string worldPath = "World/";
+        worldPath.append(worldArgument);
+        std::string userFolder = Utilities::getUserDir();
+        if (Utilities::pathExists(userFolder + worldPath)) {
+            return userFolder + worldPath;
+        }
+        return worldPath;
+    }
+
+    irr::u64 fileSize(const std::string& path)
+    {
+        struct stat fileInfo;
+        if (stat(path.c_str(), &fileInfo) != 0) {
+            return 0;
+        }
+        return fileInfo.st_size;
+    }
+}
+
+int main (int argc, char ** argv)
+{
+    if (argc < 2) {
+        std::cout << "Usage: bridgecommand-wc <world folder or world name> [...]" << std::endl;
+        return 1;
+    }
+
+    //Null device: Only the file system and image loaders are needed to decode the height maps and textures
+    irr::IrrlichtDevice* device = irr::createDevice(irr::video::EDT_NULL);
+    if (device == 0) {
+        std::cerr << "Could not start Irrlicht" << std::endl;
+        return 1;
+    }
+    device->getLogger()->setLogLevel(irr::ELL_ERROR);
+    IniFile::irrlichtLogger = device->getLogger();
+    irr::scene::ISceneManager* smgr = device->getSceneManager();
+
+    int failures = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string worldPath = findWorldPath(argv[i]);
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        WorldPack worldPack;
+        if (!worldPack.readIni(worldPath)) {
+            std::cerr << worldPath << ": No terrain found in terrain.ini, not compiled" << std::endl;
+            failures++;
+            continue;
+        }
+        if (!worldPack.decode(worldPath, smgr) || !worldPack.save(worldPath)) {
+            std::cerr << worldPath << ": Could not compile world pack" << std::endl;
+            failures++;
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+        std::string packPath = WorldPack::getPackPath(worldPath);
+        std::cout << packPath << ": " << worldPack.terrains.size() << " terrains, " << worldPack.buoys.size() << " buoys, "
+                  << worldPack.lights.size() << " lights, " << worldPack.landObjects.size() << " land objects, "
+                  << fileSize(packPath)/1024 << " kB, compiled in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count() << " ms" << std::endl;
+    }
+
+    device->drop();
+    return failures > 0 ? 1 : 0;
+}